@@ -107,6 +107,7 @@ class AdaptiveGrid : public mtao::geometry::grid::StaggeredGrid<double, 3> {
     int num_faces() const;
     int num_cells() const;
     mtao::ColVecs2i edges() const;
+    // faces ordered by (axis, dual edge). grid has to be the ownership grid of the current cells
     std::vector<Face> faces(const GridData3i &grid) const;
     const std::vector<Face> &faces() const { return m_faces; }
     const Face &face(size_t face_index) const { return m_faces.at(face_index); }
@@ -115,7 +116,13 @@ class AdaptiveGrid : public mtao::geometry::grid::StaggeredGrid<double, 3> {
     std::vector<Eigen::Triplet<double>> grid_face_projection(int min_edge_index) const;
     std::vector<Eigen::Triplet<double>> grid_cell_projection() const;
 
+    // p in local (cell index) coordinates. returns -2 outside of the grid and -1 if no adaptive cell contains p.
+    // lookups go through the ownership grid cached by make_faces, so a query is constant time
     int get_cell_index(const Vec &p) const;
+    // get_cell_index for every column of P, evaluated in parallel
+    mtao::VecXi get_cell_indices(const mtao::ColVecs3d &P) const;
+    // the cell owning each grid cell, -1 where there is none. empty until make_faces is called
+    const GridData3i &ownership_grid() const { return m_ownership_grid; }
 
     bool is_boundary_face(int cut_face_index) const;
     // for use exclusively with dual edges of cutfaces 
@@ -126,10 +133,16 @@ class AdaptiveGrid : public mtao::geometry::grid::StaggeredGrid<double, 3> {
     }
 
   private:
+    // has to be called whenever m_cells changes
+    void update_ownership_grid();
+    bool has_ownership_grid() const { return m_ownership_grid.shape() == cell_shape(); }
+    int get_cell_index_linear(const Vec &p) const;
+
     //std::vector<Edge> m_boundary;//Beware of -1!
     std::vector<Face> m_faces;
     std::vector<Edge> m_edges;
     std::map<int, Cell> m_cells;
+    GridData3i m_ownership_grid;
 };
 
 
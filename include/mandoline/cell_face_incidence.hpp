@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "mandoline/cutcell.hpp"
+
+
+namespace mandoline {
+
+// Immutable CSR cell -> face incidence, the only copy of the faces of the cut cells of a CutCellMesh<3>.
+// The CutCell std::map<int,bool>s are built from it on demand, walking every cell of a map touches a tree
+// node per face so operators walk these flat arrays instead. Faces of a cell are in increasing order, same as the map.
+class CellFaceIncidence {
+  public:
+    CellFaceIncidence() = default;
+    CellFaceIncidence(const std::vector<CutCell> &cells);
+
+    size_t cell_size() const { return m_offsets.size() - 1; }
+    size_t size() const { return m_faces.size(); }
+    bool empty() const { return m_faces.empty(); }
+
+    // entries of cell i are [begin(i),end(i))
+    int begin(int cell) const { return m_offsets[cell]; }
+    int end(int cell) const { return m_offsets[cell + 1]; }
+    int face_count(int cell) const { return end(cell) - begin(cell); }
+    int face(int entry) const { return m_faces[entry]; }
+    // same meaning as the bool of a CutCell entry
+    bool sign(int entry) const { return m_signs[entry]; }
+
+    const std::vector<int> &offsets() const { return m_offsets; }
+    const std::vector<int> &faces() const { return m_faces; }
+
+  private:
+    std::vector<int> m_offsets = { 0 };
+    std::vector<int> m_faces;
+    std::vector<uint8_t> m_signs;
+};
+}// namespace mandoline
@@ -24,11 +24,15 @@ class AdaptiveGridFactory {
 
     //cell mask
     AdaptiveGridFactory(const GridData3 &mask);
+    // cubes are branching_factor times wider than the cubes of the level below them
+    AdaptiveGridFactory(const GridData3 &mask, int branching_factor, bool balanced = false);
 
 
     std::tuple<std::array<std::set<Edge>, 3>, AxialBEdgeMap> compute_axial_edges(const std::optional<int> &max_level = {}) const;
     std::tuple<std::set<Edge>, AxialBEdgeMap> compute_edges(const std::optional<int> &max_level = {}) const;
 
+    // fills cells with the coarsest cubes (of at most max_level levels) that tile the free grid cells.
+    // With balanced set, cubes are then split until face adjacent cubes are at most one level apart
     void make_cells(const std::optional<int> &max_level = {});
 
     using Indexer = mtao::geometry::grid::indexing::OrderedIndexer<3>;
@@ -58,6 +62,13 @@ class AdaptiveGridFactory {
 
     GridData3i grid_from_cells(const std::map<int, Cell> &cells) const;
 
+    // free_block_masks()[L](c) is true if the cube of width branching_factor^L at c * branching_factor^L lies
+    // in the grid and covers no active grid cell
+    std::vector<GridData3> free_block_masks(const std::optional<int> &max_level = {}) const;
+    // splits cubes until no cube has a face neighbor (cut-cells count as level 0) more than one level finer
+    void balance_cells();
+    int cell_level(int cell_width) const;
+
     std::tuple<std::array<std::set<Edge>, 3>, AxialBEdgeMap> get_edges(const std::array<GridData3, 3> &edge_masks, int level, const coord_type &offset = {}) const;
     Edge get_edge(const coord_type &start, int jump, int dim) const;
 
@@ -85,6 +96,9 @@ class AdaptiveGridFactory {
     std::vector<GridData3> levels_mask;
     GridData3 original;
     std::map<int, Cell> cells;
+    // the edge / level machinery above always uses width, make_cells uses branching_factor
+    int branching_factor = width;
+    bool balanced = false;
 
   private:
     template<typename GridAccessor>
@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace mandoline::construction {
+
+// A dense set of grid cells stored as one bit per cell.
+// Cells are numbered with the last axis fastest, so walking the set bits visits cells in
+// lexicographic order (the order a std::set<coord_type> would have)
+template<int D>
+class CellBitmask {
+  public:
+    using coord_type = std::array<int, D>;
+    using WordType = uint64_t;
+    constexpr static int WordBits = 8 * sizeof(WordType);
+
+    CellBitmask() = default;
+    CellBitmask(const CellBitmask &) = default;
+    CellBitmask(CellBitmask &&) = default;
+    CellBitmask &operator=(const CellBitmask &) = default;
+    CellBitmask &operator=(CellBitmask &&) = default;
+    CellBitmask(const coord_type &shape);
+
+    const coord_type &shape() const { return m_shape; }
+    size_t cell_count() const;
+    size_t word_count() const { return m_words.size(); }
+
+    bool valid_index(const coord_type &c) const;
+    size_t index(const coord_type &c) const;
+    coord_type unindex(size_t index) const;
+
+    bool operator()(const coord_type &c) const;
+    // not thread safe
+    void set(const coord_type &c);
+    // can be called concurrently with other set_atomic calls
+    void set_atomic(const coord_type &c);
+
+    // number of set cells
+    size_t count() const;
+
+    // calls f(coord) for every set cell
+    template<typename Func>
+    void for_each(Func &&f) const;
+    // calls f(coord) for the set cells of a single word, for splitting for_each between threads
+    template<typename Func>
+    void for_each_in_word(size_t word, Func &&f) const;
+
+  private:
+    coord_type m_shape = {};
+    std::vector<WordType> m_words;
+};
+}// namespace mandoline::construction
+
+#include "mandoline/construction/cell_bitmask_impl.hpp"
@@ -0,0 +1,104 @@
+#pragma once
+#include "mandoline/construction/cell_bitmask.hpp"
+#include <bitset>
+
+namespace mandoline::construction {
+
+template<int D>
+CellBitmask<D>::CellBitmask(const coord_type &shape) : m_shape(shape) {
+    m_words.resize((cell_count() + WordBits - 1) / WordBits, 0);
+}
+
+template<int D>
+size_t CellBitmask<D>::cell_count() const {
+    size_t size = 1;
+    for (auto &&s : m_shape) {
+        size *= s;
+    }
+    return size;
+}
+
+template<int D>
+bool CellBitmask<D>::valid_index(const coord_type &c) const {
+    for (int d = 0; d < D; ++d) {
+        if (c[d] < 0 || c[d] >= m_shape[d]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<int D>
+size_t CellBitmask<D>::index(const coord_type &c) const {
+    size_t idx = 0;
+    for (int d = 0; d < D; ++d) {
+        idx = idx * m_shape[d] + c[d];
+    }
+    return idx;
+}
+
+template<int D>
+auto CellBitmask<D>::unindex(size_t idx) const -> coord_type {
+    coord_type c;
+    for (int d = D - 1; d >= 0; --d) {
+        c[d] = idx % m_shape[d];
+        idx /= m_shape[d];
+    }
+    return c;
+}
+
+template<int D>
+bool CellBitmask<D>::operator()(const coord_type &c) const {
+    size_t idx = index(c);
+    return (m_words[idx / WordBits] >> (idx % WordBits)) & 1;
+}
+
+template<int D>
+void CellBitmask<D>::set(const coord_type &c) {
+    size_t idx = index(c);
+    m_words[idx / WordBits] |= WordType(1) << (idx % WordBits);
+}
+
+template<int D>
+void CellBitmask<D>::set_atomic(const coord_type &c) {
+    size_t idx = index(c);
+    WordType &w = m_words[idx / WordBits];
+    const WordType bit = WordType(1) << (idx % WordBits);
+    // most cells are hit by several crossings, skip the read-modify-write once the bit is there
+    WordType current;
+#pragma omp atomic read
+    current = w;
+    if (!(current & bit)) {
+#pragma omp atomic
+        w |= bit;
+    }
+}
+
+template<int D>
+size_t CellBitmask<D>::count() const {
+    size_t ret = 0;
+    for (auto &&w : m_words) {
+        ret += std::bitset<WordBits>(w).count();
+    }
+    return ret;
+}
+
+template<int D>
+template<typename Func>
+void CellBitmask<D>::for_each_in_word(size_t word, Func &&f) const {
+    WordType w = m_words[word];
+    while (w != 0) {
+        int bit = __builtin_ctzll(w);
+        f(unindex(word * WordBits + bit));
+        w &= w - 1;
+    }
+}
+
+template<int D>
+template<typename Func>
+void CellBitmask<D>::for_each(Func &&f) const {
+    for (size_t word = 0; word < m_words.size(); ++word) {
+        for_each_in_word(word, f);
+    }
+}
+}// namespace mandoline::construction
@@ -1,5 +1,8 @@
 #pragma once
 
+#ifdef MTAO_OPENMP
+#include <omp.h>
+#endif
 #include <array>
 #include <tuple>
 #include <mtao/geometry/cyclic_order.hpp>
@@ -33,10 +36,15 @@ struct CellCollapser {
 
     void fill_cell_boundaries();
     // merge_open_faces makes both sides of a triangle part of the same cell if it has an unshared edge
+    // the fans around each edge are ordered in parallel, the resulting joins are applied in edge order
+    // so the cells (and their numbering) match the serial merge exactly
     template<typename Derived>
-    void merge(const Eigen::MatrixBase<Derived> &V, bool merge_open_faces = true);
+    void merge(const Eigen::MatrixBase<Derived> &V, bool merge_open_faces = true, bool parallel = true);
     template<typename Derived>
     void merge_around_edge(const Eigen::MatrixBase<Derived> &V, const Edge& e, const std::set<const HalfFace *>& halffaces);
+    // the (cell, dual cell) pairs that have to be joined to merge the fan of halffaces around an edge
+    template<typename Derived>
+    std::vector<std::array<int, 2>> edge_fan_joins(const Eigen::MatrixBase<Derived> &V, const Edge& e, const std::set<const HalfFace *>& halffaces) const;
     template<typename Derived>
     void bake(const Eigen::MatrixBase<Derived> &V);
 
@@ -70,9 +78,16 @@ void CellCollapser::bake(const Eigen::MatrixBase<Derived> &V) {
 
 template<typename Derived>
 void CellCollapser::merge_around_edge(const Eigen::MatrixBase<Derived> &V, const Edge& e, const std::set<const HalfFace *>& halffaces) {
+    for (auto &&[idx, idx1] : edge_fan_joins(V, e, halffaces)) {
+        cell_ds.join(idx, idx1);
+    }
+}
+template<typename Derived>
+auto CellCollapser::edge_fan_joins(const Eigen::MatrixBase<Derived> &V, const Edge& e, const std::set<const HalfFace *>& halffaces) const -> std::vector<std::array<int, 2>> {
     //auto t3 = mtao::logging::profiler("cell collapser edge fan processessing",false,"profiler");
+    std::vector<std::array<int, 2>> joins;
     if (halffaces.empty()) {
-        return;
+        return joins;
     }
     auto [a, b] = e;
     auto va = V.col(a);
@@ -134,6 +149,7 @@ void CellCollapser::merge_around_edge(const Eigen::MatrixBase<Derived> &V, const
     std::vector<int> ordered_faces(halffaces.size());
     // dereference the indices of indices
     std::transform(order.begin(), order.end(), ordered_faces.begin(), [&](int idx) { return faces[idx]; });
+    joins.reserve(ordered_faces.size());
     auto it = ordered_faces.begin();
     auto it1 = it;
     it1++;
@@ -143,19 +159,50 @@ void CellCollapser::merge_around_edge(const Eigen::MatrixBase<Derived> &V, const
         }
         int idx = cell({*it,e});
         int idx1 = dual_cell({*it1,e});
-        cell_ds.join(idx,idx1);
+        joins.push_back({{idx,idx1}});
     }
+    return joins;
 }
 template<typename Derived>
-void CellCollapser::merge(const Eigen::MatrixBase<Derived> &V, bool merge_open_faces) {
+void CellCollapser::merge(const Eigen::MatrixBase<Derived> &V, bool merge_open_faces, bool parallel) {
     auto t2 = mtao::logging::profiler("cell collapser merge", false, "profiler");
     auto&& hfs = collect_halffaces();
-    for (auto [e, halffaces] : hfs) {
-        if (e[0] < e[1]) { // only need to process each edge once
+    // only need to process each edge once
+    std::vector<const typename std::decay_t<decltype(hfs)>::value_type *> edges;
+    edges.reserve(hfs.size());
+    for (auto &&pr : hfs) {
+        auto &&[e, halffaces] = pr;
+        if (e[0] < e[1]) {
             if(merge_open_faces || halffaces.size() > 1) {
-                merge_around_edge(V,e,halffaces);
+                edges.emplace_back(&pr);
+            }
+        }
+    }
+    if (parallel) {
+        // the fan ordering only reads the collapser, so every edge can be processed independently.
+        // the union-find isn't thread safe and its roots determine the cell numbering, so the joins
+        // are buffered per edge and applied afterwards in the same order the serial loop would use
+        std::vector<std::vector<std::array<int, 2>>> joins(edges.size());
+        {
+            auto t3 = mtao::logging::profiler("cell collapser edge fans", false, "profiler");
+#ifdef MTAO_OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+            for (int idx = 0; idx < int(edges.size()); ++idx) {
+                auto &&[e, halffaces] = *edges[idx];
+                joins[idx] = edge_fan_joins(V, e, halffaces);
             }
         }
+        for (auto &&edge_joins : joins) {
+            for (auto &&[idx, idx1] : edge_joins) {
+                cell_ds.join(idx, idx1);
+            }
+        }
+    } else {
+        for (auto &&pr : edges) {
+            auto &&[e, halffaces] = *pr;
+            merge_around_edge(V, e, halffaces);
+        }
     }
     fill_cell_boundaries();
 }
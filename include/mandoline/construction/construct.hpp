@@ -7,6 +7,21 @@ CutCellMesh<3> from_grid_unnormalized(const mtao::ColVecs3d &V, const mtao::ColV
 CutCellMesh<3> from_grid(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, int adaptive_level = 0, std::optional<double> threshold = {});
 CutCellMesh<3> from_bbox(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const Eigen::AlignedBox<double, 3> &bbox, const std::array<int, 3> &cell_shape, int adaptive_level = 0, std::optional<double> threshold = 1e-9);
 
+// Builds the same mesh as from_grid one block of at most tile_shape cells at a time, so only the
+// per-block generators (and not one generator for the whole grid) have to fit in memory.
+// Each block is cut together with ghost_layers layers of neighboring cells, triangles are clipped to the
+// block and its ghost layers, and up to max_concurrent_tiles blocks are cut in parallel before being stitched.
+// Cell, face and vertex numbering differs from from_grid. Throws std::runtime_error if the blocks can't be
+// stitched back together exactly.
+CutCellMesh<3> from_grid_tiled(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, const std::array<int, 3> &tile_shape, int adaptive_level = 0, std::optional<double> threshold = {}, int max_concurrent_tiles = 1, int ghost_layers = 1);
+
+// from_grid_tiled with tiles that are slabs of slab_thickness cells along axis spanning the other two axes,
+// with the stitching of finished slabs overlapping the cutting of later ones. At most max_slabs_in_flight
+// slabs (the hardware concurrency when <= 0) are held in memory at a time. Each slab is baked by its own
+// CutCellGenerator<3>, whose stages still run one after the other, so this is a tiling mode with the same
+// output and stitching exactness guarantees as from_grid_tiled rather than a pipelined bake.
+CutCellMesh<3> from_grid_pipelined(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, int axis = 2, int slab_thickness = 8, int adaptive_level = 0, std::optional<double> threshold = {}, int max_slabs_in_flight = 0, int ghost_layers = 1);
+
 template<int D>
 class CutCellGenerator;
 class DeformingGeometryConstructor {
@@ -22,11 +37,19 @@ class DeformingGeometryConstructor {
     void update_mesh(const mtao::ColVecs3i &F);
     void update_grid(const mtao::geometry::grid::StaggeredGrid3d &g);
     void set_adaptivity(int res = 0);
+    // vertex-only updates only recompute the grid intersections of the edges and triangles that moved.
+    // Only the intersections are incremental: faces, cells and the adaptive grid are rebuilt on every bake
+    void set_incremental_intersections(bool incremental = true);
     void bake();
     CutCellMesh<3> emit() const;
 
   private:
     CutCellGenerator<3> *_ccg = nullptr;
     bool _dirty = true;
+    // set whenever something other than vertex positions changed
+    bool _full_rebuild = true;
+    bool _incremental_intersections = false;
+    // input vertices whose grid-space position changed since the last bake
+    std::set<int> _moved_vertices;
 };
 }// namespace mandoline::construction
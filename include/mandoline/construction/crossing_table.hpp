@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <mtao/types.hpp>
+#include "mandoline/construction/vertex_types.hpp"
+
+
+namespace mandoline::construction {
+
+// Structure-of-arrays copy of a list of Crossings.
+// Crossing stores a variant of pointers into the per-facet intersection
+// containers, which costs a pointer chase and a variant dispatch every time
+// a coordinate or mask is queried. This table flattens the data that the
+// generator queries in its hot loops so it can be read contiguously.
+template<int D>
+struct CrossingTable {
+    //Definitions
+    using VType = Vertex<D>;
+    using Vec = typename VType::Vec;
+    using coord_type = typename VType::coord_type;
+    using MaskType = typename VType::MaskType;
+    // bit i is set if axis i is bound, D <= 8 always fits
+    using BitsType = uint8_t;
+    static_assert(D <= 8 * sizeof(BitsType));
+    enum class Kind : uint8_t { Vertex,
+                                EdgeIntersection,
+                                TriangleIntersection };
+
+    //Members
+    mtao::ColVectors<int, D> coords;
+    mtao::ColVectors<double, D> quots;
+    std::vector<BitsType> mask_bits;// axes with quot == 0, what Vertex::mask uses
+    std::vector<BitsType> clamped_bits;// Vertex::clamped_indices
+    std::vector<Kind> kinds;
+    // index of the input vertex, edge, or triangle that created the crossing
+    std::vector<int> parent_indices;
+    std::vector<int> indices;// the (fused) index of each crossing
+
+    //Constructors
+    CrossingTable() = default;
+    CrossingTable(const CrossingTable &) = default;
+    CrossingTable(CrossingTable &&) = default;
+    CrossingTable &operator=(const CrossingTable &) = default;
+    CrossingTable &operator=(CrossingTable &&) = default;
+    // vertex_base is the start of the input vertex array vertex crossings point into
+    CrossingTable(const std::vector<Crossing<D>> &crossings, const VType *vertex_base);
+
+    //Member functions
+    size_t size() const { return kinds.size(); }
+    bool empty() const { return kinds.empty(); }
+    void clear();
+    void resize(size_t size);
+    // returns a table of the rows in the order they are passed
+    CrossingTable gather(const std::vector<int> &rows) const;
+
+    coord_type coord(int row) const;
+    auto quot(int row) const { return quots.col(row); }
+    Vec point(int row) const;
+    MaskType mask(int row) const;
+    std::bitset<D> clamped_indices(int row) const { return std::bitset<D>(clamped_bits[row]); }
+    size_t clamped_count(int row) const { return clamped_indices(row).count(); }
+    bool is_grid_vertex(int row) const { return clamped_bits[row] == (1 << D) - 1; }
+    VType vertex(int row) const;
+
+    bool is_vertex(int row) const { return kinds[row] == Kind::Vertex; }
+    bool is_edge_intersection(int row) const { return kinds[row] == Kind::EdgeIntersection; }
+    bool is_triangle_intersection(int row) const { return kinds[row] == Kind::TriangleIntersection; }
+
+  private:
+    void set_row(int row, const Crossing<D> &crossing, const VType *vertex_base);
+    void copy_row(int row, const CrossingTable &o, int orow);
+};
+}// namespace mandoline::construction
+
+#include "mandoline/construction/crossing_table_impl.hpp"
@@ -0,0 +1,116 @@
+#pragma once
+#include "mandoline/construction/crossing_table.hpp"
+#include <type_traits>
+
+namespace mandoline::construction {
+
+template<int D>
+CrossingTable<D>::CrossingTable(const std::vector<Crossing<D>> &crossings, const VType *vertex_base) {
+    resize(crossings.size());
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < crossings.size(); ++i) {
+        set_row(i, crossings[i], vertex_base);
+    }
+}
+
+template<int D>
+void CrossingTable<D>::clear() {
+    resize(0);
+}
+
+template<int D>
+void CrossingTable<D>::resize(size_t size) {
+    coords.resize(D, size);
+    quots.resize(D, size);
+    mask_bits.resize(size);
+    clamped_bits.resize(size);
+    kinds.resize(size);
+    parent_indices.resize(size);
+    indices.resize(size);
+}
+
+template<int D>
+auto CrossingTable<D>::gather(const std::vector<int> &rows) const -> CrossingTable {
+    CrossingTable ret;
+    ret.resize(rows.size());
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < rows.size(); ++i) {
+        ret.copy_row(i, *this, rows[i]);
+    }
+    return ret;
+}
+
+template<int D>
+void CrossingTable<D>::set_row(int row, const Crossing<D> &crossing, const VType *vertex_base) {
+    const VType &v = crossing.vertex();
+    BitsType mask = 0;
+    BitsType clamped = 0;
+    for (int j = 0; j < D; ++j) {
+        coords(j, row) = v.coord[j];
+        quots(j, row) = v.quot(j);
+        mask |= BitsType(v.quot(j) == 0) << j;
+        clamped |= BitsType(v.clamped(j)) << j;
+    }
+    mask_bits[row] = mask;
+    clamped_bits[row] = clamped;
+    indices[row] = crossing.index;
+    std::visit([&](auto &&v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, VType const *>) {
+            kinds[row] = Kind::Vertex;
+            parent_indices[row] = vertex_base == nullptr ? -1 : std::distance(vertex_base, v);
+        } else if constexpr (std::is_same_v<T, EdgeIntersection<D> const *>) {
+            kinds[row] = Kind::EdgeIntersection;
+            parent_indices[row] = v->edge_index;
+        } else if constexpr (std::is_same_v<T, TriangleIntersection<D> const *>) {
+            kinds[row] = Kind::TriangleIntersection;
+            parent_indices[row] = v->triangle_index;
+        }
+    },
+               crossing.vv);
+}
+
+template<int D>
+void CrossingTable<D>::copy_row(int row, const CrossingTable &o, int orow) {
+    coords.col(row) = o.coords.col(orow);
+    quots.col(row) = o.quots.col(orow);
+    mask_bits[row] = o.mask_bits[orow];
+    clamped_bits[row] = o.clamped_bits[orow];
+    kinds[row] = o.kinds[orow];
+    parent_indices[row] = o.parent_indices[orow];
+    indices[row] = o.indices[orow];
+}
+
+template<int D>
+auto CrossingTable<D>::coord(int row) const -> coord_type {
+    coord_type c;
+    for (int j = 0; j < D; ++j) {
+        c[j] = coords(j, row);
+    }
+    return c;
+}
+
+template<int D>
+auto CrossingTable<D>::point(int row) const -> Vec {
+    return coords.col(row).template cast<double>() + quots.col(row);
+}
+
+template<int D>
+auto CrossingTable<D>::mask(int row) const -> MaskType {
+    MaskType m;
+    BitsType bits = mask_bits[row];
+    for (int j = 0; j < D; ++j) {
+        if (bits & (1 << j)) {
+            m.bind(j, coords(j, row));
+        }
+    }
+    return m;
+}
+
+template<int D>
+auto CrossingTable<D>::vertex(int row) const -> VType {
+    return VType(coord(row), quots.col(row), clamped_indices(row));
+}
+}// namespace mandoline::construction
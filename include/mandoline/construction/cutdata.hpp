@@ -6,6 +6,7 @@
 #include <mtao/geometry/mesh/boundary_elements.h>
 #include <mtao/geometry/mesh/boundary_facets.h>
 #include "mandoline/construction/facet_intersections.hpp"
+#include "mandoline/construction/crossing_table.hpp"
 #include <mtao/eigen/stack.h>
 #include <mtao/logging/timer.hpp>
 #include <mtao/logging/profiler.hpp>
@@ -47,12 +48,23 @@ struct CutData : public Indexer_ {
 
     void bake(const std::optional<SGType> &grid = {}, bool fuse = true);
     void clear();// clear intersections, useful if vertices changed position
+    // only clear the intersections of the listed edges and triangles, the rest are reused by the next bake
+    void clear(const std::set<int> &edges, const std::set<int> &triangles);
+    // when incremental the per-triangle cut faces are cached so clean triangles skip face collapsing on rebake
+    void set_incremental(bool incremental);
+    bool incremental() const { return m_incremental; }
     void reset();// reset internal data
     void reset_topology();// reset internal data
     void reset_intersections();
 
 
     const std::vector<Crossing<D>> &crossings() const;
+    // flat copy of crossings(), row i corresponds to crossings()[i]
+    const CrossingTable<D> &crossing_table() const { return m_crossing_table; }
+    // assigns fused indices to crossings that share a position, serially through an ordered map
+    void fuse_crossings_serial(std::vector<Crossing<D>> &crossings) const;
+    // same indices as the serial version, but the position lookup is sharded across threads
+    void fuse_crossings_parallel(std::vector<Crossing<D>> &crossings) const;
     std::set<Edge> stl_edges() const;
     mtao::ColVectors<int, 2> edges() const;
     std::vector<std::vector<int>> faces() const;
@@ -149,8 +161,14 @@ struct CutData : public Indexer_ {
     Faces m_FE;
     std::vector<EdgeIntersections<D>> m_edge_intersections;
     std::vector<TriangleIntersections<D>> m_triangle_intersections;
+    // facets whose intersections have to be recomputed by the next bake
+    std::vector<bool> m_dirty_edges;
+    std::vector<bool> m_dirty_triangles;
+    bool m_incremental = false;
+    std::vector<std::set<std::vector<const VType *>>> m_triangle_vptr_faces;
     //needs to be baked
     std::vector<Crossing<D>> m_crossings;
+    CrossingTable<D> m_crossing_table;
     std::map<const VType *, int> m_vertex_indexer;
     mtao::vector<CutMeshEdge<D>> m_cut_edges;
     mtao::vector<CutMeshFace<D>> m_cut_faces;
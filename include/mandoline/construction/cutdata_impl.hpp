@@ -3,6 +3,8 @@
 #include <map>
 #include <mtao/iterator/enumerate.hpp>
 #include <set>
+#include <unordered_map>
+#include <numeric>
 #include <tuple>
 #include <iostream>
 #include <thread>
@@ -90,10 +92,32 @@ void CutData<D, Indexer>::bake(const std::optional<SGType> &grid, bool fuse) {
 
             //auto t = mtao::logging::timer("data bake edges");
             auto t = mtao::logging::profiler("mesh edge intersections", false, "profiler");
+            std::vector<int> dirty;
+            for (int i = 0; i < m_edge_intersections.size(); i++) {
+                if (m_dirty_edges[i]) {
+                    dirty.emplace_back(i);
+                }
+            }
+            // the plane crossing parameters of the dirty edges are computed in batches of block_size edges,
+            // which are independent so the batches run in parallel
+            constexpr int block_size = 256;
+            std::vector<PlaneSweep<D>> sweeps(dirty.size());
             int i;
 #pragma omp parallel for
-            for (i = 0; i < m_edge_intersections.size(); i++) {
-                m_edge_intersections[i].bake(grid);
+            for (i = 0; i < dirty.size(); i++) {
+                sweeps[i] = m_edge_intersections[dirty[i]].plane_sweep();
+            }
+            const int block_count = (int(sweeps.size()) + block_size - 1) / block_size;
+            std::vector<PlaneCrossings> crossings(block_count);
+            int b;
+#pragma omp parallel for
+            for (b = 0; b < block_count; b++) {
+                const PlaneSweep<D> *begin = sweeps.data() + b * block_size;
+                crossings[b] = plane_crossings(begin, begin + std::min<int>(block_size, sweeps.size() - b * block_size));
+            }
+#pragma omp parallel for
+            for (i = 0; i < dirty.size(); i++) {
+                m_edge_intersections[dirty[i]].bake(grid, sweeps[i], crossings[i / block_size], i % block_size);
             }
         }
         if constexpr (D == 3) {
@@ -102,7 +126,9 @@ void CutData<D, Indexer>::bake(const std::optional<SGType> &grid, bool fuse) {
             int i;
 #pragma omp parallel for
             for (i = 0; i < m_triangle_intersections.size(); i++) {
-                m_triangle_intersections[i].bake(grid);
+                if (m_dirty_triangles[i]) {
+                    m_triangle_intersections[i].bake(grid);
+                }
             }
             //#pragma omp parallel
         }
@@ -111,6 +137,7 @@ void CutData<D, Indexer>::bake(const std::optional<SGType> &grid, bool fuse) {
             auto t = mtao::logging::profiler("mesh vertex unification", false, "profiler");
             m_crossings = compute_crossings();
             m_vertex_indexer = gv_index_map(m_crossings);
+            m_crossing_table = CrossingTable<D>(m_crossings, m_V.empty() ? nullptr : &m_V[0]);
         }
     }
 
@@ -259,14 +286,27 @@ void CutData<D, Indexer>::bake(const std::optional<SGType> &grid, bool fuse) {
             }
             if (!trivial) {
                 //
-                auto Fs = FI.faces(m_vertex_indexer);
+                std::set<std::vector<int>> Fs;
+                if (m_incremental) {
+                    auto &vptr_faces = m_triangle_vptr_faces[i];
+                    if (m_dirty_triangles[i] || vptr_faces.empty()) {
+                        vptr_faces = FI.vptr_faces();
+                    }
+                    Fs = FI.faces(vptr_faces, m_vertex_indexer);
+                } else {
+                    Fs = FI.faces(m_vertex_indexer);
+                }
                 assert(Fs.size() != 0);
                 for (auto &&F : Fs) {
                     add_face(fi_mask, F, FI.triangle_index);
                 }
+            } else if (m_incremental) {
+                m_triangle_vptr_faces[i].clear();
             }
         }
     }
+    std::fill(m_dirty_edges.begin(), m_dirty_edges.end(), false);
+    std::fill(m_dirty_triangles.begin(), m_dirty_triangles.end(), false);
 }
 
 template<int D, typename Indexer>
@@ -389,16 +429,46 @@ void CutData<D, Indexer>::update_grid(const Indexer &I) {
 template<int D, typename Indexer>
 void CutData<D, Indexer>::clear() {
     m_crossings.clear();
+    m_crossing_table.clear();
     m_vertex_indexer.clear();
     m_cut_faces.clear();
     m_cut_edges.clear();
     clean_edges();
     clean_triangles();
+    std::fill(m_dirty_edges.begin(), m_dirty_edges.end(), true);
+    std::fill(m_dirty_triangles.begin(), m_dirty_triangles.end(), true);
+}
+template<int D, typename Indexer>
+void CutData<D, Indexer>::clear(const std::set<int> &edges, const std::set<int> &triangles) {
+    m_crossings.clear();
+    m_crossing_table.clear();
+    m_vertex_indexer.clear();
+    m_cut_faces.clear();
+    m_cut_edges.clear();
+    for (int e : edges) {
+        m_edge_intersections[e].clear();
+        m_dirty_edges[e] = true;
+    }
+    for (int t : triangles) {
+        m_triangle_intersections[t].clear();
+        m_dirty_triangles[t] = true;
+    }
+}
+template<int D, typename Indexer>
+void CutData<D, Indexer>::set_incremental(bool incremental) {
+    m_incremental = incremental;
+    m_triangle_vptr_faces.clear();
+    if (m_incremental) {
+        // empty entries are recomputed on the next bake
+        m_triangle_vptr_faces.resize(m_triangle_intersections.size());
+    }
 }
 template<int D, typename Indexer>
 void CutData<D, Indexer>::reset() {
 
+    bool incremental = m_incremental;
     *this = CutData(static_cast<Indexer>(*this));// copy in case something weird happens with Indexer
+    m_incremental = incremental;
 }
 template<int D, typename Indexer>
 void CutData<D, Indexer>::reset_topology() {
@@ -423,6 +493,12 @@ void CutData<D, Indexer>::reset_intersections() {
     for (int i = 0; i < m_F.cols(); ++i) {
         m_triangle_intersections.emplace_back(m_V, m_F, m_E, m_FE, m_edge_intersections, i);
     }
+    m_dirty_edges.assign(m_edge_intersections.size(), true);
+    m_dirty_triangles.assign(m_triangle_intersections.size(), true);
+    m_triangle_vptr_faces.clear();
+    if (m_incremental) {
+        m_triangle_vptr_faces.resize(m_triangle_intersections.size());
+    }
 }
 
 template<int D, typename Indexer>
@@ -464,9 +540,6 @@ auto CutData<D, Indexer>::compute_crossings(bool fuse) const -> std::vector<Cros
     std::vector<Crossing<D>> ret;
     ret.resize(V.size() + E.size() + F.size());
 
-    std::map<VType, int> index_map;
-    std::vector<VType> gvs;
-
     int eoff = V.size();
     int foff = V.size() + E.size();
 
@@ -479,27 +552,18 @@ auto CutData<D, Indexer>::compute_crossings(bool fuse) const -> std::vector<Cros
     }
 
 
-    int count = grid_size();
     auto t = mtao::logging::timer("indexing crossings");
 
     if (fuse) {
-        int i;
-        //for(auto&& [i,v]: mtao::iterator::enumerate(V.size()+E.size(),F)) {
-        for (i = 0; i < ret.size(); ++i) {
-            auto &p = ret[i];
-            auto &gv = p.vertex();
-            if (gv.is_grid_vertex()) {
-                p.index = index_map[gv] = grid_index(gv);
-            } else {
-                {
-                    if (auto it = index_map.find(gv); it != index_map.end()) {
-                        p.index = it->second;
-                    } else {
-                        p.index = index_map[gv] = count++;
-                    }
-                }
-            }
+#ifdef MTAO_OPENMP
+        if (omp_get_max_threads() > 1) {
+            fuse_crossings_parallel(ret);
+        } else {
+            fuse_crossings_serial(ret);
         }
+#else
+        fuse_crossings_serial(ret);
+#endif
     } else {
         int i;
         for (i = 0; i < ret.size(); ++i) {
@@ -510,6 +574,129 @@ auto CutData<D, Indexer>::compute_crossings(bool fuse) const -> std::vector<Cros
     return ret;
 }
 template<int D, typename Indexer>
+void CutData<D, Indexer>::fuse_crossings_serial(std::vector<Crossing<D>> &crossings) const {
+    std::map<VType, int> index_map;
+    int count = grid_size();
+    int i;
+    for (i = 0; i < crossings.size(); ++i) {
+        auto &p = crossings[i];
+        auto &gv = p.vertex();
+        if (gv.is_grid_vertex()) {
+            p.index = index_map[gv] = grid_index(gv);
+        } else {
+            if (auto it = index_map.find(gv); it != index_map.end()) {
+                p.index = it->second;
+            } else {
+                p.index = index_map[gv] = count++;
+            }
+        }
+    }
+}
+
+namespace detail {
+    // hashes the same (coord, quot) key that Vertex::operator< compares on
+    template<int D>
+    struct VertexPositionHash {
+        size_t operator()(const Vertex<D> &v) const {
+            size_t h = 0;
+            auto combine = [&h](size_t v) {
+                h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            };
+            for (int j = 0; j < D; ++j) {
+                combine(std::hash<int>{}(v.coord[j]));
+            }
+            for (int j = 0; j < D; ++j) {
+                // adding 0. maps -0. to 0. so values that compare equal hash equally
+                combine(std::hash<double>{}(v.quot(j) + 0.));
+            }
+            return h;
+        }
+    };
+    template<int D>
+    struct VertexPositionEqual {
+        bool operator()(const Vertex<D> &a, const Vertex<D> &b) const {
+            return a.coord == b.coord && a.quot == b.quot;
+        }
+    };
+}// namespace detail
+
+// Produces exactly the same indices as fuse_crossings_serial.
+// Crossings are bucketed into shards by hash, each shard finds the first
+// occurrence of every position (and whether a grid vertex shares it) in
+// parallel, and a final linear pass hands out new indices in crossing order.
+template<int D, typename Indexer>
+void CutData<D, Indexer>::fuse_crossings_parallel(std::vector<Crossing<D>> &crossings) const {
+    constexpr static int SelfRepresentative = -1;
+    constexpr static int GridRepresentative = -2;
+    const int size = crossings.size();
+
+    using Hash = detail::VertexPositionHash<D>;
+    using Equal = detail::VertexPositionEqual<D>;
+    int shard_count = 1;
+#ifdef MTAO_OPENMP
+    shard_count = 4 * omp_get_max_threads();
+#endif
+
+    std::vector<int> shard(size);
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < size; ++i) {
+        shard[i] = Hash{}(crossings[i].vertex()) % shard_count;
+    }
+
+    // stable counting sort so every shard sees its crossings in order
+    std::vector<int> shard_offsets(shard_count + 1, 0);
+    for (int s : shard) {
+        shard_offsets[s + 1]++;
+    }
+    std::partial_sum(shard_offsets.begin(), shard_offsets.end(), shard_offsets.begin());
+    std::vector<int> sharded_indices(size);
+    {
+        std::vector<int> cursor(shard_offsets.begin(), shard_offsets.end() - 1);
+        for (i = 0; i < size; ++i) {
+            sharded_indices[cursor[shard[i]]++] = i;
+        }
+    }
+
+    // representative[i] is the first crossing with the same position,
+    // or a tag if i is first or a grid vertex at that position precedes it
+    std::vector<int> representative(size, SelfRepresentative);
+    int s;
+#pragma omp parallel for schedule(dynamic)
+    for (s = 0; s < shard_count; ++s) {
+        struct Entry {
+            int first;
+            bool has_grid_vertex;
+        };
+        std::unordered_map<VType, Entry, Hash, Equal> first_map;
+        first_map.reserve(shard_offsets[s + 1] - shard_offsets[s]);
+        for (int j = shard_offsets[s]; j < shard_offsets[s + 1]; ++j) {
+            int idx = sharded_indices[j];
+            auto &gv = crossings[idx].vertex();
+            bool is_grid = gv.is_grid_vertex();
+            if (auto [it, inserted] = first_map.try_emplace(gv, Entry{ idx, is_grid }); !inserted) {
+                auto &entry = it->second;
+                representative[idx] = entry.has_grid_vertex ? GridRepresentative : entry.first;
+                entry.has_grid_vertex |= is_grid;
+            }
+        }
+    }
+
+    int count = grid_size();
+    for (i = 0; i < size; ++i) {
+        auto &p = crossings[i];
+        auto &gv = p.vertex();
+        int rep = representative[i];
+        if (gv.is_grid_vertex() || rep == GridRepresentative) {
+            p.index = grid_index(gv);
+        } else if (rep == SelfRepresentative) {
+            p.index = count++;
+        } else {
+            p.index = crossings[rep].index;
+        }
+    }
+}
+template<int D, typename Indexer>
 auto CutData<D, Indexer>::vertex_crossings() const -> std::vector<Crossing<D>> {
     std::vector<Crossing<D>> ret;
     auto e = mtao::iterator::enumerate(m_V);
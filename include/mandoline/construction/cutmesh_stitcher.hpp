@@ -0,0 +1,89 @@
+#pragma once
+#include "mandoline/mesh3.hpp"
+#include "mandoline/adaptive_grid.hpp"
+#include <Eigen/Dense>
+#include <map>
+#include <tuple>
+
+
+namespace mandoline::construction {
+
+// Stitches cut-cell meshes that were built independently on blocks of a grid into a single mesh.
+// Every tile is a CutCellMesh<3> on a unit-spaced grid whose first cell sits at a global cell offset.
+// A tile only contributes the cells of the block it owns, the rest of the tile is a ghost layer that
+// lets the owned cells see their whole neighborhood. Geometry shared between blocks (vertices, faces
+// and edges that lie on a block boundary plane) is welded so every element appears once: vertices are
+// matched by the input element they come from and the grid planes they lie on, never by position.
+class CutCellMeshStitcher {
+  public:
+    using coord_type = std::array<int, 3>;
+    using GridDatab = mtao::geometry::grid::GridDataD<bool, 3>;
+    using StaggeredGrid = mtao::geometry::grid::StaggeredGrid3d;
+
+    struct Tile {
+        // global cell coordinate of the first cell of the tile's grid
+        coord_type offset = {};
+        // the half-open range of global cells this tile owns
+        coord_type begin = {};
+        coord_type end = {};
+        CutCellMesh<3> mesh;
+        // tile mesh vertex -> input vertex, -1 for vertices created by clipping the input to the tile
+        std::vector<int> vertices;
+        // tile mesh triangle -> input triangle
+        std::vector<int> triangles;
+        // barycentric coordinates of the corners of clipped tile triangles within their input triangle
+        std::map<int, Eigen::Matrix3d> clipped_triangles;
+        // tile input vertex created by clipping -> {a, b, t} if it lies at (1-t) a + t b on the input edge a < b
+        std::map<int, std::tuple<int, int, double>> clipped_vertices;
+        // cells of the owned block that are not cut, in owned-block coordinates
+        GridDatab exterior_mask;
+    };
+
+    CutCellMeshStitcher(const StaggeredGrid &grid, const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const coord_type &tile_shape, std::optional<int> adaptive_level = {});
+
+    // throws std::runtime_error if the pieces clipping made of an input triangle can't be merged back
+    // or a vertex on a block boundary can't be traced back to the input
+    void add_tile(const Tile &tile);
+    CutCellMesh<3> generate() const;
+
+  private:
+    bool is_seam(int axis, int coord) const;
+    bool is_owned(const Tile &tile, const coord_type &cell) const;
+    // {kind, element} of the input a tile vertex comes from: {0, input vertex}, {1, input edge} or
+    // {2, input triangle}, {-1, -1} for grid vertices
+    using VertexSource = std::array<int, 2>;
+    std::vector<VertexSource> vertex_sources(const Tile &tile, const std::vector<std::tuple<int, double, double>> &parent_edges) const;
+    int stitch_vertex(const Tile &tile, int index, const std::vector<VertexSource> &sources, std::vector<int> &vertex_map);
+    int weld_vertex(const Vertex<3> &v, const VertexSource &source);
+    // tile mesh edge -> {input edge, parameter along the input edge at the tile edge's first and second vertex},
+    // -1 for edges that clipping added across a triangle
+    std::vector<std::tuple<int, double, double>> edge_map(const Tile &tile) const;
+
+    StaggeredGrid m_grid;
+    int m_grid_vertex_size;
+    coord_type m_tile_shape;
+    std::optional<int> m_adaptive_level;
+    mtao::ColVecs3d m_origV;
+    mtao::ColVecs3i m_origF;
+    mtao::ColVecs2i m_origE;
+    std::map<std::array<int, 2>, int> m_edge_indices;
+
+    std::vector<Vertex<3>> m_cut_vertices;
+    std::vector<CutFace<3>> m_faces;
+    std::vector<CutCell> m_cells;
+    std::vector<CutEdge<3>> m_cut_edges;
+    std::map<int, InterpolatedEdge> m_mesh_cut_edges;
+    std::map<int, BarycentricTriangleFace> m_mesh_cut_faces;
+    std::array<std::set<int>, 3> m_axial_faces;
+    std::set<int> m_folded_faces;
+    // cells that are not cut, gathered from the owned blocks so exterior cubes can span blocks
+    GridDatab m_exterior_mask;
+
+    // only geometry on block boundaries can be generated by more than one tile, so only it is looked up.
+    // A seam vertex is the crossing of its input element with the grid planes it lies on:
+    // {kind, element, bitmask of the planes' axes, plane coordinates (0 for the other axes)}
+    std::map<std::tuple<int, int, int, coord_type>, int> m_seam_vertices;
+    std::map<std::vector<int>, int> m_seam_faces;
+    std::set<std::array<int, 2>> m_seam_edges;
+};
+}// namespace mandoline::construction
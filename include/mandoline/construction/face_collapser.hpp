@@ -5,7 +5,9 @@
 #include <array>
 #include <tuple>
 #include <numeric>
+#include <stdexcept>
 #include <map>
+#include <memory_resource>
 #include <set>
 #include <vector>
 #include <mtao/data_structures/disjoint_set.hpp>
@@ -22,13 +24,28 @@ struct FaceCollapser {
     using Edge = std::array<int, 2>;
     using coord_type = std::array<int, 3>;
     //FaceCollapser(const std::map<int,std::set<std::vector<int>>>& faces);
-    FaceCollapser(const std::set<Edge> &edges);
-    FaceCollapser(const mtao::ColVecs2i &edges);
-
-
-    // reinterpret undirected edge graph as a sparse adjacency map
-    // simultaneously this of course gives one ring neighborhoods
-    std::map<int, std::set<int>> collect_edges() const;
+    // flat stores the edge graph in sorted arrays (with a CSR one-ring) rather than trees,
+    // which avoids an allocation per edge. outputs are identical in both modes
+    // the flat arrays are allocated from resource, e.g a ScratchArena::Scope's
+    FaceCollapser(const std::set<Edge> &edges, bool flat = false, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    FaceCollapser(const mtao::ColVecs2i &edges, bool flat = false, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+
+    // one ring neighborhoods in CSR form: the neighbors of vertices[i] are neighbors[offsets[i],offsets[i+1]),
+    // vertices and each neighborhood are sorted
+    struct OneRings {
+        OneRings(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : vertices(resource), offsets(resource), neighbors(resource) {}
+        int size() const { return vertices.size(); }
+        bool operator==(const OneRings &o) const { return vertices == o.vertices && offsets == o.offsets && neighbors == o.neighbors; }
+
+        std::pmr::vector<int> vertices;
+        std::pmr::vector<int> offsets;
+        std::pmr::vector<int> neighbors;
+    };
+    // reinterpret undirected edge graph as a sparse adjacency structure
+    // simultaneously this of course gives one ring neighborhoods.
+    // In flat mode this is a copy of the flat arrays, allocated from the collapser's resource
+    OneRings collect_edges() const;
 
     int dual_face(Edge e) const;
     int face(const Edge &e) const;
@@ -74,15 +91,40 @@ struct FaceCollapser {
     // indicate that a single directed edges in on the outside
     void set_edge_for_removal(const Edge &e);
 
-    const std::map<Edge, std::tuple<int, bool>> &edge_to_face() const { return m_edge_to_face; }
+    // in flat mode this map is materialized on every call
+    const std::map<Edge, std::tuple<int, bool>> &edge_to_face() const;
+    bool flat() const { return m_flat; }
 
   private:
+    // sorts the one ring of a around a by angle
+    template<typename Derived>
+    std::vector<int> ordered_one_ring(const Eigen::MatrixBase<Derived> &V, int a, const std::vector<int> &indices, const std::map<Edge, std::tuple<int, bool>> &cut_parent_map, const mtao::ColVecs2d &T) const;
+    // populates the flat containers from a list of directed edges and the face they are assigned
+    void set_flat_edges(std::pmr::vector<std::tuple<Edge, int, bool>> &&edges);
+    // index of a directed edge in the flat edge list, -1 if it does not exist
+    int flat_edge_index(const Edge &e) const;
+    // walks the loops of the dual edge graph, calls f(face, loop) for each loop of a non-removed face
+    template<typename Func>
+    void flat_loops(Func &&f) const;
+
     // a directed edge maps to a face identity and whether this is the same order as the input
     std::map<Edge, std::tuple<int, bool>> m_edge_to_face;
     // structure for combining face identities
     mtao::data_structures::DisjointSet<int> face_ds;
     // face to face map
     std::map<Edge, Edge> dual_edge_graph;
+
+    bool m_flat = false;
+    // lexicographically sorted directed edges and the face/sign of each one
+    std::pmr::vector<Edge> m_flat_edges;
+    std::pmr::vector<std::tuple<int, bool>> m_flat_edge_faces;
+    // the edges leaving m_flat_vertices[i] are [m_flat_offsets[i],m_flat_offsets[i+1])
+    std::pmr::vector<int> m_flat_vertices;
+    std::pmr::vector<int> m_flat_offsets;
+    // flat version of dual_edge_graph, the next edge index of each edge or -1
+    std::pmr::vector<int> m_flat_dual_edges;
+    // filled by edge_to_face() in flat mode
+    mutable std::map<Edge, std::tuple<int, bool>> m_flat_edge_to_face_cache;
 };
 
 template<typename Derived>
@@ -96,63 +138,45 @@ void FaceCollapser::bake(const Eigen::MatrixBase<Derived> &V, bool nonsimple_fac
 }
 template<typename Derived>
 void FaceCollapser::unify_boundary_loops(const Eigen::MatrixBase<Derived> &V, const std::map<Edge, std::tuple<int, bool>> &cut_parent_map, const mtao::ColVecs2d &T) {
-    const bool use_parent_tangents = cut_parent_map.size() > 0 && T.size() > 0;
     // for each neighorhood
-
-    for (auto [a, bs] : collect_edges()) {
-
-        // sort indices by quadrant and cross product
-        std::vector<int> indices(bs.begin(), bs.end());
-        mtao::ColVecs2d D(2, bs.size());
-        if (use_parent_tangents) {
-            auto va = V.col(a);
-            for (auto [i, j] : mtao::iterator::enumerate(indices)) {
-                std::array<int, 2> e{ { a, j } };
-
-                bool eidx_flip = e[0] > e[1];
-                if (eidx_flip) {
-                    std::swap(e[0], e[1]);
-                }
-                auto [parent_eid, flip_sgn] = cut_parent_map.at(e);
-                auto t = T.col(parent_eid);
-                D.col(i) = (flip_sgn ^ eidx_flip ? -1 : 1) * t;
-                //std::cout << (V.col(j) - va).transpose() << " == " << D.col(i).transpose() << std::endl;
+    if (m_flat) {
+        m_flat_dual_edges.assign(m_flat_edges.size(), -1);
+        std::vector<int> indices;
+        for (int vidx = 0; vidx < int(m_flat_vertices.size()); ++vidx) {
+            const int a = m_flat_vertices[vidx];
+            const int begin = m_flat_offsets[vidx];
+            const int end = m_flat_offsets[vidx + 1];
+            indices.resize(end - begin);
+            for (int j = begin; j < end; ++j) {
+                indices[j - begin] = m_flat_edges[j][1];
             }
-
-        } else {
-            auto va = V.col(a);
-            for (auto [i, j] : mtao::iterator::enumerate(indices)) {
-                D.col(i) = V.col(j) - va;
+            auto ordered_indices = ordered_one_ring(V, a, indices, cut_parent_map, T);
+            auto it = ordered_indices.begin();
+            auto it1 = it;
+            it1++;
+            for (; it != ordered_indices.end(); ++it, ++it1) {
+                if (it1 == ordered_indices.end()) {
+                    it1 = ordered_indices.begin();
+                }
+                Edge e{ { *it1, a } };
+                // the outgoing edges of a are contiguous and sorted by their second vertex
+                int eidx = flat_edge_index(e);
+                int neidx = std::lower_bound(m_flat_edges.begin() + begin, m_flat_edges.begin() + end, Edge{ { a, *it } }) - m_flat_edges.begin();
+                if (eidx < 0) {
+                    throw std::out_of_range("FaceCollapser: edge without a dual");
+                }
+                face_ds.join(std::get<0>(m_flat_edge_faces[eidx]), std::get<0>(m_flat_edge_faces[neidx]));
+                m_flat_dual_edges[eidx] = neidx;
             }
         }
-        std::vector<char> quadrants(bs.size());
-        constexpr static std::array<int, 4> __quadrants{ { 4, 1, 3, 2 } };
-        for (int i = 0; i < bs.size(); ++i) {
-            auto b = D.col(i);
-            // ++ +- -+ -- => 1 4 2 3
-            quadrants[i] = __quadrants[2 * std::signbit(b.y()) + std::signbit(b.x())];
-        }
-        // sort by quadrant and then by cross product volume
-        auto comp = [&](int ai, int bi) -> bool {
-            const char qa = quadrants[ai];
-            const char qb = quadrants[bi];
-            if (qa == qb) {
-                auto a = D.col(ai);
-                auto b = D.col(bi);
-                return b.x() * a.y() < a.x() * b.y();
-            } else {
-                return qa < qb;
-            }
-        };
-        // we need to sort D and quadrants simultaneously, easier to just sort
-        // indices into both.
-        std::vector<int> ordered_indices(bs.size());
-        // spit the initial indices of indices configuration
-        std::iota(ordered_indices.begin(), ordered_indices.end(), 0);
-        // sort the indices of indices
-        std::sort(ordered_indices.begin(), ordered_indices.end(), comp);
-        // dereference the indices of indices
-        std::transform(ordered_indices.begin(), ordered_indices.end(), ordered_indices.begin(), [&](int idx) -> int { return indices[idx]; });
+        return;
+    }
+
+    auto rings = collect_edges();
+    for (int vidx = 0; vidx < rings.size(); ++vidx) {
+        const int a = rings.vertices[vidx];
+        std::vector<int> indices(rings.neighbors.begin() + rings.offsets[vidx], rings.neighbors.begin() + rings.offsets[vidx + 1]);
+        auto ordered_indices = ordered_one_ring(V, a, indices, cut_parent_map, T);
         auto it = ordered_indices.begin();
         auto it1 = it;
         it1++;
@@ -170,6 +194,95 @@ void FaceCollapser::unify_boundary_loops(const Eigen::MatrixBase<Derived> &V, co
     }
 }
 
+template<typename Derived>
+std::vector<int> FaceCollapser::ordered_one_ring(const Eigen::MatrixBase<Derived> &V, int a, const std::vector<int> &indices, const std::map<Edge, std::tuple<int, bool>> &cut_parent_map, const mtao::ColVecs2d &T) const {
+    const bool use_parent_tangents = cut_parent_map.size() > 0 && T.size() > 0;
+    const int size = indices.size();
+    // sort indices by quadrant and cross product
+    mtao::ColVecs2d D(2, size);
+    if (use_parent_tangents) {
+        for (auto [i, j] : mtao::iterator::enumerate(indices)) {
+            std::array<int, 2> e{ { a, j } };
+
+            bool eidx_flip = e[0] > e[1];
+            if (eidx_flip) {
+                std::swap(e[0], e[1]);
+            }
+            auto [parent_eid, flip_sgn] = cut_parent_map.at(e);
+            auto t = T.col(parent_eid);
+            D.col(i) = (flip_sgn ^ eidx_flip ? -1 : 1) * t;
+        }
+
+    } else {
+        auto va = V.col(a);
+        for (auto [i, j] : mtao::iterator::enumerate(indices)) {
+            D.col(i) = V.col(j) - va;
+        }
+    }
+    std::vector<char> quadrants(size);
+    constexpr static std::array<int, 4> __quadrants{ { 4, 1, 3, 2 } };
+    for (int i = 0; i < size; ++i) {
+        auto b = D.col(i);
+        // ++ +- -+ -- => 1 4 2 3
+        quadrants[i] = __quadrants[2 * std::signbit(b.y()) + std::signbit(b.x())];
+    }
+    // sort by quadrant and then by cross product volume
+    auto comp = [&](int ai, int bi) -> bool {
+        const char qa = quadrants[ai];
+        const char qb = quadrants[bi];
+        if (qa == qb) {
+            auto a = D.col(ai);
+            auto b = D.col(bi);
+            return b.x() * a.y() < a.x() * b.y();
+        } else {
+            return qa < qb;
+        }
+    };
+    // we need to sort D and quadrants simultaneously, easier to just sort
+    // indices into both.
+    std::vector<int> ordered_indices(size);
+    // spit the initial indices of indices configuration
+    std::iota(ordered_indices.begin(), ordered_indices.end(), 0);
+    // sort the indices of indices
+    std::sort(ordered_indices.begin(), ordered_indices.end(), comp);
+    // dereference the indices of indices
+    std::transform(ordered_indices.begin(), ordered_indices.end(), ordered_indices.begin(), [&](int idx) -> int { return indices[idx]; });
+    return ordered_indices;
+}
+
+template<typename Func>
+void FaceCollapser::flat_loops(Func &&f) const {
+    // mirrors the tree based loop walk in faces(), but edges are referred to by their index
+    const int size = m_flat_dual_edges.size();
+    std::pmr::vector<char> available_edges(size, 0, m_flat_edges.get_allocator());
+    for (int idx = 0; idx < size; ++idx) {
+        available_edges[idx] = m_flat_dual_edges[idx] >= 0;
+    }
+    auto inc = [&](int idx) { return idx < 0 ? -1 : m_flat_dual_edges[idx]; };
+    std::vector<int> loop;
+    for (int it = 0; it < size; ++it) {
+        if (!available_edges[it]) {
+            continue;
+        }
+        int myface = std::get<0>(m_flat_edge_faces[it]);
+        if (myface < 0) {
+            available_edges[it] = 0;
+            continue;
+        }
+        loop.clear();
+        loop.push_back(m_flat_edges[it][0]);
+        available_edges[it] = 0;
+
+        int it1 = inc(it);
+        int it2 = inc(inc(it));
+        for (; it1 >= 0 && it1 != it && it1 != it2; it1 = inc(it1), it2 = inc(inc(it2))) {
+            available_edges[it1] = 0;
+            loop.push_back(m_flat_edges[it1][0]);
+        }
+        f(myface, loop);
+    }
+}
+
 template<typename Derived>
 void FaceCollapser::merge_faces(const Eigen::MatrixBase<Derived> &V) {
     spdlog::debug("FaceCollapser merging faces");
@@ -241,12 +354,18 @@ void FaceCollapser::merge_faces(const Eigen::MatrixBase<Derived> &V) {
             reindexer[ds.node(i).data] = reindexer.size() - 1;
         }
     }
-    for (auto &&[e, pr] : m_edge_to_face) {
-        auto &&[a, b] = e;
+    auto reindex = [&](auto &&pr) {
         auto &&[c, s] = pr;
 
         int root = ds.get_root(c).data;
         c = reindexer[root];
+    };
+    if (m_flat) {
+        std::for_each(m_flat_edge_faces.begin(), m_flat_edge_faces.end(), reindex);
+    } else {
+        for (auto &&[e, pr] : m_edge_to_face) {
+            reindex(pr);
+        }
     }
 }
 template<typename Derived>
@@ -254,7 +373,7 @@ std::map<int, typename Derived::Scalar> FaceCollapser::volumes(const Eigen::Matr
     std::map<int, typename Derived::Scalar> ret;
     using Scalar = typename Derived::Scalar;
 
-    for (auto &&[e, fip] : m_edge_to_face) {
+    auto add = [&](const Edge &e, const std::tuple<int, bool> &fip) {
         auto [fidx, sgn] = fip;
 
         mtao::SquareMatrix<Scalar, 2> M;
@@ -266,6 +385,15 @@ std::map<int, typename Derived::Scalar> FaceCollapser::volumes(const Eigen::Matr
         if (!in) {
             it->second += val;
         }
+    };
+    if (m_flat) {
+        for (size_t idx = 0; idx < m_flat_edges.size(); ++idx) {
+            add(m_flat_edges[idx], m_flat_edge_faces[idx]);
+        }
+    } else {
+        for (auto &&[e, fip] : m_edge_to_face) {
+            add(e, fip);
+        }
     }
     for (auto &&[fidx, val] : ret) {
         val /= Scalar(2);
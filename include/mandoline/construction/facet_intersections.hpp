@@ -15,6 +15,8 @@
 #include "mandoline/cutface.hpp"
 #include <mtao/geometry/mesh/halfedge.hpp>
 #include "mandoline/construction/face_collapser.hpp"
+#include "mandoline/construction/scratch_arena.hpp"
+#include "mandoline/construction/plane_crossing_kernel.hpp"
 
 
 namespace mandoline::construction {
@@ -105,6 +107,10 @@ struct EdgeIntersections : public IntersectionsBase<D, EdgeIntersections<D>> {
     }
     EdgeIntersections(const VType &a, const VType &b, int index = -1) : EdgeIntersections(VPtrEdge{ { &a, &b } }, index) {}
     void bake(const std::optional<SGType> &grid = {});
+    // the grid planes this edge can cross, used to batch the crossing computation over many edges
+    PlaneSweep<D> plane_sweep() const;
+    // bakes with crossings precomputed for sweep, which are the index'th edge of crossings
+    void bake(const std::optional<SGType> &grid, const PlaneSweep<D> &sweep, const PlaneCrossings &crossings, int index);
 
     bool is_cut() const { return intersections.empty(); }
 
@@ -442,6 +448,8 @@ struct TriangleIntersections : public IntersectionsBase<D, TriangleIntersections
 
     std::set<std::vector<const VType *>> vptr_faces() const;
     std::set<std::vector<int>> faces(const std::map<const VType *, int> &indexer) const;
+    // reindexes faces previously returned by vptr_faces
+    static std::set<std::vector<int>> faces(const std::set<std::vector<const VType *>> &vptr_faces, const std::map<const VType *, int> &indexer);
 
     TriIsect from_coord(const Vec &B) const {
         VType gv = B(0) * *vptr_tri[0] + B(1) * *vptr_tri[1] + B(2) * *vptr_tri[2];
@@ -1,25 +1,20 @@
 #pragma once
 #include "mandoline/construction/facet_intersections.hpp"
+#include <algorithm>
 #include <set>
+#include <tuple>
 
 namespace mandoline::construction {
 template<int D>
-void EdgeIntersections<D>::bake(const std::optional<SGType> &grid) {
-    intersections.clear();
-
+PlaneSweep<D> EdgeIntersections<D>::plane_sweep() const {
     using namespace mtao::eigen;
-    using Veci = mtao::Vector<int, D>;
     auto &gvstart = *vptr_edge[0];
     auto &gvend = *vptr_edge[1];
 
-    //std::cout << "Edge intersections " ;
-    //std::cout << std::string(gvstart) << " => " << std::string(gvend) << std::endl;
-
-    mtao::eigen::stl2eigen(tangent) = gvend.p() - gvstart.p();
-
+    PlaneSweep<D> sweep;
     //normalize and move to the upper left quadrant
     Vec direction = gvend.p() - gvstart.p();
-    std::bitset<D> reflection_bs;
+    std::bitset<D> &reflection_bs = sweep.reflection;
     for (int i = 0; i < D; ++i) {
         auto &&sc = gvstart.coord[i];
         auto &&ec = gvend.coord[i];
@@ -57,12 +52,38 @@ void EdgeIntersections<D>::bake(const std::optional<SGType> &grid) {
         return gv;
     });
 
-    Veci begin = stl2eigen(gvsr[0].coord) + gvsr[0].quot.array().ceil().template cast<int>().matrix();
-    Veci end = stl2eigen(gvsr[1].coord) + gvsr[1].quot.array().floor().template cast<int>().matrix();
+    stl2eigen(sweep.begin) = stl2eigen(gvsr[0].coord) + gvsr[0].quot.array().ceil().template cast<int>().matrix();
+    stl2eigen(sweep.end) = stl2eigen(gvsr[1].coord) + gvsr[1].quot.array().floor().template cast<int>().matrix();
+
+    stl2eigen(sweep.dir) = direction.array().abs().matrix();
+    for (int d = 0; d < D; ++d) {
+        double sq = gvsr[0].quot(d);
+        sweep.offset[d] = std::ceil(sq) - sq;
+    }
+    return sweep;
+}
+
+template<int D>
+void EdgeIntersections<D>::bake(const std::optional<SGType> &grid) {
+    PlaneSweep<D> sweep = plane_sweep();
+    PlaneCrossings crossings;
+    append_plane_crossings(sweep, crossings);
+    bake(grid, sweep, crossings, 0);
+}
+
+template<int D>
+void EdgeIntersections<D>::bake(const std::optional<SGType> &grid, const PlaneSweep<D> &sweep, const PlaneCrossings &crossings, int index) {
+    intersections.clear();
+
+    auto &gvstart = *vptr_edge[0];
+    auto &gvend = *vptr_edge[1];
 
+    //std::cout << "Edge intersections " ;
+    //std::cout << std::string(gvstart) << " => " << std::string(gvend) << std::endl;
 
-    auto Dir = direction.array().abs().eval();
+    mtao::eigen::stl2eigen(tangent) = gvend.p() - gvstart.p();
 
+    const std::bitset<D> &reflection_bs = sweep.reflection;
 
     std::set<EdgeIsect> T;
     std::array<std::map<coord_mask<D>, std::set<EdgeIsect>>, D> edges;
@@ -78,79 +99,71 @@ void EdgeIntersections<D>::bake(const std::optional<SGType> &grid) {
                || (vertex_masks[1] & m).active();
     };
 
-    for (int d = 0; d < D; ++d) {
-        int b = begin(d);
-        int e = end(d);
-        double dir = Dir(d);
-        if (dir == 0) continue;
-        double sq = gvsr[0].quot(d);
-        double offset = std::ceil(sq) - sq;
-        for (int i = 0; i <= e - b; ++i) {
-
-            double t = (offset + i) / dir;
-            if (t <= 0 || t >= 1) {
-                continue;
-            }
-
-            VType np = gvstart * (1 - t) + gvend * t;
-            //VType np = gvstart +  ( gvend - gvstart  ) * t;
-            {
-                auto M = mask();
-                M.clamp(np);
-            }
+    // the crossings come ordered by axis then plane, in the order the per axis loop used to visit them
+    for (int c = crossings.offsets[index]; c < crossings.offsets[index + 1]; ++c) {
+        const int d = crossings.axes[c];
+        const int i = crossings.steps[c];
+        const int b = sweep.begin[d];
+        const double t = crossings.ts[c];
+
+        VType np = gvstart * (1 - t) + gvend * t;
+        //VType np = gvstart +  ( gvend - gvstart  ) * t;
+        {
+            auto M = mask();
+            M.clamp(np);
+        }
 
-            int abs_grid = i + b;
-            np.coord[d] = abs_grid;
-            np.quot(d) = 0;
-            np.clamped_indices[d] = true;
-            if (reflection_bs[d]) {
-                if (abs_grid <= 0) {
-                    np.coord[d] = -abs_grid;
-                } else {
-                    np.coord[d] = -abs_grid;
-                }
+        int abs_grid = i + b;
+        np.coord[d] = abs_grid;
+        np.quot(d) = 0;
+        np.clamped_indices[d] = true;
+        if (reflection_bs[d]) {
+            if (abs_grid <= 0) {
+                np.coord[d] = -abs_grid;
+            } else {
+                np.coord[d] = -abs_grid;
             }
+        }
 
-            mask().clamp(np);
+        mask().clamp(np);
 
-            EdgeIsect sect{ np, t, edge_index };
+        EdgeIsect sect{ np, t, edge_index };
 
-            //sect.apply_thresholding();
-            {
-                auto M = mask();
-                for (int i = 0; i < D; ++i) {
-                    if (!M[i]) {
-                        if (gvstart.coord[i] == gvend.coord[i]) {
-                            np.clamped_indices[i] = {};
-                        }
+        //sect.apply_thresholding();
+        {
+            auto M = mask();
+            for (int i = 0; i < D; ++i) {
+                if (!M[i]) {
+                    if (gvstart.coord[i] == gvend.coord[i]) {
+                        np.clamped_indices[i] = {};
                     }
                 }
             }
-            auto mask = sect.mask();
-            if (grid) {
-                //auto g = grid->template grid<D-1>(D==2?(1-d):d);
-                auto g = grid->cell_shape();
-                bool valid = true;
-                for (int i = 0; i < D; ++i) {
-                    int idx = np.coord[i];
-                    int q = np.quot(i);
-                    if (!(i >= 0 || i < g[i] || (i == g[i] && q == 0))) {
-                        valid = false;
-                        break;
-                    }
-                }
-                if (invalid_isect(sect)) {
+        }
+        auto mask = sect.mask();
+        if (grid) {
+            //auto g = grid->template grid<D-1>(D==2?(1-d):d);
+            auto g = grid->cell_shape();
+            bool valid = true;
+            for (int i = 0; i < D; ++i) {
+                int idx = np.coord[i];
+                int q = np.quot(i);
+                if (!(i >= 0 || i < g[i] || (i == g[i] && q == 0))) {
                     valid = false;
+                    break;
                 }
-                if (valid) {
-                    //if(g.valid_index(np.coord)) {
-                    //if(grid->template grid<D-1>(d).valid_index(np.coord)) {
-                    //if(grid->template grid<1>(d).valid_index(np.coord)) {
-                    edges[mask.count() - 1][mask].emplace(sect);
-                }
-            } else {
+            }
+            if (invalid_isect(sect)) {
+                valid = false;
+            }
+            if (valid) {
+                //if(g.valid_index(np.coord)) {
+                //if(grid->template grid<D-1>(d).valid_index(np.coord)) {
+                //if(grid->template grid<1>(d).valid_index(np.coord)) {
                 edges[mask.count() - 1][mask].emplace(sect);
             }
+        } else {
+            edges[mask.count() - 1][mask].emplace(sect);
         }
     }
 
@@ -164,7 +177,7 @@ void EdgeIntersections<D>::bake(const std::optional<SGType> &grid) {
                 for (int k = 0; k < D; ++k) {
                     if (c[k]) {
                         coord_mask<D> m = c;
-                        m[k] = {};
+                        m.unbind(k);
                         if (auto it = Ei.find(m); it != Ei.end()) {
                             auto &o = it->second;
                             std::transform(o.begin(), o.end(), std::inserter(es, es.end()), [&](EdgeIsect isect) -> EdgeIsect {
@@ -240,14 +253,14 @@ template<int D>
 void TriangleIntersections<D>::bake(const std::optional<SGType> &grid) {
 
     edge_intersections.clear();
-    //per axis, per plane, set of intersections
-    std::array<std::map<int, std::set<std::tuple<const VType *, int>>>, D> bins;
+    // {axis, plane, vertex, edge or -1 - triangle vertex} for every vertex on a grid plane.
+    // sorted so the vertices of each plane are contiguous
+    std::vector<std::tuple<int, int, const VType *, int>> bins;
     std::map<const VType *, std::array<double, 3>> coords;
     auto bin_gv = [&](const VType &gv, int v) {
         for (int i = 0; i < D; ++i) {
             if (gv.clamped(i)) {
-                auto &bin = bins[i];
-                bin[gv.coord[i]].insert({ &gv, v });
+                bins.emplace_back(i, gv.coord[i], &gv, v);
             }
         }
     };
@@ -269,37 +282,39 @@ void TriangleIntersections<D>::bake(const std::optional<SGType> &grid) {
         coords[gv] = coord;
         vertex_ptrs.insert(gv);
     }
-    //std::cout << std::endl;
-    int count = 0;
-    for (auto &&[dim, bin] : mtao::iterator::enumerate(bins)) {
-        //std::cout << "Dim " << dim << std::endl;
-        for (auto &&[coord, gvs] : bin) {
-            //std::cout << "Coord " << coord <<  ": ";
-            int vertex_count = 0;
-            for (auto &&[v, i] : gvs) {
-                //std::cout << std::string(*v) << ", ";
-                if (i < 0) {
-                    vertex_count++;
-                }
-            }
-            //std::cout << std::endl;
-            if (vertex_count == 2) {
-                continue;
-            }
-            if (gvs.size() == 2) {
-                count += gvs.size();
-                VPtrEdge gvpe;
-                std::transform(gvs.begin(), gvs.end(), gvpe.begin(), [](auto &&pr) { return std::get<0>(pr); });
-                //make sure we're not dealing with two vertices
-                if (vertex_ptrs.find(gvpe[0]) == vertex_ptrs.end() || vertex_ptrs.find(gvpe[1]) == vertex_ptrs.end()) {
-                    EdgeIntersections<D> eis(gvpe);
-                    eis.bake(grid);
-
-                    edge_intersections.emplace(gvpe, std::move(eis));
+    std::sort(bins.begin(), bins.end());
+    bins.erase(std::unique(bins.begin(), bins.end()), bins.end());
+
+    // a plane through two boundary vertices cuts the triangle along an interior edge.
+    // the plane crossings of all of the interior edges are computed in one batch
+    std::vector<EdgeIntersections<D>> interior_edges;
+    std::set<VPtrEdge> interior_vptr_edges;
+    for (auto begin = bins.begin(); begin != bins.end();) {
+        auto end = std::find_if(begin, bins.end(), [&](auto &&b) {
+            return std::get<0>(b) != std::get<0>(*begin) || std::get<1>(b) != std::get<1>(*begin);
+        });
+        int vertex_count = std::count_if(begin, end, [](auto &&b) { return std::get<3>(b) < 0; });
+        if (vertex_count != 2 && end - begin == 2) {
+            VPtrEdge gvpe{ { std::get<2>(*begin), std::get<2>(*(begin + 1)) } };
+            //make sure we're not dealing with two vertices
+            if (vertex_ptrs.find(gvpe[0]) == vertex_ptrs.end() || vertex_ptrs.find(gvpe[1]) == vertex_ptrs.end()) {
+                if (interior_vptr_edges.insert(gvpe).second) {
+                    interior_edges.emplace_back(gvpe);
                 }
             }
         }
-        //std::cout << std::endl;
+        begin = end;
+    }
+    std::vector<PlaneSweep<D>> sweeps(interior_edges.size());
+    std::transform(interior_edges.begin(), interior_edges.end(), sweeps.begin(), [](const EdgeIntersections<D> &eis) {
+        return eis.plane_sweep();
+    });
+    PlaneCrossings crossings = plane_crossings(sweeps);
+    for (size_t j = 0; j < interior_edges.size(); ++j) {
+        auto &&eis = interior_edges[j];
+        eis.bake(grid, sweeps[j], crossings, j);
+        VPtrEdge gvpe = eis.vptr_edge;
+        edge_intersections.emplace(gvpe, std::move(eis));
     }
 
     intersections.clear();
@@ -392,7 +407,7 @@ std::array<
             for (int k = 0; k < D; ++k) {
                 if (c[k]) {
                     coord_mask<D> m = c;
-                    m[k] = {};
+                    m.unbind(k);
                     if (auto it = Vi.find(m); it != Vi.end()) {
                         auto &o = it->second;
                         std::transform(o.begin(), o.end(), std::inserter(vs, vs.end()), [&](auto a) {
@@ -480,7 +495,9 @@ auto TriangleIntersections<D>::vptr_faces() const -> std::set<std::vector<const
     //}
     //std::cout << std::endl;
     //std::set<Edge> Es(Evec.begin(),Evec.end());
-    FaceCollapser fc(Es);
+    // the collapser only lives as long as this triangle
+    ScratchArena::Scope scratch;
+    FaceCollapser fc(Es, true, scratch.resource());
     Edge be = boundary_edge(VM);
     fc.set_edge_for_removal(be);
 
@@ -505,7 +522,11 @@ auto TriangleIntersections<D>::vptr_faces() const -> std::set<std::vector<const
 
 template<int D>
 std::set<std::vector<int>> TriangleIntersections<D>::faces(const std::map<const VType *, int> &indexer) const {
-    auto ptrf = vptr_faces();
+    return faces(vptr_faces(), indexer);
+}
+
+template<int D>
+std::set<std::vector<int>> TriangleIntersections<D>::faces(const std::set<std::vector<const VType *>> &ptrf, const std::map<const VType *, int> &indexer) {
     std::set<std::vector<int>> ret;
     std::transform(ptrf.begin(), ptrf.end(), std::inserter(ret, ret.end()), [&](auto &&ptrvec) {
         std::vector<int> vec(ptrvec.size());
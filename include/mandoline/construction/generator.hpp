@@ -11,6 +11,8 @@
 #include <map>
 #include <set>
 #include "mandoline/construction/cutdata.hpp"
+#include "mandoline/construction/cell_bitmask.hpp"
+#include "mandoline/construction/grid_line_crossings.hpp"
 #include "mandoline/cutface.hpp"
 #include <iterator>
 #include <mtao/geometry/mesh/halfedge.hpp>
@@ -82,6 +84,10 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
 
 
     virtual void clear();
+    // clears like clear() but keeps the mesh intersections of every edge and triangle not listed
+    void clear_intersections(const std::set<int> &edges, const std::set<int> &triangles);
+    // cache per-triangle data between bakes so clear_intersections rebakes are cheaper
+    void set_incremental(bool incremental) { m_data.set_incremental(incremental); }
 
     CutCellMesh<D> generate_vertices() const;// generate the initial mesh object
     CutCellMesh<D> generate_edges() const;// generate the edges on top of vertices
@@ -167,7 +173,7 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
         if (idx < gvs) {
             return CM{ StaggeredGrid::template staggered_unindex<0, 0>(idx) };
         } else {
-            return crossing(idx).mask();
+            return m_crossing_table.mask(idx - gvs);
         }
     }
 
@@ -176,10 +182,13 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
 
     size_t total_vertex_size() const { return m_crossings.size() + grid_vertex_size(); }
     auto &&crossings() const { return m_crossings; }
+    // flat copy of crossings(), row i holds the crossing with index i + grid_vertex_size()
+    const CrossingTable<D> &crossing_table() const { return m_crossing_table; }
 
     size_t new_vertex_offset() const { return grid_vertex_size() + origV().size(); }
 
-    std::set<coord_type> active_cells() const;
+    // grid cells that contain or touch a crossing, filled in parallel from the crossing table
+    CellBitmask<D> active_cells() const;
     std::array<mtao::map<coord_type, std::set<int>>, D> crossing_indices() const;
 
     auto &&origE() const { return data().E(); }
@@ -212,7 +221,7 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
         if (idx < grid_vertex_size()) {
             return vertex_unindex(idx);
         } else {
-            return crossing(idx).vertex();
+            return m_crossing_table.vertex(idx - grid_vertex_size());
         }
     }
     std::string grid_info(int idx) const {
@@ -249,9 +258,11 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
     std::set<Edge> edge_slice(int dim, int slice) const;
     std::array<mtao::map<int, std::set<Edge>>, D> axial_edges() const;
 
-    std::set<coord_type> possible_cells(const std::vector<int> &face) const;
-    std::set<coord_type> possible_cells(const std::set<std::vector<int>> &face) const;
-    std::set<coord_type> possible_cells_cell(const std::set<int> &faces, const std::vector<CutFace<D>> &) const;
+    // grid cells that contain every vertex of the face(s), in lexicographic order
+    using cell_list = typename coord_mask<D>::cell_list;
+    cell_list possible_cells(const std::vector<int> &face) const;
+    cell_list possible_cells(const std::set<std::vector<int>> &face) const;
+    cell_list possible_cells_cell(const std::set<int> &faces, const std::vector<CutFace<D>> &) const;
     coord_mask<D> face_mask(const std::vector<int> &face) const;
     coord_mask<D> face_mask(const std::set<std::vector<int>> &face) const;
     bool is_in_cell(const std::vector<int> &face) const;
@@ -285,8 +296,10 @@ class CutCellEdgeGenerator : public mtao::geometry::grid::StaggeredGrid<double,
     VecVector m_origV;
     //baked by bake_vertices
     VecVector m_newV;
-    std::array<crossing_store_type, D> m_per_axis_crossings;
+    //baked by bake_active_grid_cell_mask
+    GridLineCrossings<D> m_grid_line_crossings;
     std::vector<CrossingType> m_crossings;
+    CrossingTable<D> m_crossing_table;
     //baked by bake_edges
     Edges cut_edges;
     std::vector<CoordMaskedEdge<D>> m_grid_edges;
@@ -1,6 +1,7 @@
 #include "mandoline/construction/generator.hpp"
 #include "mandoline/mesh3.hpp"
 #include "mandoline/adaptive_grid.hpp"
+#include <ostream>
 
 namespace mandoline::construction {
 template<>
@@ -26,13 +27,20 @@ class CutCellGenerator<3> : public CutCellEdgeGenerator<3> {
     void compute_faces();
     void compute_faces_vertex();
     void compute_faces_axis(int idx);
+    // computes the faces of every plane of the listed axes in a single work-stealing pool, largest planes first
+    void compute_faces_axes(const std::vector<int> &axes = { 0, 1, 2 });
     mtao::map<int, CutFace<D>> compute_faces_axis(int idx, int cidx) const;
+    // VV are the vertices projected onto the plane, shared by every plane of an axis
+    mtao::map<int, CutFace<D>> compute_faces_axis(int idx, int cidx, const mtao::ColVecs2d &VV) const;
 
     void bake_faces() override;
     void bake_cells() override;
     void update_active_grid_cell_mask();
 #if defined(MANDOLINE_USE_ADAPTIVE_GRID)
     std::optional<int> adaptive_level = 0;
+    // see AdaptiveGridFactory::branching_factor / balanced
+    int adaptive_branching_factor = 2;
+    bool adaptive_balance = false;
     std::optional<AdaptiveGrid> adaptive_grid;
     std::optional<std::map<int, int>> adaptive_grid_regions;
 #else
@@ -69,6 +77,19 @@ class CutCellGenerator<3> : public CutCellEdgeGenerator<3> {
         mtao::geometry::mesh::HalfEdgeMesh hem;
         bool is_boundary_cell(const std::vector<int> &verts) const;
     };
+    struct PlaneTiming {
+        int axis = 0;
+        int coord = 0;
+        size_t edge_count = 0;// the cost estimate used to order the planes
+        int thread = 0;
+        double start_ms = 0;// relative to the start of the pool
+        double duration_ms = 0;
+    };
+    // timings of the planes processed by the last compute_faces_axes, in the order they were scheduled
+    const std::vector<PlaneTiming> &plane_timings() const { return m_plane_timings; }
+    // writes plane_timings() as csv
+    void dump_plane_timings(std::ostream &os) const;
+
     bool check_cell_containment() const;
     bool check_face_utilization() const;
 
@@ -84,6 +105,7 @@ class CutCellGenerator<3> : public CutCellEdgeGenerator<3> {
     mtao::map<int, CutFace<D>> m_faces;
     std::set<int> mesh_face_indices;// as m_faces loses track of teh cutmesh faces, this keeps track
     std::array<std::set<int>, 3> axis_face_indices;// store the faces that come from each axis
+    std::vector<PlaneTiming> m_plane_timings;
     std::set<int> folded_faces;// elements that are on the boundary of hte input mesh
 
 
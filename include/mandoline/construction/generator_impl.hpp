@@ -7,6 +7,7 @@
 #include <iostream>
 #include <iterator>
 #include <algorithm>
+#include <numeric>
 #include "mandoline/construction/cutdata.hpp"
 #include "mandoline/interpolated_edge.hpp"
 #include <spdlog/spdlog.h>
@@ -159,10 +160,8 @@ void CutCellEdgeGenerator<D>::bake() {
 template<int D>
 void CutCellEdgeGenerator<D>::bake_vertices() {
     const std::vector<CrossingType> &crossings = data().crossings();
+    const CrossingTable<D> &table = data().crossing_table();
 
-    for (auto &&c : crossings) {
-        //std::cout << std::string(c) << std::endl;
-    }
     int maxind = -1;
     for (auto &&c : crossings) {
         maxind = std::max(c.index, maxind);
@@ -174,15 +173,21 @@ void CutCellEdgeGenerator<D>::bake_vertices() {
     //std::cout << "Max ind: " << maxind << std::endl;
     m_crossings.resize(maxind);
     m_newV.resize(maxind);
+    // the row of data().crossing_table() that each new vertex comes from
+    std::vector<int> rows(maxind, 0);
     int gsize = StaggeredGrid::vertex_size();
-    for (auto &&c : crossings) {
+    for (auto &&[row, c] : mtao::iterator::enumerate(crossings)) {
         int newidx = c.index - gsize;
         if (newidx >= 0) {
             m_crossings[newidx] = c;
-            ////std::cout << std::string(c) << " => " << std::string(c2) << std::endl;
-            m_newV[newidx] = get_world_vertex(c.vertex());
+            rows[newidx] = row;
         }
     }
+    m_crossing_table = table.gather(rows);
+    auto &&g = vertex_grid();
+    for (int i = 0; i < maxind; ++i) {
+        m_newV[i] = g.origin() + m_crossing_table.point(i).cwiseProduct(g.dx());
+    }
 }
 template<int D>
 void CutCellEdgeGenerator<D>::add_boundary_elements(const BoundaryElements &F) {
@@ -272,59 +277,21 @@ auto CutCellEdgeGenerator<D>::grid_coord(const Vec &v) const -> std::tuple<coord
 }
 
 template<int D>
-auto CutCellEdgeGenerator<D>::active_cells() const -> std::set<coord_type> {
-    std::set<coord_type> cells;
-    auto add_cells = [&](const coord_type &c, const Vec &quot) {
-        std::set<coord_type> mycells;
-        mycells.insert(c);
-
-        coord_type myc = c;
-        std::function<void(bool, int)> mac;
-        mac = [&](bool sign, int dim) {
-            myc[dim] = c[dim] - sign;
-            if (dim == D - 1) {
-                mycells.insert(myc);
-            } else {
-                if (quot(dim + 1) == 0) {
-                    mac(0, dim + 1);
-                    mac(1, dim + 1);
-                } else {
-                    mac(0, dim + 1);
-                }
+auto CutCellEdgeGenerator<D>::active_cells() const -> CellBitmask<D> {
+    CellBitmask<D> cells(StaggeredGrid::cell_shape());
+
+    // a crossing lies in the cell of its coord, and also in the cells behind every grid plane it is on.
+    // Cells outside of the grid are dropped, they only repeat planes their in-grid neighbors already touch
+    const auto &table = data().crossing_table();
+    int row;
+#pragma omp parallel for
+    for (row = 0; row < table.size(); ++row) {
+        for (auto &&c : table.mask(row).possible_cells(table.coord(row))) {
+            if (cells.valid_index(c)) {
+                cells.set_atomic(c);
             }
-        };
-
-
-        /*
-                       for(int i = 0; i < D; ++i) {
-                       if(quot(i) == 0) {
-                       std::set<coord_type> newcoords;
-                       std::transform(mycells.begin(),mycells.end(),std::inserter(newcoords,newcoords.end()),[&](coord_type c) {
-                       c[i]--;
-                       return c;
-                       });
-                       mycells.insert(newcoords.begin(),newcoords.end());
-                       }
-                       }
-                       */
-        if (quot(0) == 0) {
-            mac(0, 0);
-            mac(1, 0);
-        } else {
-            mac(0, 0);
         }
-        cells.insert(mycells.begin(), mycells.end());
-    };
-
-    for (auto &&c : data().crossings()) {
-        auto &gv = c.vertex();
-        add_cells(gv.coord, gv.quot);
     }
-    /*
-                   for(auto&& p: data().V()) {
-                   add_cells(p.coord,p.quot);
-                   }
-                   */
     return cells;
 }
 template<int D>
@@ -469,8 +436,25 @@ template<int D>
 //Pupulate the mask and add RBD cut edges to the mesh
 auto CutCellEdgeGenerator<D>::get_per_axis_crossing_indices() const -> std::array<crossing_store_type, D> {
 
-    auto paci = get_per_axis_crossing_indices(data().crossings());
-    return paci;
+    //Three types of vertices: original vertices, intersection vertices, stencil vertices that are neither of the above
+    //The first two can be stored as extraneous vertices, the last one will be vvirtual vertices
+    // same as the overload below, but filters crossings through the flat crossing table
+    const auto &crossings = data().crossings();
+    const auto &table = data().crossing_table();
+    std::array<crossing_store_type, D> per_axis;
+
+    for (int row = 0; row < table.size(); ++row) {
+        if (table.clamped_count(row) == D - 1) {
+            auto clamped = table.clamped_bits[row];
+            for (int j = 0; j < D; ++j) {
+                if (!(clamped & (1 << j))) {
+                    per_axis[j][table.coord(row)].emplace(crossings[row]);
+                    break;
+                }
+            }
+        }
+    }
+    return per_axis;
 }
 
 
@@ -526,8 +510,15 @@ template<int D>
 auto CutCellEdgeGenerator<D>::all_GV() const -> ColVecs {
 
     ColVecs R(D, num_vertices());
-    for (int i = 0; i < num_vertices(); ++i) {
-        R.col(i) = grid_vertex(i).p();
+    int gsize = grid_vertex_size();
+    for (int i = 0; i < gsize; ++i) {
+        auto c = vertex_unindex(i);
+        for (int j = 0; j < D; ++j) {
+            R(j, i) = c[j];
+        }
+    }
+    for (int i = 0; i < m_crossing_table.size(); ++i) {
+        R.col(i + gsize) = m_crossing_table.point(i);
     }
     return R;
 
@@ -621,29 +612,36 @@ template<int D>
 void CutCellEdgeGenerator<D>::clear() {
     m_data.clear();
     m_origEMap.clear();
-    m_per_axis_crossings = {};
+    m_grid_line_crossings.clear();
     m_newV.clear();
-    for(auto&& a: m_per_axis_crossings) {
-        a.clear();
-    }
     m_crossings.clear();
+    m_crossing_table.clear();
     cut_edges = {};
     m_grid_edges.clear();
     m_cut_edges.clear();
     m_cut_faces.clear();
 }
 
+template<int D>
+void CutCellEdgeGenerator<D>::clear_intersections(const std::set<int> &edges, const std::set<int> &triangles) {
+    // clear() wipes every intersection in m_data, so hold on to it while everything else is cleared.
+    // moving keeps the intersection buffers (and the pointers into them) intact
+    CutData<D> data = std::move(m_data);
+    clear();
+    m_data = std::move(data);
+    m_data.clear(edges, triangles);
+}
+
 template<int D>
 void CutCellEdgeGenerator<D>::reset(const mtao::vector<VType> &gvs) {
     m_data = CutData<D>(gvs);
     m_origV.clear();
     m_origEMap.clear();
-    for(auto&& a: m_per_axis_crossings) {
-        a.clear();
-    }
+    m_grid_line_crossings.clear();
     cut_edges = {};
     m_newV.clear();
     m_crossings.clear();
+    m_crossing_table.clear();
     m_grid_edges.clear();
     m_cut_edges.clear();
     m_cut_faces.clear();
@@ -695,40 +693,35 @@ void CutCellEdgeGenerator<D>::bake_active_grid_cell_mask() {
     m_active_grid_cell_mask = GridDatab::Constant(true, s);
 
 
-    mtao::map<std::array<int, 2>, int> cutedge_to_edge_map;
-
-    m_per_axis_crossings = get_per_axis_crossing_indices();
-
-    GridDatab vertmask = GridDatab::Constant(true, vertex_shape());
     {
 
         auto t = mtao::logging::timer("Adding grid vertices");
-        auto add_grid = [&](int dim, const coord_type &c) {
-            m_per_axis_crossings[dim][c];
-            /*
-                           per_boundary_cell_vertex_looper(dim,[&](auto&& c, auto&& bs) {
-                           Vec v = Vec::Zero();
-                           }, c);
-                           */
-        };
 
         auto AC = active_cells();
 
-#pragma omp parallel
-#pragma omp for
-        for (int i = 0; i < D; ++i) {
-            for (auto &&c : AC) {
-                if (m_active_grid_cell_mask.valid_index(c)) {
-                    m_active_grid_cell_mask(c) = false;
-
-                    per_boundary_cell_vertex_looper(
-                      i, [&](const coord_type &a, const std::bitset<D> &bs) {
-                          add_grid(i, a);
-                      },
-                      c);
-                }
-            }
+        int w;
+#pragma omp parallel for
+        for (w = 0; w < AC.word_count(); ++w) {
+            AC.for_each_in_word(w, [&](const coord_type &c) {
+                m_active_grid_cell_mask(c) = false;
+            });
         }
+
+        // the grid lines on the boundary of an active cell get edges even if nothing crosses them
+        std::array<CellBitmask<D>, D> boundary_lines;
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < D; ++i) {
+            boundary_lines[i] = CellBitmask<D>(vertex_shape());
+            AC.for_each([&](const coord_type &c) {
+                per_boundary_cell_vertex_looper(
+                  i, [&](const coord_type &a, const std::bitset<D> &bs) {
+                      boundary_lines[i].set(a);
+                  },
+                  c);
+            });
+        }
+        m_grid_line_crossings = GridLineCrossings<D>(data().crossing_table(), boundary_lines);
     }
 }
 template<int D>
@@ -746,46 +739,43 @@ void CutCellEdgeGenerator<D>::bake_edges() {
         return Edge{ fidx, nidx };
     };
 
-    {
-        std::mutex edges_mutex;
-        //Create every new edge possible where at least one side is on the interior of the mask
-        auto add_edges = [&](auto &&s, const coord_type &grid_edge, int dim) {
-            std::vector<int> vec;
-            mtao::map<double, int> edge_ordered_elements;
-            auto e = get_grid_edge(grid_edge, dim);
-            edge_ordered_elements[0] = e[0];
-            edge_ordered_elements[1] = e[1];
-            coord_mask<D> mask(grid_edge);
-            mask[dim].reset();
-            std::transform(s.begin(), s.end(), std::inserter(edge_ordered_elements, edge_ordered_elements.end()), [&](const EdgeCrossing<D> &c) {
-                return std::make_pair(c.edge_coord(), c.index);
-            });
-
-            //grab the indices from sorted intervals
-            std::transform(edge_ordered_elements.begin(), edge_ordered_elements.end(), std::back_inserter(vec), [](auto &&pr) { return std::get<1>(pr); });
-
-            std::scoped_lock lock(edges_mutex);
-            for (int i = 0; i < vec.size() - 1; ++i) {
-                auto e = std::array<int, 2>{ { vec[i], vec[i + 1] } };
-                if (e[0] != e[1]) {
-                    m_grid_edges.emplace_back(CoordMaskedEdge<D>{ mask, e });
-                }
+    //Create every new edge possible where at least one side is on the interior of the mask
+    //Every line writes its edges into its own range of m_grid_edges, so the lines are processed independently
+    for (int dim = 0; dim < D; ++dim) {
+        auto t = mtao::logging::timer("Per axis crossings timing:");
+        const auto &axis = m_grid_line_crossings.axis(dim);
+        const auto &edge_grid = StaggeredGrid::template grid<1>(dim);
+        const int line_count = axis.line_count();
+
+        std::vector<int> offsets(line_count + 1, 0);
+        int j;
+#pragma omp parallel for
+        for (j = 0; j < line_count; ++j) {
+            const coord_type &c = axis.lines[j];
+            if (edge_grid.valid_index(c)) {
+                auto e = get_grid_edge(c, dim);
+                int count = 0;
+                m_grid_line_crossings.for_each_segment(dim, j, e[0], e[1], [&](int, int) { ++count; });
+                offsets[j + 1] = count;
             }
-        };
-
-
-        int i;
-#pragma omp for
-        for (i = 0; i < m_per_axis_crossings.size(); i++) {
-            //for(auto&& [i,crossings]: mtao::iterator::enumerate(m_per_axis_crossings)) {
-            auto &&crossings = m_per_axis_crossings[i];
-            auto t = mtao::logging::timer("Per axis crossings timing:");
-
-            for (auto &&[c, crossings] : crossings) {
-                if (StaggeredGrid::template grid<1>(i).valid_index(c)) {
-                    add_edges(crossings, c, i);
-                }
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        size_t base = m_grid_edges.size();
+        m_grid_edges.resize(base + offsets.back());
+#pragma omp parallel for
+        for (j = 0; j < line_count; ++j) {
+            if (offsets[j] == offsets[j + 1]) {
+                continue;
             }
+            const coord_type &c = axis.lines[j];
+            auto e = get_grid_edge(c, dim);
+            coord_mask<D> mask(c);
+            mask.unbind(dim);
+            size_t k = base + offsets[j];
+            m_grid_line_crossings.for_each_segment(dim, j, e[0], e[1], [&](int a, int b) {
+                m_grid_edges[k++] = CoordMaskedEdge<D>{ mask, Edge{ { a, b } } };
+            });
         }
     }
 }
@@ -954,16 +944,13 @@ auto CutCellEdgeGenerator<D>::vertex_ownership() const -> mtao::map<coord_type,
     return crossings;
 }
 template<int D>
-auto CutCellEdgeGenerator<D>::possible_cells(const std::vector<int> &face) const -> std::set<coord_type> {
+auto CutCellEdgeGenerator<D>::possible_cells(const std::vector<int> &face) const -> cell_list {
 
     if (face.empty()) { return {}; }
-    std::set<coord_type> possibles = GV(face[0]).possible_cells();
+    cell_list possibles = GV(face[0]).possible_cells();
 
     for (auto &&f : face) {
-        auto s = GV(f).possible_cells();
-        std::set<coord_type> i;
-        std::set_intersection(possibles.begin(), possibles.end(), s.begin(), s.end(), std::inserter(i, i.end()));
-        possibles = std::move(i);
+        possibles = intersect_cells(possibles, GV(f).possible_cells());
         if (possibles.empty()) {
             return {};
         }
@@ -972,17 +959,14 @@ auto CutCellEdgeGenerator<D>::possible_cells(const std::vector<int> &face) const
     return possibles;
 }
 template<int D>
-auto CutCellEdgeGenerator<D>::possible_cells(const std::set<std::vector<int>> &faces) const -> std::set<coord_type> {
+auto CutCellEdgeGenerator<D>::possible_cells(const std::set<std::vector<int>> &faces) const -> cell_list {
 
     if (faces.empty()) { return {}; }
-    std::set<coord_type> possibles = GV((*faces.begin())[0]).possible_cells();
+    cell_list possibles = GV((*faces.begin())[0]).possible_cells();
 
     for (auto &&face : faces) {
         for (auto &&f : face) {
-            auto s = GV(f).possible_cells();
-            std::set<coord_type> i;
-            std::set_intersection(possibles.begin(), possibles.end(), s.begin(), s.end(), std::inserter(i, i.end()));
-            possibles = std::move(i);
+            possibles = intersect_cells(possibles, GV(f).possible_cells());
             if (possibles.empty()) {
                 return {};
             }
@@ -992,16 +976,13 @@ auto CutCellEdgeGenerator<D>::possible_cells(const std::set<std::vector<int>> &f
     return possibles;
 }
 template<int D>
-auto CutCellEdgeGenerator<D>::possible_cells_cell(const std::set<int> &faces, const std::vector<CutFace<D>> &CFs) const -> std::set<coord_type> {
+auto CutCellEdgeGenerator<D>::possible_cells_cell(const std::set<int> &faces, const std::vector<CutFace<D>> &CFs) const -> cell_list {
 
     if (faces.empty()) { return {}; }
-    std::set<coord_type> possibles = possible_cells(CFs[*faces.begin()].indices);
+    cell_list possibles = possible_cells(CFs[*faces.begin()].indices);
 
-    for (auto &&face : faces) {
-        auto s = possible_cells(CFs[face].indices);
-        std::set<coord_type> i;
-        std::set_intersection(possibles.begin(), possibles.end(), s.begin(), s.end(), std::inserter(i, i.end()));
-        possibles = std::move(i);
+    for (auto it = std::next(faces.begin()); it != faces.end(); ++it) {
+        possibles = intersect_cells(possibles, possible_cells(CFs[*it].indices));
         if (possibles.empty()) {
             spdlog::warn("No possible cell!");
             return {};
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <vector>
+#include "mandoline/construction/crossing_table.hpp"
+#include "mandoline/construction/cell_bitmask.hpp"
+
+
+namespace mandoline::construction {
+
+// The crossings that lie on grid lines, grouped by line in a CSR layout.
+// A line along axis d is identified by the coordinate of its grid vertex with the smallest
+// d'th coordinate. For every axis the lines are stored in lexicographic order and the crossings
+// of line i are params/indices[offsets[i]:offsets[i+1]], sorted by their position along the line
+template<int D>
+class GridLineCrossings {
+  public:
+    using coord_type = std::array<int, D>;
+    struct Axis {
+        std::vector<coord_type> lines;
+        std::vector<int> offsets = { 0 };
+        // position along the line in [0,1)
+        std::vector<double> params;
+        // index of the crossing
+        std::vector<int> indices;
+
+        size_t line_count() const { return lines.size(); }
+        size_t crossing_count(size_t line) const { return offsets[line + 1] - offsets[line]; }
+    };
+
+    GridLineCrossings() = default;
+    GridLineCrossings(const GridLineCrossings &) = default;
+    GridLineCrossings(GridLineCrossings &&) = default;
+    GridLineCrossings &operator=(const GridLineCrossings &) = default;
+    GridLineCrossings &operator=(GridLineCrossings &&) = default;
+    // uses the rows of the table with exactly one unbound axis
+    GridLineCrossings(const CrossingTable<D> &table);
+    // extra_lines[d] are lines along axis d (bits set on a vertex-shaped mask) that are kept even if no crossing lies on them
+    GridLineCrossings(const CrossingTable<D> &table, const std::array<CellBitmask<D>, D> &extra_lines);
+
+    const Axis &axis(int d) const { return m_axes[d]; }
+    void clear();
+
+    // calls f(a,b) for every pair of consecutive vertices along a line, starting at the grid vertex
+    // begin and finishing at the grid vertex end. The grid vertices own the ends of the line, so
+    // crossings at 0 (and repeated positions) are skipped
+    template<typename Func>
+    void for_each_segment(int d, size_t line, int begin, int end, Func &&f) const;
+
+  private:
+    void build(const CrossingTable<D> &table, const std::array<CellBitmask<D>, D> *extra_lines);
+    std::array<Axis, D> m_axes;
+};
+}// namespace mandoline::construction
+
+#include "mandoline/construction/grid_line_crossings_impl.hpp"
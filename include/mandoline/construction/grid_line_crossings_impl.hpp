@@ -0,0 +1,98 @@
+#pragma once
+#include "mandoline/construction/grid_line_crossings.hpp"
+#include <tuple>
+#include <tbb/parallel_sort.h>
+
+namespace mandoline::construction {
+
+template<int D>
+GridLineCrossings<D>::GridLineCrossings(const CrossingTable<D> &table) {
+    build(table, nullptr);
+}
+
+template<int D>
+GridLineCrossings<D>::GridLineCrossings(const CrossingTable<D> &table, const std::array<CellBitmask<D>, D> &extra_lines) {
+    build(table, &extra_lines);
+}
+
+template<int D>
+void GridLineCrossings<D>::clear() {
+    m_axes = {};
+}
+
+template<int D>
+void GridLineCrossings<D>::build(const CrossingTable<D> &table, const std::array<CellBitmask<D>, D> *extra_lines) {
+    struct Entry {
+        coord_type line;
+        double param;
+        int row;
+        bool operator<(const Entry &o) const {
+            // row breaks ties so the order is deterministic
+            return std::tie(line, param, row) < std::tie(o.line, o.param, o.row);
+        }
+    };
+
+    std::array<std::vector<Entry>, D> entries;
+    for (int row = 0; row < table.size(); ++row) {
+        auto clamped = table.clamped_bits[row];
+        if (table.clamped_count(row) == D - 1) {
+            for (int j = 0; j < D; ++j) {
+                if (!(clamped & (1 << j))) {
+                    entries[j].emplace_back(Entry{ table.coord(row), table.quots(j, row), row });
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int d = 0; d < D; ++d) {
+        auto &E = entries[d];
+        tbb::parallel_sort(E.begin(), E.end());
+
+        std::vector<coord_type> extra;
+        if (extra_lines != nullptr) {
+            (*extra_lines)[d].for_each([&](const coord_type &c) { extra.emplace_back(c); });
+        }
+
+        // merge the lines of the crossings with the extra lines, both are sorted
+        Axis &axis = m_axes[d];
+        axis = {};
+        axis.params.reserve(E.size());
+        axis.indices.reserve(E.size());
+        size_t a = 0, b = 0;
+        while (a < E.size() || b < extra.size()) {
+            const coord_type line = (b == extra.size() || (a < E.size() && E[a].line < extra[b])) ? E[a].line : extra[b];
+            axis.lines.emplace_back(line);
+            for (; b < extra.size() && extra[b] == line; ++b) {}
+            for (; a < E.size() && E[a].line == line; ++a) {
+                axis.params.emplace_back(E[a].param);
+                axis.indices.emplace_back(table.indices[E[a].row]);
+            }
+            axis.offsets.emplace_back(axis.params.size());
+        }
+    }
+}
+
+template<int D>
+template<typename Func>
+void GridLineCrossings<D>::for_each_segment(int d, size_t line, int begin, int end, Func &&f) const {
+    const Axis &axis = m_axes[d];
+    int prev = begin;
+    double prev_param = 0;
+    for (int k = axis.offsets[line]; k < axis.offsets[line + 1]; ++k) {
+        double t = axis.params[k];
+        if (!(t > prev_param && t < 1)) {
+            continue;
+        }
+        int idx = axis.indices[k];
+        if (prev != idx) {
+            f(prev, idx);
+        }
+        prev = idx;
+        prev_param = t;
+    }
+    if (prev != end) {
+        f(prev, end);
+    }
+}
+}// namespace mandoline::construction
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <vector>
+
+
+namespace mandoline::construction {
+
+// The grid planes an edge can cross along each axis, in the reflected frame EdgeIntersections::bake works in.
+// Along axis d the candidate crossings are t = (offset[d] + i) / dir[d] for i in [0, end[d] - begin[d]]
+template<int D>
+struct PlaneSweep {
+    std::bitset<D> reflection;
+    std::array<int, D> begin = {};
+    std::array<int, D> end = {};
+    std::array<double, D> dir = {};
+    std::array<double, D> offset = {};
+};
+
+// Flat arrays of the plane crossings of a batch of edges, ordered by axis then plane within each edge
+struct PlaneCrossings {
+    // crossings of edge j are [offsets[j], offsets[j+1])
+    std::vector<int> offsets = { 0 };
+    std::vector<double> ts;
+    std::vector<int> axes;
+    // index of the plane relative to PlaneSweep::begin
+    std::vector<int> steps;
+
+    int edge_count() const { return int(offsets.size()) - 1; }
+    int size(int edge) const { return offsets[edge + 1] - offsets[edge]; }
+    void reserve(size_t edges, size_t crossings);
+};
+
+// writes every t = (offset + i) / dir with 0 < t < 1 for i in [0,count) and its i, returns how many were written.
+// ts and steps need room for count values. the AVX2 and scalar versions produce bitwise identical results
+int plane_crossing_parameters(double offset, double dir, int count, double *ts, int *steps);
+int plane_crossing_parameters_scalar(double offset, double dir, int count, double *ts, int *steps);
+
+// whether plane_crossing_parameters uses AVX2, which is the case when the cpu supports it unless disabled
+bool plane_crossing_simd_enabled();
+void set_plane_crossing_simd(bool enabled);
+
+// computes the crossings of every sweep, in order
+template<int D>
+PlaneCrossings plane_crossings(const std::vector<PlaneSweep<D>> &sweeps);
+// computes the crossings of the sweeps in [begin,end), in order. independent ranges can be run in parallel
+template<int D>
+PlaneCrossings plane_crossings(const PlaneSweep<D> *begin, const PlaneSweep<D> *end);
+// appends the crossings of a single sweep
+template<int D>
+void append_plane_crossings(const PlaneSweep<D> &sweep, PlaneCrossings &crossings);
+}// namespace mandoline::construction
+#include "mandoline/construction/plane_crossing_kernel_impl.hpp"
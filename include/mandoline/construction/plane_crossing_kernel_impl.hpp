@@ -0,0 +1,43 @@
+#pragma once
+#include "mandoline/construction/plane_crossing_kernel.hpp"
+#include <algorithm>
+
+
+namespace mandoline::construction {
+template<int D>
+void append_plane_crossings(const PlaneSweep<D> &sweep, PlaneCrossings &crossings) {
+    for (int d = 0; d < D; ++d) {
+        const double dir = sweep.dir[d];
+        const int count = sweep.end[d] - sweep.begin[d] + 1;
+        if (dir == 0 || count <= 0) continue;
+        const size_t start = crossings.ts.size();
+        crossings.ts.resize(start + count);
+        crossings.steps.resize(start + count);
+        int kept = plane_crossing_parameters(sweep.offset[d], dir, count, crossings.ts.data() + start, crossings.steps.data() + start);
+        crossings.ts.resize(start + kept);
+        crossings.steps.resize(start + kept);
+        crossings.axes.resize(start + kept, d);
+    }
+    crossings.offsets.emplace_back(crossings.ts.size());
+}
+
+template<int D>
+PlaneCrossings plane_crossings(const PlaneSweep<D> *begin, const PlaneSweep<D> *end) {
+    PlaneCrossings crossings;
+    size_t candidates = 0;
+    for (auto it = begin; it != end; ++it) {
+        for (int d = 0; d < D; ++d) {
+            candidates += std::max(0, it->end[d] - it->begin[d] + 1);
+        }
+    }
+    crossings.reserve(end - begin, candidates);
+    for (auto it = begin; it != end; ++it) {
+        append_plane_crossings(*it, crossings);
+    }
+    return crossings;
+}
+template<int D>
+PlaneCrossings plane_crossings(const std::vector<PlaneSweep<D>> &sweeps) {
+    return plane_crossings(sweeps.data(), sweeps.data() + sweeps.size());
+}
+}// namespace mandoline::construction
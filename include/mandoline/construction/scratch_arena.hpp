@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+
+namespace mandoline::construction {
+
+// Per-thread monotonic memory for short lived construction data.
+// Per-plane face construction runs inside an omp parallel for and used to put
+// all of its small temporaries on the global heap. Opening a Scope routes the
+// calling thread's scratch allocations into a monotonic buffer that is
+// released in bulk when the outermost Scope on that thread closes.
+// Only containers that take a pmr resource use it: the half edge meshes the planes
+// build and everything inside of them are mtao types that stay on the heap.
+class ScratchArena {
+  public:
+    struct Statistics {
+        // allocations requested from scratch resources
+        size_t allocations = 0;
+        // allocations that actually reached the global heap
+        size_t heap_allocations = 0;
+        size_t heap_bytes = 0;
+    };
+
+    class Scope {
+      public:
+        Scope();
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        std::pmr::memory_resource *resource() const;
+
+      private:
+        ScratchArena &m_arena;
+    };
+
+    // the arena of the calling thread
+    static ScratchArena &local();
+    // the scratch resource of the calling thread. memory taken from it while a Scope is open
+    // belongs to that scope, so containers using it must not outlive the scope
+    static std::pmr::memory_resource *resource();
+
+    // when disabled scratch allocations go directly to the heap (but are still counted)
+    static void set_enabled(bool enabled);
+    static bool enabled();
+
+    static Statistics statistics();
+    static void reset_statistics();
+
+  private:
+    // counts the requests made to the arena and forwards them to the monotonic buffer or the heap
+    struct FrontResource : public std::pmr::memory_resource {
+        ScratchArena *arena = nullptr;
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override { return this == &o; }
+    };
+    // counts the allocations that reach the heap
+    struct HeapResource : public std::pmr::memory_resource {
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override { return this == &o; }
+    };
+
+    ScratchArena();
+
+    HeapResource m_heap;
+    std::pmr::monotonic_buffer_resource m_buffer;
+    FrontResource m_front;
+    int m_depth = 0;
+    // whether the current outermost scope uses the monotonic buffer
+    bool m_buffered = false;
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<size_t> s_allocations;
+    static std::atomic<size_t> s_heap_allocations;
+    static std::atomic<size_t> s_heap_bytes;
+};
+}// namespace mandoline::construction
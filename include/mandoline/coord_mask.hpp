@@ -8,19 +8,30 @@
 #include <mtao/iterator/enumerate.hpp>
 #include <mtao/eigen/iterable.hpp>
 #include <optional>
+#include <cstdint>
+#include "mandoline/inline_vector.hpp"
 
 
 namespace mandoline {
 template<int D>
 struct Vertex;
+// The grid planes a point (or the intersection of several points) lies on.
+// Stored packed as a bit per axis that says whether it is bound plus the bound coordinates,
+// so the set operations below are a few bitwise ops on a word rather than a loop over optionals.
 template<int D, typename T = int>
-struct coord_mask : public std::array<std::optional<T>, D> {
+struct coord_mask {
     // coord mask partial ordering has all possible PO cases
     enum class PartialOrdering { Less,
                                  Greater,
                                  Equal,
                                  Unknown };
     using coord_type = std::array<T, D>;
+    // bit i is set if axis i is bound
+    using BitsType = uint8_t;
+    static_assert(D <= 8 * sizeof(BitsType));
+    constexpr static BitsType AllBits = (1 << D) - 1;
+    // every cell a point can be adjacent to, a point on a grid vertex touches 2^D
+    using cell_list = inline_vector<coord_type, size_t(1) << D>;
 
     // rule of 5
     coord_mask() = default;
@@ -44,6 +55,13 @@ struct coord_mask : public std::array<std::optional<T>, D> {
 
     // returns true if the axis is bound
     bool is_bound(size_t idx) const;
+    // the coordinate of a bound axis, an empty optional otherwise.
+    // This is a copy, so it is const to make writes through it fail to compile; use bind/unbind
+    const std::optional<T> operator[](size_t idx) const;
+    // bind a single axis to coord / free it
+    void bind(size_t idx, T coord);
+    void unbind(size_t idx);
+    BitsType bits() const { return m_bits; }
 
     // if we're sure we have D-1 elements bound we can pick out the one unbound one
     // this selects the axis that an axis-aligned edge lies on
@@ -86,6 +104,11 @@ struct coord_mask : public std::array<std::optional<T>, D> {
     // checks *this < other
     bool strict_subsumes(const coord_mask &other) const;
 
+    bool operator==(const coord_mask &o) const;
+    bool operator!=(const coord_mask &o) const;
+    // lexicographic order with unbound axes before bound ones, so masks can be map keys
+    bool operator<(const coord_mask &o) const;
+
     // string for visualization
     operator std::string() const;
 
@@ -101,8 +124,22 @@ struct coord_mask : public std::array<std::optional<T>, D> {
 
     // Given a fully specified coordinate from a vertex (or
     // coord-masked polygon), returns the grid cells that the object can be considered to be part of
-    std::set<coord_type> possible_cells(const coord_type &coord) const;
+    // in lexicographic order
+    cell_list possible_cells(const coord_type &coord) const;
+
+  private:
+    // which axes in a mask differ from the ones in o
+    BitsType different_coords(const coord_mask &o) const;
+    // zeros the coordinates of unbound axes so equal masks have equal coordinates
+    void clear_unbound_coords();
+
+    coord_type m_coords = {};
+    BitsType m_bits = 0;
 };
+
+// intersection of two sorted cell lists, as std::set_intersection would
+template<typename CellList>
+CellList intersect_cells(const CellList &a, const CellList &b);
 }// namespace mandoline
 
 #include "mandoline/coord_mask_impl.hpp"
@@ -1,5 +1,6 @@
 #pragma once
 #include "mandoline/coord_mask.hpp"
+#include <iterator>
 
 namespace mandoline {
 
@@ -21,17 +22,38 @@ void coord_mask<D, T>::reset() { *this = {}; }
 template<int D, typename T>
 void coord_mask<D, T>::reset(int idx, int coord) {
     reset();
-    (*this)[idx] = coord;
+    bind(idx, coord);
 }
 template<int D, typename T>
 void coord_mask<D, T>::reset(const coord_type &o) {
-    std::copy(o.begin(), o.end(), this->begin());
+    m_coords = o;
+    m_bits = AllBits;
 }
 
 template<int D, typename T>
 bool coord_mask<D, T>::is_bound(size_t idx) const {
     assert(idx < D);
-    return bool((*this)[idx]);
+    return (m_bits >> idx) & 1;
+}
+template<int D, typename T>
+const std::optional<T> coord_mask<D, T>::operator[](size_t idx) const {
+    if (is_bound(idx)) {
+        return m_coords[idx];
+    } else {
+        return {};
+    }
+}
+template<int D, typename T>
+void coord_mask<D, T>::bind(size_t idx, T coord) {
+    assert(idx < D);
+    m_coords[idx] = coord;
+    m_bits |= BitsType(1 << idx);
+}
+template<int D, typename T>
+void coord_mask<D, T>::unbind(size_t idx) {
+    assert(idx < D);
+    m_coords[idx] = 0;
+    m_bits &= BitsType(~(1 << idx));
 }
 
 template<int D, typename T>
@@ -59,33 +81,41 @@ int coord_mask<D, T>::bound_axis() const {
 template<int D, typename T>
 auto coord_mask<D, T>::as_array() const -> coord_type {
     assert(count() == D);
-    coord_type m;
-    std::transform(this->begin(), this->end(), m.begin(), [](auto &&a) {
-        return *a;
-    });
-    return m;
+    return m_coords;
 }
 template<int D, typename T>
 size_t coord_mask<D, T>::count() const {
-    return std::count_if(this->begin(), this->end(), [](const std::optional<T> &v) -> bool { return bool(v); });
+    return as_bitset().count();
 }
 
 template<int D, typename T>
 bool coord_mask<D, T>::all() const {
-    return std::all_of(this->begin(), this->end(), [](const std::optional<T> &v) -> bool { return bool(v); });
+    return m_bits == AllBits;
 }
 template<int D, typename T>
 bool coord_mask<D, T>::active() const {
-    return std::any_of(this->begin(), this->end(), [](const std::optional<T> &v) -> bool { return bool(v); });
+    return m_bits != 0;
 }
+
 template<int D, typename T>
-auto coord_mask<D, T>::operator&=(const coord_mask &o) -> coord_mask & {
-    for (auto &&[a, b] : mtao::iterator::zip(*this, o)) {
-        if (a && b && (*a == *b)) {
-        } else {
-            a = {};
-        }
+auto coord_mask<D, T>::different_coords(const coord_mask &o) const -> BitsType {
+    BitsType diff = 0;
+    for (int i = 0; i < D; ++i) {
+        diff |= BitsType(m_coords[i] != o.m_coords[i]) << i;
     }
+    return diff;
+}
+template<int D, typename T>
+void coord_mask<D, T>::clear_unbound_coords() {
+    for (int i = 0; i < D; ++i) {
+        m_coords[i] *= (m_bits >> i) & 1;
+    }
+}
+
+template<int D, typename T>
+auto coord_mask<D, T>::operator&=(const coord_mask &o) -> coord_mask & {
+    m_bits &= o.m_bits & ~different_coords(o);
+    clear_unbound_coords();
     return *this;
 }
 
@@ -97,12 +127,14 @@ auto coord_mask<D, T>::operator&(const coord_mask &o) const -> coord_mask {
 }
 template<int D, typename T>
 auto coord_mask<D, T>::operator|=(const coord_mask &o) -> coord_mask & {
-    for (auto &&[a, b] : mtao::iterator::zip(*this, o)) {
-        if (a && b && (*a == *b)) {
-        } else {
-            a = {};
-        }
+    // planes bound to different coordinates in the two masks are dropped
+    BitsType conflicts = m_bits & o.m_bits & different_coords(o);
+    BitsType only_o = o.m_bits & ~m_bits;
+    for (int i = 0; i < D; ++i) {
+        m_coords[i] += ((only_o >> i) & 1) * o.m_coords[i];
     }
+    m_bits = (m_bits | o.m_bits) & ~conflicts;
+    clear_unbound_coords();
     return *this;
 }
 
@@ -114,11 +146,8 @@ auto coord_mask<D, T>::operator|(const coord_mask &o) const -> coord_mask {
 }
 template<int D, typename T>
 auto coord_mask<D, T>::operator-=(const coord_mask &o) -> coord_mask & {
-    for (auto &&[a, b] : mtao::iterator::zip(*this, o)) {
-        if (b) {
-            a = {};
-        }
-    }
+    m_bits &= ~o.m_bits;
+    clear_unbound_coords();
     return *this;
 }
 template<int D, typename T>
@@ -132,49 +161,51 @@ auto coord_mask<D, T>::operator-(const coord_mask &o) const -> coord_mask {
 template<int D, typename T>
 auto coord_mask<D, T>::partial_ordering(const coord_mask &other) const -> PartialOrdering {
     //*this > other
-    PartialOrdering po = PartialOrdering::Equal;
-    for (auto &&[a, b] : mtao::iterator::zip(*this, other)) {
-        if (a && b) {
-            if (*a != *b) {
-                return PartialOrdering::Unknown;
-            }
-        } else if (a) {//but ont b  i.e (a > b)
-            switch (po) {
-            case PartialOrdering::Greater:
-                continue;
-            case PartialOrdering::Less:
-                return PartialOrdering::Unknown;
-            case PartialOrdering::Equal:
-                po = PartialOrdering::Greater;
-                continue;
-            case PartialOrdering::Unknown:
-                return PartialOrdering::Unknown;
-            }
-        } else if (b) {//but ont b  i.e (a < b)
-            switch (po) {
-            case PartialOrdering::Less:
-                continue;
-            case PartialOrdering::Greater:
-                return PartialOrdering::Unknown;
-            case PartialOrdering::Equal:
-                po = PartialOrdering::Less;
-                continue;
-            case PartialOrdering::Unknown:
-                return PartialOrdering::Unknown;
-            }
-        }
+    if (m_bits & other.m_bits & different_coords(other)) {
+        return PartialOrdering::Unknown;
+    }
+    const bool greater = m_bits & ~other.m_bits;
+    const bool less = other.m_bits & ~m_bits;
+    if (greater && less) {
+        return PartialOrdering::Unknown;
+    } else if (greater) {
+        return PartialOrdering::Greater;
+    } else if (less) {
+        return PartialOrdering::Less;
+    } else {
+        return PartialOrdering::Equal;
     }
-    return po;
 }
 template<int D, typename T>
 bool coord_mask<D, T>::subsumes(const coord_mask &other) const {
-    PartialOrdering po = partial_ordering(other);
-    return po == PartialOrdering::Greater || po == PartialOrdering::Equal;
+    // Greater or Equal: every plane of other is one of ours
+    return (other.m_bits & ~(m_bits & ~different_coords(other))) == 0;
 }
 template<int D, typename T>
 bool coord_mask<D, T>::strict_subsumes(const coord_mask &other) const {
-    PartialOrdering po = partial_ordering(other);
-    return po == PartialOrdering::Greater;
+    return subsumes(other) && m_bits != other.m_bits;
+}
+
+template<int D, typename T>
+bool coord_mask<D, T>::operator==(const coord_mask &o) const {
+    return m_bits == o.m_bits && m_coords == o.m_coords;
+}
+template<int D, typename T>
+bool coord_mask<D, T>::operator!=(const coord_mask &o) const {
+    return !(*this == o);
+}
+template<int D, typename T>
+bool coord_mask<D, T>::operator<(const coord_mask &o) const {
+    for (int i = 0; i < D; ++i) {
+        bool a = is_bound(i);
+        bool b = o.is_bound(i);
+        if (a != b) {
+            return b;
+        } else if (a && m_coords[i] != o.m_coords[i]) {
+            return m_coords[i] < o.m_coords[i];
+        }
+    }
+    return false;
 }
 
 template<int D, typename T>
@@ -182,14 +213,14 @@ coord_mask<D, T>::operator std::string() const {
     std::stringstream ss;
     ss << "(";
     for (int i = 0; i < D - 1; ++i) {
-        if ((*this)[i]) {
-            ss << *(*this)[i] << ",";
+        if (is_bound(i)) {
+            ss << m_coords[i] << ",";
         } else {
             ss << "_.";
         }
     }
-    if ((*this)[D - 1]) {
-        ss << *(*this)[D - 1];
+    if (is_bound(D - 1)) {
+        ss << m_coords[D - 1];
     } else {
         ss << "_";
     }
@@ -198,54 +229,61 @@ coord_mask<D, T>::operator std::string() const {
 }
 template<int D, typename T>
 void coord_mask<D, T>::clamp(coord_type &vec) const {
-    for (auto &&[v, t] : mtao::iterator::zip(vec, *this)) {
-        if (t) {
-            v = *t;
+    for (int i = 0; i < D; ++i) {
+        if (is_bound(i)) {
+            vec[i] = m_coords[i];
         }
     }
 }
 template<int D, typename T>
 void coord_mask<D, T>::clamp(Vertex<D> &vec) const {
-    for (auto &&[v, q, t] :
-         mtao::iterator::zip(vec.coord, mtao::eigen::iterable(vec.quot), *this)) {
-        if (t) {
-            v = *t;
-            q = 0;
+    for (int i = 0; i < D; ++i) {
+        if (is_bound(i)) {
+            vec.coord[i] = m_coords[i];
+            vec.quot(i) = 0;
         }
     }
     vec.clamped_indices |= as_bitset();
 }
 template<int D, typename T>
 std::bitset<D> coord_mask<D, T>::as_bitset() const {
-    std::bitset<D> bs;
-    for (auto &&[i, t] : mtao::iterator::enumerate(*this)) {
-        bs[i] = bool(t);
-    }
-    return bs;
+    return std::bitset<D>(m_bits);
 }
 
 template<int D, typename T>
-auto coord_mask<D, T>::possible_cells(const coord_type &coord) const -> std::set<coord_type> {
-    std::bitset<D> clamped_indices = as_bitset();
+auto coord_mask<D, T>::possible_cells(const coord_type &coord) const -> cell_list {
 #if defined(_DEBUG)
     for (int i = 0; i < D; ++i) {
-        if (clamped_indices[i]) {
-            assert((*this)[i] == coord[i]);
+        if (is_bound(i)) {
+            assert(m_coords[i] == coord[i]);
         }
     }
 #endif
-    std::set<coord_type> ret;
-    for (int i = 0; i < (2 << D); ++i) {
-        std::bitset<D> bs(i);
-        if ((bs & clamped_indices) == bs) {
-
+    // a point on a plane is in the cells on either side of it, so every subset of the bound axes
+    // picks a cell by stepping back along those axes.
+    // Subsets are walked with axis 0 as the most significant bit, from the largest down, which
+    // produces the cells in lexicographic order
+    cell_list ret;
+    for (int i = AllBits; i >= 0; --i) {
+        BitsType bs = 0;
+        for (int j = 0; j < D; ++j) {
+            bs |= ((i >> (D - 1 - j)) & 1) << j;
+        }
+        if ((bs & m_bits) == bs) {
             coord_type cc = coord;
             for (int j = 0; j < D; ++j) {
-                cc[j] -= bs[j] ? 1 : 0;
+                cc[j] -= (bs >> j) & 1;
             }
-            ret.emplace(cc);
+            ret.push_back(cc);
         }
     }
     return ret;
 }
+
+template<typename CellList>
+CellList intersect_cells(const CellList &a, const CellList &b) {
+    CellList ret;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(ret));
+    return ret;
+}
 }// namespace mandoline
@@ -47,7 +47,7 @@ struct CoordMaskedGeometry : public coord_mask<D> {
     coord_type get_min_coord(Func &&f) const;
 
     template<typename Func>
-    std::set<coord_type> possible_cells(Func &&f) const;
+    typename coord_mask<D>::cell_list possible_cells(Func &&f) const;
     //std::set<coord_type> possible_cells(const mtao::vector<Vertex<D>> &vertices) const;
 
     bool operator<(const CoordMaskedGeometry &other) const;
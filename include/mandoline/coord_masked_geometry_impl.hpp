@@ -119,7 +119,7 @@ auto CoordMaskedGeometry<D, IndexContainerType>::get_min_coord(Func &&f) const -
 //
 template<int D, typename IndexContainerType>
 template <typename Func>
-auto CoordMaskedGeometry<D, IndexContainerType>::possible_cells(Func&& f) const -> std::set<coord_type> {
+auto CoordMaskedGeometry<D, IndexContainerType>::possible_cells(Func&& f) const -> typename coord_mask<D>::cell_list {
     // pick out the bottom left corner to help the mask have a reference
     return mask().possible_cells(get_min_coord(indices, f));
 }
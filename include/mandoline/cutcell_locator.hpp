@@ -0,0 +1,41 @@
+#pragma once
+#include "mandoline/mesh3.hpp"
+#include <Eigen/Geometry>
+
+
+namespace mandoline {
+
+// Point location on a CutCellMesh<3> for large batches of queries.
+// CutCellMesh<3>::get_cell_index rediscovers the cut cells of a grid cell and copies the vertices on every call;
+// the locator builds those once: cached vertices, a CSR map from grid cells to the cut cells inside them and
+// a bounding box per cut cell so that only plausible cells are tested with solid angles.
+// The mesh has to outlive the locator.
+class CutCellLocator {
+  public:
+    using coord_type = CutCellMesh<3>::coord_type;
+    using BBox = Eigen::AlignedBox<double, 3>;
+
+    CutCellLocator(const CutCellMesh<3> &mesh);
+
+    // cell containing the world space point p. -2 outside of the grid, -1 if no cell was found.
+    // Unlike get_cell_index this does not log, and if no cut cell passes the solid angle test the candidate
+    // with the largest solid angle is returned (points on a shared face)
+    int locate(const mtao::Vec3d &p) const;
+    // locate for every column, evaluated in parallel
+    mtao::VecXi locate(const mtao::ColVecs3d &P) const;
+
+    // the cut cells inside a grid cell
+    std::vector<int> cells_in_grid_cell(const coord_type &c) const;
+    const BBox &bounding_box(int cut_cell_index) const { return m_bounding_boxes.at(cut_cell_index); }
+
+  private:
+    int grid_cell_index(const coord_type &c) const;
+
+    const CutCellMesh<3> &m_mesh;
+    mtao::ColVecs3d m_V;
+    // cut cells of grid cell g are m_grid_cell_cells[m_grid_cell_offsets[g]:m_grid_cell_offsets[g+1]]
+    std::vector<int> m_grid_cell_offsets;
+    std::vector<int> m_grid_cell_cells;
+    std::vector<BBox> m_bounding_boxes;
+};
+}// namespace mandoline
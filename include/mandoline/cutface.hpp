@@ -103,6 +103,8 @@ struct CutFace<3> : public CutFaceBase<3> {
 
     std::optional<mtao::ColVecs3d> triangulated_vertices;
     std::optional<mtao::ColVecs3i> triangulation;
+    // triangulations that only use the mesh vertices are stored with the face when serialized
+    bool has_persistent_triangulation() const { return triangulation && !triangulated_vertices; }
 
     template<typename Derived>
     mtao::Vec3d brep_centroid(const Eigen::MatrixBase<Derived> &V, bool use_triangulation = false) const;
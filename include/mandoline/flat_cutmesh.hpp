@@ -0,0 +1,179 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+
+namespace mandoline {
+template<int D>
+struct CutCellMesh;
+
+// A flat binary container for CutCellMesh<3>.
+// Everything is stored as little-endian arrays of int32, uint8 or double behind a fixed header and a
+// section table, with every section 64 byte aligned, so a file can be mmaped and read in place.
+// The layout of each section is documented on its enumerator below; "per face" / "per cell" arrays are
+// indexed like CutCellMesh<3>::faces() / cells().
+namespace flat {
+    constexpr static char magic[8] = { 'M', 'N', 'D', 'L', 'F', 'L', 'A', 'T' };
+    constexpr static uint32_t version = 1;
+    constexpr static size_t alignment = 64;
+    constexpr static const char *extension = ".flatcutmesh";
+
+    enum class Section : uint32_t {
+        VertexCoords = 0,// int32 x3 per cut vertex
+        VertexQuotients,// double x3 per cut vertex
+        VertexClamped,// uint8 per cut vertex, bit i = clamped_indices[i]
+        FaceNormals,// double x3 per face
+        FaceIds,// int32 x2 per face, {axis,coord} for axial faces and {-1,triangle} for mesh faces
+        FaceBoundaries,// int32 x2 per face, {cell,sign} of external_boundary or {0,-1} without one
+        FaceLoopOffsets,// int32, face count + 1 offsets into LoopOffsets
+        LoopOffsets,// int32, loop count + 1 offsets into LoopIndices
+        LoopIndices,// int32 vertex indices of every boundary loop
+        FaceTriangleOffsets,// int32, face count + 1 offsets (in triangles) into FaceTriangles
+        FaceTriangles,// int32 x3 cached face triangulations
+        CellInfo,// int32 x5 per cell: index, region, grid cell
+        CellOffsets,// int32, cell count + 1 offsets into CellFaces / CellSigns
+        CellFaces,// int32 face of each cell entry
+        CellSigns,// uint8 sign of each cell entry
+        MeshFaceInfo,// int32 x2 per barycentric mesh face: cut face, parent triangle
+        MeshFaceOffsets,// int32, mesh face count + 1 offsets (in points) into MeshFaceBarycentrics
+        MeshFaceBarycentrics,// double x3
+        OrigV,// double x3 per input vertex
+        OrigF,// int32 x3 per input triangle
+        FoldedFaces,// int32
+        Cubes,// int32 x5 per adaptive cube: index, corner, width
+        CubeRegions,// int32 x2: cube index, region
+        Count
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t section_count;
+        double origin[3];
+        double dx[3];
+        // vertex shape of the grid
+        int32_t shape[3];
+        uint32_t reserved;
+    };
+    struct SectionEntry {
+        uint32_t id;
+        // size of the scalar type stored in the section
+        uint32_t scalar_size;
+        // from the start of the file
+        uint64_t offset;
+        // number of scalars
+        uint64_t count;
+    };
+    static_assert(sizeof(Header) == 80);
+    static_assert(sizeof(SectionEntry) == 24);
+
+    template<typename T>
+    struct Span {
+        const T *ptr = nullptr;
+        size_t count = 0;
+        const T *data() const { return ptr; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const T *begin() const { return ptr; }
+        const T *end() const { return ptr + count; }
+        const T &operator[](size_t i) const { return ptr[i]; }
+    };
+
+    // whether the file starts with the flat container magic
+    bool is_flat_file(const std::string &filename);
+}// namespace flat
+
+// Read-only view of a flat cutmesh file. The file is memory mapped where possible (read into memory otherwise),
+// and all accessors point into the mapping without copying. Only the view is zero-copy: CutCellMesh<3>::from_flat
+// copies every section into the mesh's own vectors, maps and sets.
+class FlatCutMeshView {
+  public:
+    template<typename T>
+    using Span = flat::Span<T>;
+    template<int Rows, typename T>
+    using ColMap = Eigen::Map<const Eigen::Matrix<T, Rows, Eigen::Dynamic>>;
+
+    FlatCutMeshView() = default;
+    FlatCutMeshView(const std::string &filename);
+    FlatCutMeshView(FlatCutMeshView &&);
+    FlatCutMeshView &operator=(FlatCutMeshView &&);
+    FlatCutMeshView(const FlatCutMeshView &) = delete;
+    FlatCutMeshView &operator=(const FlatCutMeshView &) = delete;
+    ~FlatCutMeshView();
+
+    // false if the file could not be opened or is not a valid flat cutmesh
+    bool valid() const { return m_data != nullptr; }
+    bool memory_mapped() const { return m_mapped; }
+    size_t file_size() const { return m_size; }
+
+    const flat::Header &header() const;
+    std::array<double, 3> origin() const;
+    std::array<double, 3> dx() const;
+    std::array<int, 3> shape() const;
+
+    size_t vertex_count() const { return vertex_clamped().size(); }
+    size_t face_count() const { return face_loop_offsets().empty() ? 0 : face_loop_offsets().size() - 1; }
+    size_t cell_count() const { return cell_offsets().empty() ? 0 : cell_offsets().size() - 1; }
+    size_t cube_count() const { return cubes().size() / 5; }
+
+    // raw sections, empty if absent or of the wrong scalar type
+    template<typename T>
+    Span<T> section(flat::Section s) const;
+
+    ColMap<3, int32_t> vertex_coords() const { return cols<3, int32_t>(flat::Section::VertexCoords); }
+    ColMap<3, double> vertex_quotients() const { return cols<3, double>(flat::Section::VertexQuotients); }
+    Span<uint8_t> vertex_clamped() const { return section<uint8_t>(flat::Section::VertexClamped); }
+    ColMap<3, double> face_normals() const { return cols<3, double>(flat::Section::FaceNormals); }
+    ColMap<2, int32_t> face_ids() const { return cols<2, int32_t>(flat::Section::FaceIds); }
+    ColMap<2, int32_t> face_boundaries() const { return cols<2, int32_t>(flat::Section::FaceBoundaries); }
+    Span<int32_t> face_loop_offsets() const { return section<int32_t>(flat::Section::FaceLoopOffsets); }
+    Span<int32_t> loop_offsets() const { return section<int32_t>(flat::Section::LoopOffsets); }
+    Span<int32_t> loop_indices() const { return section<int32_t>(flat::Section::LoopIndices); }
+    Span<int32_t> face_triangle_offsets() const { return section<int32_t>(flat::Section::FaceTriangleOffsets); }
+    ColMap<3, int32_t> face_triangles() const { return cols<3, int32_t>(flat::Section::FaceTriangles); }
+    ColMap<5, int32_t> cell_info() const { return cols<5, int32_t>(flat::Section::CellInfo); }
+    Span<int32_t> cell_offsets() const { return section<int32_t>(flat::Section::CellOffsets); }
+    Span<int32_t> cell_faces() const { return section<int32_t>(flat::Section::CellFaces); }
+    Span<uint8_t> cell_signs() const { return section<uint8_t>(flat::Section::CellSigns); }
+    ColMap<2, int32_t> mesh_face_info() const { return cols<2, int32_t>(flat::Section::MeshFaceInfo); }
+    Span<int32_t> mesh_face_offsets() const { return section<int32_t>(flat::Section::MeshFaceOffsets); }
+    ColMap<3, double> mesh_face_barycentrics() const { return cols<3, double>(flat::Section::MeshFaceBarycentrics); }
+    ColMap<3, double> origV() const { return cols<3, double>(flat::Section::OrigV); }
+    ColMap<3, int32_t> origF() const { return cols<3, int32_t>(flat::Section::OrigF); }
+    Span<int32_t> folded_faces() const { return section<int32_t>(flat::Section::FoldedFaces); }
+    Span<int32_t> cubes() const { return section<int32_t>(flat::Section::Cubes); }
+    Span<int32_t> cube_regions() const { return section<int32_t>(flat::Section::CubeRegions); }
+
+  private:
+    template<int Rows, typename T>
+    ColMap<Rows, T> cols(flat::Section s) const {
+        auto sp = section<T>(s);
+        return ColMap<Rows, T>(sp.data(), Rows, sp.size() / Rows);
+    }
+    const flat::SectionEntry *find(flat::Section s) const;
+    bool validate();
+    void close();
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    // backing storage when the file could not be mapped
+    std::vector<char> m_buffer;
+};
+
+template<typename T>
+auto FlatCutMeshView::section(flat::Section s) const -> Span<T> {
+    const flat::SectionEntry *e = find(s);
+    if (e == nullptr || e->scalar_size != sizeof(T)) {
+        return {};
+    }
+    return { reinterpret_cast<const T *>(m_data + e->offset), size_t(e->count) };
+}
+
+// writes mesh in the flat container format, returns false if the file could not be written
+bool write_flat_cutmesh(const CutCellMesh<3> &mesh, const std::string &filename);
+}// namespace mandoline
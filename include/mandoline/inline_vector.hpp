@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+
+
+namespace mandoline {
+// A vector with a fixed capacity that lives entirely inside the object, for the short lists
+// (possible cells of a vertex etc) that are created in the inner loops of the generators
+template<typename T, size_t N>
+struct inline_vector {
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    inline_vector() = default;
+    inline_vector(std::initializer_list<T> l) {
+        for (auto &&v : l) {
+            push_back(v);
+        }
+    }
+    template<typename It>
+    inline_vector(It b, It e) {
+        for (; b != e; ++b) {
+            push_back(*b);
+        }
+    }
+
+    constexpr static size_t capacity() { return N; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    void clear() { m_size = 0; }
+
+    void push_back(const T &v) {
+        assert(m_size < N);
+        m_data[m_size++] = v;
+    }
+    template<typename... Args>
+    T &emplace_back(Args &&... args) {
+        assert(m_size < N);
+        return m_data[m_size++] = T(std::forward<Args>(args)...);
+    }
+
+    T &operator[](size_t i) { return m_data[i]; }
+    const T &operator[](size_t i) const { return m_data[i]; }
+    T *data() { return m_data.data(); }
+    const T *data() const { return m_data.data(); }
+    iterator begin() { return m_data.data(); }
+    iterator end() { return m_data.data() + m_size; }
+    const_iterator begin() const { return m_data.data(); }
+    const_iterator end() const { return m_data.data() + m_size; }
+
+    bool operator==(const inline_vector &o) const {
+        if (m_size != o.m_size) {
+            return false;
+        }
+        for (size_t i = 0; i < m_size; ++i) {
+            if (!(m_data[i] == o.m_data[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const inline_vector &o) const { return !(*this == o); }
+
+  private:
+    std::array<T, N> m_data;
+    size_t m_size = 0;
+};
+}// namespace mandoline
@@ -7,6 +7,7 @@
 #include <mtao/geometry/mesh/halfedge.hpp>
 #include <array>
 #include <map>
+#include <memory>
 #include <vector>
 #include "cutmesh.pb.h"
 #include <set>
@@ -66,6 +67,8 @@ struct CutCellMeshBase : public mtao::geometry::grid::StaggeredGrid<double, D> {
     bool empty() const;// return if the grid is an empty grid!
 
     ColVecs vertices() const;
+    // vertices() built on first use and shared with copies of this mesh, prefer it over vertices() in loops
+    const ColVecs &cached_vertices() const;
     ColVecs grid_space_vertices() const;
     ColVecs dual_vertices() const;
     ColVecs cut_vertices_colvecs() const;
@@ -119,6 +122,9 @@ struct CutCellMeshBase : public mtao::geometry::grid::StaggeredGrid<double, D> {
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   protected:
+    // has to be called whenever the grid or the cut vertices change
+    void invalidate_vertex_cache() { m_vertex_cache.reset(); }
+
     //Original mesh
     ColVecs m_origV;
     mtao::ColVecs2i m_origE;
@@ -128,6 +134,9 @@ struct CutCellMeshBase : public mtao::geometry::grid::StaggeredGrid<double, D> {
     GridDatab m_active_grid_cell_mask;
     std::vector<CutEdge<D>> m_cut_edges;
     std::map<int, InterpolatedEdge> m_mesh_cut_edges;
+
+  private:
+    mutable std::shared_ptr<const ColVecs> m_vertex_cache;
 };
 template<int D>
 struct CutCellMesh;
@@ -1,5 +1,6 @@
 #pragma once
 #include "mandoline/cutcell.hpp"
+#include "mandoline/cell_face_incidence.hpp"
 #include "mandoline/cutface.hpp"
 #include "mandoline/barycentric_triangle_face.hpp"
 #include "mesh.hpp"
@@ -14,12 +15,15 @@ namespace construction {
     class CutCellGenerator;
     template<>
     class CutCellGenerator<3>;
+    class CutCellMeshStitcher;
 }// namespace construction
+class FlatCutMeshView;
 template<>
 struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
     // NOTE: Grid index of -1 == inside stencil, -2 == boundary
   public:
     friend class construction::CutCellGenerator<3>;
+    friend class construction::CutCellMeshStitcher;
     using Base = CutCellMeshBase<3, CutCellMesh<3>>;
     using coord_type = typename Base::coord_type;
     using ColVecs = typename Base::ColVecs;
@@ -48,7 +52,14 @@ struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
     const std::vector<CutFace<3>>&faces() const { return m_faces; }
     const std::vector<CutFace<3>>&cut_faces() const { return m_faces; }
     const CutFace<3>&cut_face(size_t index) const { return m_faces.at(index); }
-    const auto &cells() const { return m_cells; }
+    // compatibility shim: the per cell face maps are built from cell_face_incidence the first time they're asked for
+    const std::vector<CutCell> &cells() const;
+    // the faces of every cut cell, built when the mesh is generated or loaded
+    const CellFaceIncidence &cell_face_incidence() const { return m_cell_face_incidence; }
+    // index, region and grid cell of cut cell i, without building the face maps of cells()
+    int cut_cell_index(int i) const { return m_cells[i].index; }
+    int cut_cell_region(int i) const { return m_cells[i].region; }
+    const coord_type &cut_cell_grid_cell(int i) const { return m_cells[i].grid_cell; }
     const ExteriorGridType &exterior_grid() const { return m_exterior_grid; }
     const mtao::ColVecs3i &origF() const { return m_origF; }
     const mtao::map<int, BarycentricTriangleFace> &mesh_cut_faces() const { return m_mesh_cut_faces; }
@@ -68,6 +79,8 @@ struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
     std::map<coord_type, std::set<int>> cells_by_grid_cell() const;
     std::set<int> cells_in_grid_cell(const coord_type &c) const;
     int get_cell_index(const VecCRef &p) const;
+    // get_cell_index for every column of P in parallel. builds a CutCellLocator, keep one around for repeated queries
+    mtao::VecXi get_cell_indices(const ColVecs &P) const;
 
     //info on faces
     size_t face_size() const;
@@ -127,14 +140,26 @@ struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
     std::set<int> cell_faces(int idx) const;
 
     //serialization
-    void write(const std::string &filename) const;
-    void serialize(protobuf::CutMeshProto &) const;
+    // version 1 writes a message per vertex, face and cell, version 2 writes packed columns (see cutmesh.proto).
+    // readers from before version 2 see a version 2 message as an empty mesh, so version 1 stays the default
+    constexpr static int proto_version = 1;
+    void write(const std::string &prefix, int version = proto_version) const;
+    void serialize(protobuf::CutMeshProto &, int version = proto_version) const;
+    // reads either version, throws std::runtime_error for an unknown version or packed columns that are malformed
+    // or index outside the grid or input mesh
     static CutCellMesh<3> from_proto(const protobuf::CutMeshProto &);
     static CutCellMesh<3> from_proto(const std::string &filename);
+    // flat binary container (flat_cutmesh.hpp), written with write_flat_cutmesh.
+    // copies out of the view, so the file can be closed afterwards.
+    // throws std::runtime_error if a section is missing, doesn't agree with the others or indexes outside the grid or input mesh
+    static CutCellMesh<3> from_flat(const FlatCutMeshView &);
+    static CutCellMesh<3> from_flat(const std::string &filename);
 
 
     //Caches triangulations for each CutFace, important for triangulating things like cells
-    void triangulate_faces(bool add_verts = true);
+    //Faces that already have a usable triangulation (e.g loaded from a file) are skipped unless force is set.
+    //Only triangulations without added vertices are serialized
+    void triangulate_faces(bool add_verts = true, bool force = false);
 
     //If the input ColVecs3d has nonzero size then the mesh is with reference to those vertices
     //Triangulation of different mesh elements
@@ -161,7 +186,11 @@ struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
   private:
     //Primary geometry data
     std::vector<CutFace<3>> m_faces;
+    // index, region and grid cell of every cut cell. Their face maps are only filled while a mesh
+    // is assembled, update_cell_face_incidence moves them into m_cell_face_incidence
     std::vector<CutCell> m_cells;
+    CellFaceIncidence m_cell_face_incidence;
+    mutable std::shared_ptr<const std::vector<CutCell>> m_cell_maps;
 
     ExteriorGridType m_exterior_grid;
 #if defined(MANDOLINE_USE_ADAPTIVE_GRID)
@@ -183,6 +212,12 @@ struct CutCellMesh<3> : public CutCellMeshBase<3, CutCellMesh<3>> {
 
 
   private:
+    // has to be called whenever m_cells changes, empties the face maps of m_cells
+    void update_cell_face_incidence();
+    void serialize_v1(protobuf::CutMeshProto &) const;
+    void serialize_v2(protobuf::CutMeshProto &) const;
+    void deserialize_v1(const protobuf::CutMeshProto &);
+    void deserialize_v2(const protobuf::CutMeshProto &);
     void write_obj(const std::string &prefix, const std::set<int> &indices, const std::optional<int> &region = {}, bool show_indices = false, bool show_base = true, bool show_flaps = false, bool mesh_face = false) const;
     //mtao::ColVecs3i origF;
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
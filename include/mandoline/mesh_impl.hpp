@@ -63,6 +63,18 @@ auto CutCellMeshBase<D, Derived>::vertices() const -> ColVecs {
     return mtao::eigen::hstack(StaggeredGrid::vertices(), cut_vertices_colvecs());
 }
 template<int D, typename Derived>
+auto CutCellMeshBase<D, Derived>::cached_vertices() const -> const ColVecs & {
+    auto cache = std::atomic_load(&m_vertex_cache);
+    if (!cache) {
+        auto built = std::make_shared<const ColVecs>(vertices());
+        // if another thread finished first keep its copy so references already handed out stay valid
+        if (std::atomic_compare_exchange_strong(&m_vertex_cache, &cache, built)) {
+            cache = std::move(built);
+        }
+    }
+    return *cache;
+}
+template<int D, typename Derived>
 auto CutCellMeshBase<D, Derived>::grid_space_vertices() const -> ColVecs {
     return mtao::eigen::hstack(StaggeredGrid::local_vertices(), cut_vertices_colvecs());
 }
@@ -0,0 +1,97 @@
+#pragma once
+#include "mandoline/mesh3.hpp"
+#include <Eigen/SparseCholesky>
+#include <memory>
+#include <vector>
+
+
+namespace mandoline::operators {
+
+// The DEC operators of a CutCellMesh<3>, computed once so loops that use them every step don't rebuild the
+// boundary operator, volumes and hodge stars from the mesh each time.
+// The divergence B^T W and laplacian B^T W B + diag(C) depend on a face weight W (dual_hodge2 by default) and a
+// cell weight C (zero by default). Their sparsity patterns don't depend on the weights, so changing them only
+// refills the values and factorization() only redoes the numeric part of the factorization
+class OperatorCache {
+  public:
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using Factorization = Eigen::SimplicialLDLT<SparseMatrix>;
+
+    OperatorCache(const CutCellMesh<3> &ccm);
+    OperatorCache(OperatorCache &&) = default;
+    OperatorCache &operator=(OperatorCache &&) = default;
+
+    size_t cell_size() const { return m_cell_volumes.size(); }
+    size_t face_size() const { return m_face_volumes.size(); }
+
+    // cell -> face boundary operator without the domain boundary faces, boundary(ccm,false)
+    const SparseMatrix &boundary() const { return m_boundary; }
+
+    const mtao::VecXd &cell_volumes() const { return m_cell_volumes; }
+    const mtao::VecXd &face_volumes() const { return m_face_volumes; }
+    const mtao::VecXd &dual_edge_lengths() const { return m_dual_edge_lengths; }
+    const mtao::VecXd &dual_hodge2() const { return m_dual_hodge2; }
+    const mtao::VecXd &primal_hodge2() const { return m_primal_hodge2; }
+    const mtao::VecXd &dual_hodge3() const { return m_dual_hodge3; }
+    const mtao::VecXd &primal_hodge3() const { return m_primal_hodge3; }
+    const mtao::ColVecs3d &face_centroids() const { return m_face_centroids; }
+    const mtao::ColVecs3d &cell_centroids() const { return m_cell_centroids; }
+    const std::vector<int> &regions() const { return m_regions; }
+    const mtao::VecXd &mesh_face_mask() const { return m_mesh_face_mask; }
+
+    // the W in the divergence and laplacian
+    const mtao::VecXd &face_weights() const { return m_face_weights; }
+    // e.g mesh_face_mask().cwiseProduct(dual_hodge2()) to drop the mesh faces.
+    // throws std::invalid_argument if W doesn't have a weight per face
+    void set_face_weights(const mtao::VecXd &W);
+    // the C added to the diagonal of the laplacian
+    const mtao::VecXd &cell_weights() const { return m_cell_weights; }
+    // e.g dual_hodge3() / dt for an implicit diffusion step. Without it (or some dirichlet faces) the laplacian
+    // has the constants of every region in its kernel.
+    // throws std::invalid_argument if C doesn't have a weight per cell
+    void set_cell_weights(const mtao::VecXd &C);
+
+    // primal-2 form -h> dual-1 -d> dual-0, B^T W
+    const SparseMatrix &divergence() const { return m_divergence; }
+    // primal-3 -d> primal-2 form -h> dual-1 -d> dual-0, B^T W B + diag(C)
+    const SparseMatrix &laplacian() const { return m_laplacian; }
+
+    // LDLT of laplacian(). The symbolic analysis happens on the first call, later calls only factorize again
+    // if the face weights changed
+    const Factorization &factorization();
+
+  private:
+    void build_laplacian_pattern();
+    void update_weighted_operators();
+
+    SparseMatrix m_boundary;
+    mtao::VecXd m_cell_volumes;
+    mtao::VecXd m_face_volumes;
+    mtao::VecXd m_dual_edge_lengths;
+    mtao::VecXd m_dual_hodge2;
+    mtao::VecXd m_primal_hodge2;
+    mtao::VecXd m_dual_hodge3;
+    mtao::VecXd m_primal_hodge3;
+    mtao::ColVecs3d m_face_centroids;
+    mtao::ColVecs3d m_cell_centroids;
+    std::vector<int> m_regions;
+    mtao::VecXd m_mesh_face_mask;
+
+    mtao::VecXd m_face_weights;
+    mtao::VecXd m_cell_weights;
+    // B^T, whose columns are scaled by the face weights to make the divergence
+    SparseMatrix m_boundary_transpose;
+    SparseMatrix m_divergence;
+    SparseMatrix m_laplacian;
+    // for every stored entry k of the laplacian, faces[offsets[k]:offsets[k+1]] contribute coefficients * W(face) to it
+    std::vector<int> m_laplacian_offsets;
+    // the stored entry of the diagonal of every cell
+    std::vector<int> m_laplacian_diagonal;
+    std::vector<int> m_laplacian_faces;
+    std::vector<double> m_laplacian_coefficients;
+
+    // SimplicialLDLT can't be moved
+    std::unique_ptr<Factorization> m_factorization;
+    bool m_factorization_current = false;
+};
+}// namespace mandoline::operators
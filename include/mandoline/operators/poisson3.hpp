@@ -0,0 +1,70 @@
+#pragma once
+#include "mandoline/mesh3.hpp"
+#include <Eigen/Sparse>
+#include <array>
+#include <vector>
+
+
+namespace mandoline::operators {
+
+struct AssembledMultigridPCGOptions {
+    // relative residual at which the conjugate gradient iterations stop
+    double tolerance = 1e-6;
+    int max_iterations = 500;
+    // weighted jacobi sweeps before and after the coarse grid correction
+    int smoothing_steps = 2;
+    double jacobi_weight = .6;
+    // the hierarchy stops coarsening once a level has at most this many cells, which is then solved directly
+    int coarsest_size = 1000;
+    int max_levels = 20;
+};
+
+// Multigrid preconditioned conjugate gradient for the cut-cell Poisson problem B^T W B x = b, where B is the
+// cell -> face boundary operator and W = mesh_face_mask * dual_hodge2 (the laplacian examples/laplacian assembles).
+// The operator is assembled: B is turned into per face couplings and those into a per cell stencil (a CSR matrix
+// without the Eigen overhead) on every level, and conjugate gradient is preconditioned with a geometric multigrid V-cycle. Coarse cells are unions of the cells in a 2^l block of the grid
+// (cut cells by their grid cell, adaptive grid cubes by their corner, so a cube is never split) that share a region,
+// and coarse operators are the galerkin products of the piecewise constant prolongation.
+// The laplacian is singular with pure neumann boundaries, b should then be orthogonal to the constants of every region
+class AssembledMultigridPCG {
+  public:
+    using coord_type = std::array<int, 3>;
+    struct Level;
+
+    AssembledMultigridPCG(const CutCellMesh<3> &ccm, const AssembledMultigridPCGOptions &options = AssembledMultigridPCGOptions());
+    // B is faces x cells with at most two entries per face, cell_coords/cell_regions are used to pick coarse cells
+    AssembledMultigridPCG(const Eigen::SparseMatrix<double> &B, const mtao::VecXd &face_weights, const std::vector<coord_type> &cell_coords, const std::vector<int> &cell_regions, const AssembledMultigridPCGOptions &options = AssembledMultigridPCGOptions());
+    AssembledMultigridPCG(AssembledMultigridPCG &&);
+    AssembledMultigridPCG &operator=(AssembledMultigridPCG &&);
+    ~AssembledMultigridPCG();
+
+    // the hierarchy is built by the constructor, changing coarsest_size or max_levels afterwards has no effect
+    const AssembledMultigridPCGOptions &options() const { return m_options; }
+    AssembledMultigridPCGOptions &options() { return m_options; }
+
+    int rows() const;
+    int level_count() const;
+    // number of cells in a level of the hierarchy, level 0 is the cut-cell mesh
+    int level_size(int level) const;
+
+    // the laplacian applied to x
+    mtao::VecXd apply(const mtao::VecXd &x) const;
+    // the assembled laplacian, for comparisons with sparse solvers
+    Eigen::SparseMatrix<double> matrix() const;
+
+    mtao::VecXd solve(const mtao::VecXd &b);
+    // number of iterations and relative residual of the last solve
+    int iterations() const { return m_iterations; }
+    double error() const { return m_error; }
+
+  private:
+    void build_hierarchy();
+    // approximately solves level l with a V-cycle, x is overwritten
+    void vcycle(int level, const mtao::VecXd &b, mtao::VecXd &x);
+
+    AssembledMultigridPCGOptions m_options;
+    std::vector<Level> m_levels;
+    int m_iterations = 0;
+    double m_error = 0;
+};
+}// namespace mandoline::operators
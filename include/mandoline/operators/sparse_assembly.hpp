@@ -0,0 +1,79 @@
+#pragma once
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+
+namespace mandoline::operators {
+
+// Assembles a column major sparse matrix without a triplet list.
+// visit(i, emit) is called for every source i in [0,sources) and calls emit(row, col, value) for each of its entries.
+// Every source is visited twice (once to count the nonzeros of each column, once to fill the preallocated
+// compressed arrays), both times in parallel, so visit has to produce the same entries each time.
+// Duplicate entries are summed like setFromTriplets, and the result does not depend on the thread count.
+template<typename Visitor>
+Eigen::SparseMatrix<double> assemble_sparse(int rows, int cols, int sources, Visitor &&visit) {
+    std::vector<int> offsets(cols + 1, 0);
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < sources; ++i) {
+        visit(i, [&](int, int col, double) {
+#pragma omp atomic
+            offsets[col + 1]++;
+        });
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+    std::vector<std::pair<int, double>> entries(offsets.back());
+#pragma omp parallel for
+    for (i = 0; i < sources; ++i) {
+        visit(i, [&](int row, int col, double value) {
+            int pos;
+#pragma omp atomic capture
+            pos = cursor[col]++;
+            entries[pos] = { row, value };
+        });
+    }
+
+    // threads filled each column in an arbitrary order, sorting by (row,value) makes it deterministic
+    std::vector<int> sizes(cols, 0);
+#pragma omp parallel for
+    for (i = 0; i < cols; ++i) {
+        auto b = entries.begin() + offsets[i];
+        auto e = entries.begin() + offsets[i + 1];
+        if (b == e) continue;
+        std::sort(b, e);
+        auto out = b;
+        for (auto it = b + 1; it != e; ++it) {
+            if (it->first == out->first) {
+                out->second += it->second;
+            } else {
+                *++out = *it;
+            }
+        }
+        sizes[i] = std::distance(b, out) + 1;
+    }
+
+    Eigen::SparseMatrix<double> A(rows, cols);
+    A.makeCompressed();
+    int *outer = A.outerIndexPtr();
+    outer[0] = 0;
+    for (int j = 0; j < cols; ++j) {
+        outer[j + 1] = outer[j] + sizes[j];
+    }
+    A.resizeNonZeros(outer[cols]);
+    int *inner = A.innerIndexPtr();
+    double *values = A.valuePtr();
+#pragma omp parallel for
+    for (i = 0; i < cols; ++i) {
+        for (int k = 0; k < sizes[i]; ++k) {
+            auto &&[row, value] = entries[offsets[i] + k];
+            inner[outer[i] + k] = row;
+            values[outer[i] + k] = value;
+        }
+    }
+    return A;
+}
+}// namespace mandoline::operators
@@ -27,4 +27,10 @@ mtao::VecXd primal_hodge3(const CutCellMesh<3> &ccm);
 // cell_volumes
 // dual 0 -> primal 3
 mtao::VecXd dual_hodge3(const CutCellMesh<3> &ccm);
+
+// the hodge stars above from volumes that were already computed
+mtao::VecXd dual_hodge2(const mtao::VecXd &face_volumes, const mtao::VecXd &dual_edge_lengths);
+mtao::VecXd primal_hodge2(const mtao::VecXd &face_volumes, const mtao::VecXd &dual_edge_lengths);
+mtao::VecXd dual_hodge3(const mtao::VecXd &cell_volumes);
+mtao::VecXd primal_hodge3(const mtao::VecXd &cell_volumes);
 }// namespace mandoline::operators
@@ -67,7 +67,7 @@ struct Vertex {
     size_t clamped_count() const;
     bool is_grid_vertex() const;
     bool is_in_cell(const coord_type &c) const;//closed cell concept
-    std::set<coord_type> possible_cells() const;
+    typename MaskType::cell_list possible_cells() const;
     //std::set<coord_type> possible_faces() const;
 
     //Thresholding
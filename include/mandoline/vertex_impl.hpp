@@ -127,7 +127,7 @@ auto Vertex<D>::mask() const -> MaskType {
     MaskType m;
     for (int i = 0; i < D; ++i) {
         if (quot(i) == 0) {
-            m[i] = coord[i];
+            m.bind(i, coord[i]);
         }
     }
     return m;
@@ -162,7 +162,7 @@ bool Vertex<D>::is_grid_vertex() const {
 }
 
 template<int D>
-auto Vertex<D>::possible_cells() const -> std::set<coord_type> {
+auto Vertex<D>::possible_cells() const -> typename MaskType::cell_list {
     return mask().possible_cells(coord);
     /*
             std::set<coord_type> ret;
@@ -2,9 +2,14 @@
 #include "mandoline/operators/boundary3.hpp"
 #include <mtao/eigen/stl2eigen.hpp>
 #include <set>
+#include <algorithm>
+#ifdef MTAO_OPENMP
+#include <omp.h>
+#endif
 #include <spdlog/spdlog.h>
 #include "mandoline/proto_util.hpp"
 #include <iterator>
+#include <cmath>
 #include <mtao/logging/logger.hpp>
 namespace mandoline {
 template<typename GridB>
@@ -231,92 +236,128 @@ auto AdaptiveGrid::boundary_triplets(int offset, bool domain_boundary) const ->
     return operators::boundary_triplets(*this,offset,domain_boundary);
 }
 auto AdaptiveGrid::faces(const GridData3i &grid) const -> std::vector<Face> {
-    auto myless = [](const Face &a, const Face &b) {
-        if(a.axis() == b.axis()) {
-        return std::less<Edge>()(a.dual_edge, b.dual_edge);
-        } else {
-            return a.axis() < b.axis();
-        }
-    };
-    std::set<Face, decltype(myless)> faces(myless);
-    auto add_bdry = [&](int d, int a, int b) {
-        if (a != b) {
-            Edge dual_edge{ { a, b } };
-            int axis = d, width;
-            coord_type corner;
-            if (a < 0 && b < 0) {
-                return;
-            } else if (a == -2 && b >= 0) {
-                auto &&c = cell(b);
-                corner = c.corner();
-                width = c.width();
-            } else if (b == -2 && a >= 0) {
-                auto &&c = cell(a);
-                corner = c.corner();
-                width = c.width();
+    // the face between the cells of a dual edge, -2 stands for the domain boundary
+    auto make_face = [&](int d, int a, int b) -> Face {
+        Edge dual_edge{ { a, b } };
+        int axis = d, width;
+        coord_type corner;
+        if (a == -2) {
+            auto &&c = cell(b);
+            corner = c.corner();
+            width = c.width();
+        } else if (b == -2) {
+            auto &&c = cell(a);
+            corner = c.corner();
+            width = c.width();
+            corner[d] += width;
+        } else if (is_valid_edge(dual_edge)) {
+            auto &&ca = cell(a);
+            auto &&cb = cell(b);
+            width = std::min(ca.width(), cb.width());
+            //if higher one is the smaller one we just use it
+            if (width == cb.width()) {//checking cb is important
+                corner = cb.corner();
+            } else {
+                corner = ca.corner();
                 corner[d] += width;
-            } else if (is_valid_edge(dual_edge)) {
-                auto &&ca = cell(a);
-                auto &&cb = cell(b);
-                width = std::min(ca.width(), cb.width());
-                //if higher one is the smaller one we just use it
-                if (width == cb.width()) {//checking cb is important
-                    corner = cb.corner();
-                } else {
-                    corner = ca.corner();
-                    corner[d] += width;
-                }
             }
-            //spdlog::info("Adding dual edge {} {}",dual_edge[0],dual_edge[1]);
-            faces.emplace(Square{ corner, axis, width }, dual_edge);
         }
+        return Face(Square{ corner, axis, width }, dual_edge);
     };
-    for (int d = 0; d < 3; ++d) {
-        auto shape = cell_shape();
-        shape[d]++;
-        coord_type abc;
-        for (int &a = abc[0] = 0; a < shape[0]; ++a) {
-            for (int &b = abc[1] = 0; b < shape[1]; ++b) {
-                for (int &c = abc[2] = 0; c < shape[2]; ++c) {
-                    bool low = abc[d] == 0;
-                    bool high = abc[d] == shape[d] - 1;
-                    //fmt::print("{} {} {}\n", a,b,c);
-                    if (low) {// if one of htem but not when theres both
-                        int val = grid(abc);
-                        if(val >= 0) {
-                            add_bdry(d, -2, val);
-                        }
-                    } else if (high) {
-                        // if we're high we have to go down one grid cell
-                        coord_type tmp = abc;
-                        tmp[d]--;
-                        int val = grid(tmp);
-                        if(val >= 0) {
-                            add_bdry(d, val, -2);
-                        }
-                    } else {
-                        int pidx = cell_index(abc);
-                        coord_type tmp = abc;
-                        tmp[d]--;
-                        int nidx = cell_index(tmp);
-                        int pid = grid.get(pidx);
-                        int nid = grid.get(nidx);
-                        if (pid >= 0 && nid >= 0) {
-                            add_bdry(d, nid, pid);
+
+    // Every face is found from the cube above it (or below it on the upper domain boundary), so only the
+    // surfaces of the cubes are scanned instead of every staggered face of the grid.
+    // Faces go into per thread, per axis buckets that are sorted by dual edge at the end, which reproduces
+    // the (axis, dual edge) order faces always had regardless of how the cubes were split between threads
+    std::vector<const std::pair<const int, Cell> *> cubes;
+    cubes.reserve(m_cells.size());
+    for (auto &&pr : m_cells) {
+        cubes.emplace_back(&pr);
+    }
+    auto shape = cell_shape();
+    int bucket_count = 1;
+#ifdef MTAO_OPENMP
+    bucket_count = omp_get_max_threads();
+#endif
+    std::vector<std::array<std::vector<Face>, 3>> buckets(bucket_count);
+    int i;
+#ifdef MTAO_OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+    for (i = 0; i < cubes.size(); ++i) {
+        auto &&[cid, cube] = *cubes[i];
+        int thread = 0;
+#ifdef MTAO_OPENMP
+        thread = omp_get_thread_num();
+#endif
+        auto &bucket = buckets[thread];
+        const coord_type &corner = cube.corner();
+        const int width = cube.width();
+        for (int d = 0; d < 3; ++d) {
+            auto &faces = bucket[d];
+            if (corner[d] == 0) {
+                faces.emplace_back(make_face(d, -2, cid));
+            } else {
+                // sweep the lower side of the cube, consecutive grid cells usually belong to the same neighbor
+                const int u = (d + 1) % 3;
+                const int v = (d + 2) % 3;
+                coord_type abc = corner;
+                abc[d]--;
+                int last = -1;
+                for (abc[u] = corner[u]; abc[u] < corner[u] + width; ++abc[u]) {
+                    for (abc[v] = corner[v]; abc[v] < corner[v] + width; ++abc[v]) {
+                        int nid = grid(abc);
+                        if (nid >= 0 && nid != last && nid != cid) {
+                            faces.emplace_back(make_face(d, nid, cid));
                         }
+                        last = nid;
                     }
                 }
             }
+            if (corner[d] + width == shape[d]) {
+                faces.emplace_back(make_face(d, cid, -2));
+            }
         }
     }
 
-    std::vector<Face> faces_vec(faces.size());
-    std::copy(faces.begin(), faces.end(), faces_vec.begin());
+    auto edge_less = [](const Face &a, const Face &b) {
+        return std::less<Edge>()(a.dual_edge, b.dual_edge);
+    };
+    auto edge_equal = [](const Face &a, const Face &b) {
+        return a.dual_edge == b.dual_edge;
+    };
+    std::array<std::vector<Face>, 3> axis_faces;
+    int d;
+#pragma omp parallel for
+    for (d = 0; d < 3; ++d) {
+        auto &faces = axis_faces[d];
+        size_t size = 0;
+        for (auto &&bucket : buckets) {
+            size += bucket[d].size();
+        }
+        faces.reserve(size);
+        for (auto &&bucket : buckets) {
+            std::move(bucket[d].begin(), bucket[d].end(), std::back_inserter(faces));
+        }
+        // duplicates of a dual edge all have the same geometry, so it doesn't matter which one survives
+        std::sort(faces.begin(), faces.end(), edge_less);
+        faces.erase(std::unique(faces.begin(), faces.end(), edge_equal), faces.end());
+    }
+
+    std::vector<Face> faces_vec;
+    faces_vec.reserve(axis_faces[0].size() + axis_faces[1].size() + axis_faces[2].size());
+    for (auto &&faces : axis_faces) {
+        std::move(faces.begin(), faces.end(), std::back_inserter(faces_vec));
+    }
 
     return faces_vec;
 }
 void AdaptiveGrid::make_faces() {
-    m_faces = faces(cell_ownership_grid());
+    update_ownership_grid();
+    m_faces = faces(m_ownership_grid);
+}
+void AdaptiveGrid::update_ownership_grid() {
+    m_ownership_grid = cell_ownership_grid();
 }
 
 mtao::VecXd AdaptiveGrid::dual_edge_lengths() const {
@@ -324,8 +365,10 @@ mtao::VecXd AdaptiveGrid::dual_edge_lengths() const {
     if (num_faces() == 0) return {};
     auto &dx = Base::dx();
     mtao::VecXd ret(num_faces());
-    for (auto &&[i, f] : mtao::iterator::enumerate(m_faces)) {
-        auto &&e = f.dual_edge;
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < m_faces.size(); ++i) {
+        auto &&e = m_faces[i].dual_edge;
         if (!is_valid_edge(e)) continue;
         auto [a, b] = e;
         ret(i) = (dx.asDiagonal() * (cell(a).center() - cell(b).center())).norm();
@@ -366,7 +409,10 @@ mtao::VecXd AdaptiveGrid::face_volumes(bool mask_grid_boundary) const {
             dws(i) *= dx((j + i) % 3);
         }
     }
-    for (auto &&[i, f] : mtao::iterator::enumerate(m_faces)) {
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < m_faces.size(); ++i) {
+        auto &f = m_faces[i];
         auto &&e = f.dual_edge;
         if (mask_grid_boundary && !is_valid_edge(e)) continue;
         int w = f.width();
@@ -490,6 +536,21 @@ int AdaptiveGrid::get_cell_index(const Vec &p) const {
     if (p.minCoeff() < 0 || (p.array() > (mshape.cast<double>().array())).any()) {
         return -2;
     }
+    if (!has_ownership_grid() || !p.allFinite()) {
+        return get_cell_index_linear(p);
+    }
+    coord_type c;
+    auto &&cs = cell_shape();
+    for (int d = 0; d < 3; ++d) {
+        c[d] = int(std::floor(p(d)));
+        // cells are half open, so points on the far side of the grid belong to no cell
+        if (c[d] >= cs[d]) {
+            return -1;
+        }
+    }
+    return m_ownership_grid(c[0], c[1], c[2]);
+}
+int AdaptiveGrid::get_cell_index_linear(const Vec &p) const {
     for (auto &&[i, c] : cells()) {
         if (c.is_inside(p)) {
             return i;
@@ -497,6 +558,15 @@ int AdaptiveGrid::get_cell_index(const Vec &p) const {
     }
     return -1;
 }
+mtao::VecXi AdaptiveGrid::get_cell_indices(const mtao::ColVecs3d &P) const {
+    mtao::VecXi R(P.cols());
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < P.cols(); ++i) {
+        R(i) = get_cell_index(P.col(i));
+    }
+    return R;
+}
 int AdaptiveGrid::num_edges() const {
     return m_edges.size();
 }
@@ -0,0 +1,22 @@
+#include "mandoline/cell_face_incidence.hpp"
+
+
+namespace mandoline {
+CellFaceIncidence::CellFaceIncidence(const std::vector<CutCell> &cells) {
+    m_offsets.resize(cells.size() + 1);
+    m_offsets[0] = 0;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        m_offsets[i + 1] = m_offsets[i] + cells[i].size();
+    }
+    m_faces.resize(m_offsets.back());
+    m_signs.resize(m_offsets.back());
+    for (size_t i = 0; i < cells.size(); ++i) {
+        int k = m_offsets[i];
+        for (auto &&[f, s] : cells[i]) {
+            m_faces[k] = f;
+            m_signs[k] = s;
+            ++k;
+        }
+    }
+}
+}// namespace mandoline
@@ -1,5 +1,6 @@
 #include "mandoline/construction/adaptive_grid_factory.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
 
 
 namespace mandoline::construction {
@@ -381,42 +382,177 @@ AdaptiveGridFactory::AdaptiveGridFactory(const GridData3 &mask) : original(!mask
         }
     }
 }
+AdaptiveGridFactory::AdaptiveGridFactory(const GridData3 &mask, int branching_factor, bool balanced) : AdaptiveGridFactory(mask) {
+    if (branching_factor < 2) {
+        spdlog::warn("Adaptive grid branching factor {} is invalid, using {}", branching_factor, width);
+        branching_factor = width;
+    }
+    this->branching_factor = branching_factor;
+    this->balanced = balanced;
+}
 void AdaptiveGridFactory::make_cells(const std::optional<int> &max_level) {
 
     cells.clear();
 
-    for (auto &&[level, g] : mtao::iterator::enumerate(levels)) {
-
-        if (max_level && *max_level == level) {
-            if (level == 0) {
-
-                make_cells(original, 0);
-                break;
-            } else {
-                auto &g = levels[level - 1];
-                GridData3 A(g.shape());
-                std::transform(g.begin(), g.end(), A.begin(), [&](const ActiveMask &mask) -> bool {
-                    return !mask.none();
-                });
-                make_cells(A, level);
-                break;
+    auto free_blocks = free_block_masks(max_level);
+    const int top = free_blocks.size() - 1;
+    int jump = 1;
+    for (int level = 0; level < top; ++level) {
+        jump *= branching_factor;
+    }
+    // a free block becomes a cube unless its parent block is free too
+    for (int level = top; level >= 0; --level) {
+        auto &&g = free_blocks[level];
+        for (int a = 0; a < g.shape()[0]; ++a) {
+            for (int b = 0; b < g.shape()[1]; ++b) {
+                for (int c = 0; c < g.shape()[2]; ++c) {
+                    if (!g(a, b, c)) continue;
+                    if (level < top && free_blocks[level + 1](a / branching_factor, b / branching_factor, c / branching_factor)) continue;
+                    add_cell(coord_type{ { jump * a, jump * b, jump * c } }, jump);
+                }
             }
-        } else {
-
-            for (int a = 0; a < g.shape()[0]; ++a) {
-                for (int b = 0; b < g.shape()[1]; ++b) {
-                    for (int c = 0; c < g.shape()[2]; ++c) {
-                        auto &&m = g(a, b, c);
-                        if (m.any()) {
-                            make_cells(g(a, b, c), level, coord_type{ { a, b, c } });
+        }
+        jump /= branching_factor;
+    }
+    if (balanced) {
+        balance_cells();
+    }
+}
+auto AdaptiveGridFactory::free_block_masks(const std::optional<int> &max_level) const -> std::vector<GridData3> {
+    std::vector<GridData3> ret;
+    ret.emplace_back(GridData3::Constant(false, original.shape()));
+    {
+        auto &g = ret.back();
+        std::transform(original.begin(), original.end(), g.begin(), [](bool active) { return !active; });
+    }
+    // blocks that stick out of the grid are never free, so the last level is the one where a block spans the grid
+    while (!max_level || int(ret.size()) <= *max_level) {
+        const GridData3 &prev = ret.back();
+        coord_type shape = prev.shape();
+        if (*std::max_element(shape.begin(), shape.end()) < branching_factor) {
+            break;
+        }
+        for (auto &&s : shape) {
+            s = (s + branching_factor - 1) / branching_factor;
+        }
+        GridData3 next = GridData3::Constant(false, shape);
+        bool any_free = false;
+        int a;
+#pragma omp parallel for reduction(|| : any_free)
+        for (a = 0; a < shape[0]; ++a) {
+            for (int b = 0; b < shape[1]; ++b) {
+                for (int c = 0; c < shape[2]; ++c) {
+                    coord_type base{ { branching_factor * a, branching_factor * b, branching_factor * c } };
+                    bool is_free = true;
+                    for (int d = 0; d < 3 && is_free; ++d) {
+                        is_free = base[d] + branching_factor <= prev.shape()[d];
+                    }
+                    for (int i = 0; i < branching_factor && is_free; ++i) {
+                        for (int j = 0; j < branching_factor && is_free; ++j) {
+                            for (int k = 0; k < branching_factor && is_free; ++k) {
+                                is_free = prev(base[0] + i, base[1] + j, base[2] + k);
+                            }
+                        }
+                    }
+                    next(a, b, c) = is_free;
+                    any_free = any_free || is_free;
+                }
+            }
+        }
+        if (!any_free) {
+            break;
+        }
+        ret.emplace_back(std::move(next));
+    }
+    return ret;
+}
+int AdaptiveGridFactory::cell_level(int cell_width) const {
+    int level = 0;
+    for (; cell_width > 1; cell_width /= branching_factor) {
+        level++;
+    }
+    return level;
+}
+void AdaptiveGridFactory::balance_cells() {
+    const coord_type shape = original.shape();
+    auto level_width = [&](int level) {
+        int w = 1;
+        for (int j = 0; j < level; ++j) {
+            w *= branching_factor;
+        }
+        return w;
+    };
+    // level of the cube owning each grid cell, cut-cells are level 0
+    GridData3i levels_grid = GridData3i::Constant(0, shape);
+    auto fill = [&](const coord_type &corner, int width, int level) {
+        for (int a = corner[0]; a < corner[0] + width; ++a) {
+            for (int b = corner[1]; b < corner[1] + width; ++b) {
+                for (int c = corner[2]; c < corner[2] + width; ++c) {
+                    levels_grid(a, b, c) = level;
+                }
+            }
+        }
+    };
+    auto too_coarse = [&](const coord_type &corner, int width, int level) -> bool {
+        for (int d = 0; d < 3; ++d) {
+            const int u = (d + 1) % 3;
+            const int v = (d + 2) % 3;
+            for (int x : { corner[d] - 1, corner[d] + width }) {
+                if (x < 0 || x >= shape[d]) continue;
+                coord_type abc;
+                abc[d] = x;
+                for (abc[u] = corner[u]; abc[u] < corner[u] + width; ++abc[u]) {
+                    for (abc[v] = corner[v]; abc[v] < corner[v] + width; ++abc[v]) {
+                        if (levels_grid(abc) < level - 1) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    };
+
+    // Cubes are visited from fine to coarse and split cubes are rechecked immediately. A split can still
+    // make a cube that was already accepted too coarse, so passes repeat until nothing is split
+    for (int splits = 1; splits > 0;) {
+        splits = 0;
+        std::vector<std::vector<coord_type>> cubes;
+        for (auto &&[cid, cell] : cells) {
+            int level = cell_level(cell.width());
+            if (level >= cubes.size()) {
+                cubes.resize(level + 1);
+            }
+            cubes[level].emplace_back(cell.corner());
+            fill(cell.corner(), cell.width(), level);
+        }
+        cells.clear();
+        std::vector<std::tuple<coord_type, int>> stack;
+        for (int level = 0; level < cubes.size(); ++level) {
+            for (auto &&corner : cubes[level]) {
+                stack.emplace_back(corner, level);
+                while (!stack.empty()) {
+                    auto [c, l] = stack.back();
+                    stack.pop_back();
+                    const int w = level_width(l);
+                    if (!too_coarse(c, w, l)) {
+                        add_cell(c, w);
+                        continue;
+                    }
+                    splits++;
+                    const int cw = w / branching_factor;
+                    fill(c, w, l - 1);
+                    for (int i = 0; i < branching_factor; ++i) {
+                        for (int j = 0; j < branching_factor; ++j) {
+                            for (int k = 0; k < branching_factor; ++k) {
+                                stack.emplace_back(coord_type{ { c[0] + i * cw, c[1] + j * cw, c[2] + k * cw } }, l - 1);
+                            }
                         }
                     }
                 }
             }
         }
     }
-    auto cell_grid = grid_from_cells(cells);
-    //print_grid(cell_grid);
 }
 auto AdaptiveGridFactory::grid_from_cells(const std::map<int, Cell> &cells) const -> GridData3i {
 
@@ -1,8 +1,289 @@
 #include "mandoline/construction/generator3.hpp"
 #include "mandoline/construction/construct.hpp"
+#include "mandoline/construction/cutmesh_stitcher.hpp"
 #include <mtao/geometry/bounding_box.hpp>
+#include <memory>
+#include <thread>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/version.h>
 
 namespace mandoline::construction {
+namespace {
+    using coord_type = std::array<int, 3>;
+#if TBB_VERSION_MAJOR >= 2021
+    constexpr auto pipeline_serial_in_order = tbb::filter_mode::serial_in_order;
+    constexpr auto pipeline_parallel = tbb::filter_mode::parallel;
+#else
+    constexpr auto pipeline_serial_in_order = tbb::filter::serial_in_order;
+    constexpr auto pipeline_parallel = tbb::filter::parallel;
+#endif
+
+    // a vertex of a triangle being clipped to a tile, along with its barycentric coordinates in that triangle
+    struct ClipVertex {
+        mtao::Vec3d p;
+        mtao::Vec3d bary;
+        int input = -1;
+    };
+
+    // clips a convex polygon against one side of an axis aligned plane
+    std::vector<ClipVertex> clip_polygon(const std::vector<ClipVertex> &P, int axis, double bound, bool upper) {
+        auto inside = [&](const ClipVertex &v) {
+            return upper ? v.p(axis) <= bound : v.p(axis) >= bound;
+        };
+        auto crossing = [&](ClipVertex a, ClipVertex b) {
+            // neighboring triangles see their shared edge in opposite directions, sort so they agree on the point
+            if (std::lexicographical_compare(b.p.data(), b.p.data() + 3, a.p.data(), a.p.data() + 3)) {
+                std::swap(a, b);
+            }
+            double t = (bound - a.p(axis)) / (b.p(axis) - a.p(axis));
+            ClipVertex r{ a.p + t * (b.p - a.p), a.bary + t * (b.bary - a.bary) };
+            r.p(axis) = bound;
+            return r;
+        };
+        std::vector<ClipVertex> R;
+        for (size_t i = 0; i < P.size(); ++i) {
+            auto &&cur = P[i];
+            auto &&prev = P[(i + P.size() - 1) % P.size()];
+            bool cur_in = inside(cur);
+            bool prev_in = inside(prev);
+            if (cur_in != prev_in) {
+                R.emplace_back(crossing(prev, cur));
+            }
+            if (cur_in) {
+                R.emplace_back(cur);
+            }
+        }
+        return R;
+    }
+
+    // cuts the triangles overlapping one block of the grid (plus its ghost layer) on a unit grid covering just that region
+    CutCellMeshStitcher::Tile make_tile(const mtao::ColVecs3d &GV, const mtao::ColVecs3i &F, const std::vector<int> &triangles, const coord_type &cell_shape, const coord_type &begin, const coord_type &end, int ghost_layers, const std::optional<double> &threshold) {
+        CutCellMeshStitcher::Tile tile;
+        tile.begin = begin;
+        tile.end = end;
+        coord_type tile_end, vertex_shape, owned_shape;
+        mtao::Vec3d offset;
+        for (int d = 0; d < 3; ++d) {
+            tile.offset[d] = std::max(0, begin[d] - ghost_layers);
+            tile_end[d] = std::min(cell_shape[d], end[d] + ghost_layers);
+            vertex_shape[d] = tile_end[d] - tile.offset[d] + 1;
+            owned_shape[d] = end[d] - begin[d];
+            offset(d) = tile.offset[d];
+        }
+
+        std::vector<mtao::Vec3d> TV;
+        std::vector<std::array<int, 3>> TF;
+        std::map<int, int> input_indices;
+        std::map<std::array<double, 3>, int> clip_indices;
+        auto tile_vertex = [&](const ClipVertex &v, const auto &tri) -> int {
+            if (v.input >= 0) {
+                auto [it, added] = input_indices.try_emplace(v.input, TV.size());
+                if (added) {
+                    TV.emplace_back(v.p - offset);
+                    tile.vertices.emplace_back(v.input);
+                }
+                return it->second;
+            } else {
+                auto [it, added] = clip_indices.try_emplace({ { v.p(0), v.p(1), v.p(2) } }, TV.size());
+                if (added) {
+                    // clipping interpolates barycentric coordinates, so a vertex on an input edge has an exact 0
+                    for (int j = 0; j < 3; ++j) {
+                        if (v.bary(j) == 0) {
+                            int a = tri((j + 1) % 3);
+                            int b = tri((j + 2) % 3);
+                            double t = v.bary((j + 2) % 3);
+                            if (a > b) {
+                                std::swap(a, b);
+                                t = 1 - t;
+                            }
+                            tile.clipped_vertices[TV.size()] = { a, b, t };
+                        }
+                    }
+                    TV.emplace_back(v.p - offset);
+                    tile.vertices.emplace_back(-1);
+                }
+                return it->second;
+            }
+        };
+        for (int f : triangles) {
+            auto tri = F.col(f);
+            std::vector<ClipVertex> P(3);
+            for (int j = 0; j < 3; ++j) {
+                P[j] = ClipVertex{ GV.col(tri(j)), mtao::Vec3d::Unit(j), tri(j) };
+            }
+            // the grid boundary is left alone, triangles leaving the grid are handled however from_grid handles them
+            bool clipped = false;
+            for (int d = 0; d < 3; ++d) {
+                for (auto &&v : P) {
+                    if ((tile.offset[d] > 0 && v.p(d) < tile.offset[d]) || (tile_end[d] < cell_shape[d] && v.p(d) > tile_end[d])) {
+                        clipped = true;
+                    }
+                }
+            }
+            if (!clipped) {
+                TF.push_back({ { tile_vertex(P[0], tri), tile_vertex(P[1], tri), tile_vertex(P[2], tri) } });
+                tile.triangles.emplace_back(f);
+                continue;
+            }
+            for (int d = 0; d < 3; ++d) {
+                if (tile.offset[d] > 0) {
+                    P = clip_polygon(P, d, tile.offset[d], false);
+                }
+                if (tile_end[d] < cell_shape[d]) {
+                    P = clip_polygon(P, d, tile_end[d], true);
+                }
+            }
+            P.erase(std::unique(P.begin(), P.end(), [](const ClipVertex &a, const ClipVertex &b) { return a.p == b.p; }), P.end());
+            while (P.size() > 1 && P.front().p == P.back().p) {
+                P.pop_back();
+            }
+            // the fan adds edges across the triangle that can run through owned cells, the stitcher
+            // removes them again by merging the pieces of each input triangle within a cell
+            for (size_t j = 1; j + 1 < P.size(); ++j) {
+                auto &&a = P[0];
+                auto &&b = P[j];
+                auto &&c = P[j + 1];
+                if ((b.p - a.p).cross(c.p - a.p).squaredNorm() == 0) {
+                    continue;
+                }
+                tile.clipped_triangles[TF.size()] = (Eigen::Matrix3d() << a.bary, b.bary, c.bary).finished();
+                TF.push_back({ { tile_vertex(a, tri), tile_vertex(b, tri), tile_vertex(c, tri) } });
+                tile.triangles.emplace_back(f);
+            }
+        }
+
+        auto tile_grid = mtao::geometry::grid::StaggeredGrid3d(mtao::geometry::grid::StaggeredGrid3d::GridType(vertex_shape, mtao::Vec3d::Ones()));
+        if (TF.empty()) {
+            tile.mesh = CutCellMesh<3>(tile_grid);
+            tile.exterior_mask = CutCellMeshStitcher::GridDatab::Constant(true, owned_shape);
+            return tile;
+        }
+
+        mtao::ColVecs3d V(3, TV.size());
+        for (int i = 0; i < V.cols(); ++i) {
+            V.col(i) = TV[i];
+        }
+        mtao::ColVecs3i Fs(3, TF.size());
+        for (int i = 0; i < Fs.cols(); ++i) {
+            Fs.col(i) = mtao::eigen::stl2eigen(TF[i]);
+        }
+        CutCellGenerator<3> ccg(V, tile_grid, threshold);
+        // the exterior grid is rebuilt over the whole grid by the stitcher, so keep this one as coarse as possible
+        ccg.adaptive_level = {};
+        {
+            auto t = mtao::logging::profiler("tile generator_bake", false, "profiler");
+            ccg.add_boundary_elements(Fs);
+            ccg.bake();
+        }
+        tile.mesh = ccg.generate();
+
+        auto &&mask = ccg.active_grid_cell_mask();
+        tile.exterior_mask = CutCellMeshStitcher::GridDatab::Constant(true, owned_shape);
+        for (int a = 0; a < owned_shape[0]; ++a) {
+            for (int b = 0; b < owned_shape[1]; ++b) {
+                for (int c = 0; c < owned_shape[2]; ++c) {
+                    tile.exterior_mask(a, b, c) = mask(a + begin[0] - tile.offset[0], b + begin[1] - tile.offset[1], c + begin[2] - tile.offset[2]);
+                }
+            }
+        }
+        return tile;
+    }
+
+    // splits the grid into blocks of tile_shape cells and buckets the input triangles into the blocks they touch
+    struct TileLayout {
+        TileLayout(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, const coord_type &tile_shape, std::optional<double> threshold_, int ghost_layers) : F(F), cell_shape(grid.cell_shape()), tile_shape(tile_shape), tile_counts(block_counts(cell_shape, tile_shape)), tile_indexer(tile_counts), threshold(threshold_) {
+            if (threshold && *threshold < 0) {
+                // the generator derives the default threshold from its grid, every tile has to use the full grid's value
+                auto &&vs = grid.vertex_shape();
+                int v = *std::max_element(vs.begin(), vs.end());
+                threshold = 2 * std::max<int>(1, v) * 1e-10;
+            }
+
+            // grid space positions computed the same way as CutCellEdgeGenerator::get_vertex, tiles only shift them by integers
+            auto &&vg = grid.vertex_grid();
+            GV.resize(3, V.cols());
+            for (int i = 0; i < V.cols(); ++i) {
+                GV.col(i) = V.col(i).cwiseQuotient(vg.dx()) - vg.origin().cwiseQuotient(vg.dx());
+            }
+
+            // triangles are clipped to the tile and its ghost layer, so the ghost layer only has to keep the clipped
+            // boundary away from the owned cells and doesn't depend on the size of the triangles
+            mtao::ColVecs3d tri_min(3, F.cols()), tri_max(3, F.cols());
+            ghost = std::max(1, ghost_layers);
+            for (int i = 0; i < F.cols(); ++i) {
+                auto f = F.col(i);
+                tri_min.col(i) = GV.col(f(0)).cwiseMin(GV.col(f(1))).cwiseMin(GV.col(f(2)));
+                tri_max.col(i) = GV.col(f(0)).cwiseMax(GV.col(f(1))).cwiseMax(GV.col(f(2)));
+            }
+
+            // bucket triangles into every tile (including ghost layers) their bounding box touches
+            tile_triangles.resize(tile_count());
+            auto t = mtao::logging::profiler("tile triangle bucketing", false, "profiler");
+            for (int i = 0; i < F.cols(); ++i) {
+                coord_type lo, hi;
+                for (int d = 0; d < 3; ++d) {
+                    lo[d] = std::clamp<int>(std::floor((tri_min(d, i) - ghost) / tile_shape[d]) - 1, 0, tile_counts[d] - 1);
+                    hi[d] = std::clamp<int>(std::floor((tri_max(d, i) + ghost) / tile_shape[d]), 0, tile_counts[d] - 1);
+                }
+                coord_type b;
+                for (b[0] = lo[0]; b[0] <= hi[0]; ++b[0]) {
+                    for (b[1] = lo[1]; b[1] <= hi[1]; ++b[1]) {
+                        for (b[2] = lo[2]; b[2] <= hi[2]; ++b[2]) {
+                            int index = tile_indexer.index(b);
+                            auto [begin, end] = tile_range(index);
+                            bool overlaps = true;
+                            for (int d = 0; d < 3; ++d) {
+                                double tile_lo = std::max(0, begin[d] - ghost);
+                                double tile_hi = std::min(cell_shape[d], end[d] + ghost);
+                                if (tri_max(d, i) < tile_lo || tri_min(d, i) > tile_hi) {
+                                    overlaps = false;
+                                }
+                            }
+                            if (overlaps) {
+                                tile_triangles[index].emplace_back(i);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        static coord_type block_counts(const coord_type &cell_shape, const coord_type &tile_shape) {
+            coord_type counts;
+            for (int d = 0; d < 3; ++d) {
+                counts[d] = (cell_shape[d] + tile_shape[d] - 1) / tile_shape[d];
+            }
+            return counts;
+        }
+        int tile_count() const { return tile_counts[0] * tile_counts[1] * tile_counts[2]; }
+        std::array<coord_type, 2> tile_range(int index) const {
+            coord_type b = tile_indexer.unindex(index);
+            coord_type begin, end;
+            for (int d = 0; d < 3; ++d) {
+                begin[d] = b[d] * tile_shape[d];
+                end[d] = std::min(cell_shape[d], begin[d] + tile_shape[d]);
+            }
+            return { { begin, end } };
+        }
+        // cuts a tile, its triangle bucket is released afterwards. safe to call concurrently for different tiles
+        CutCellMeshStitcher::Tile make(int index) {
+            auto [begin, end] = tile_range(index);
+            auto tile = make_tile(GV, F, tile_triangles[index], cell_shape, begin, end, ghost, threshold);
+            tile_triangles[index] = {};
+            return tile;
+        }
+
+        const mtao::ColVecs3i &F;
+        mtao::ColVecs3d GV;
+        coord_type cell_shape;
+        coord_type tile_shape;
+        coord_type tile_counts;
+        mtao::geometry::grid::indexing::OrderedIndexer<3> tile_indexer;
+        std::optional<double> threshold;
+        int ghost;
+        std::vector<std::vector<int>> tile_triangles;
+    };
+}// namespace
 
 CutCellMesh<3> from_bbox(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const Eigen::AlignedBox<double, 3> &bbox, const std::array<int, 3> &cell_shape, int level, std::optional<double> threshold) {
 
@@ -25,6 +306,65 @@ CutCellMesh<3> from_grid(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, con
     }
     return ccg.generate();
 }
+CutCellMesh<3> from_grid_tiled(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, const std::array<int, 3> &tile_shape, int level, std::optional<double> threshold, int max_concurrent_tiles, int ghost_layers) {
+    auto t = mtao::logging::profiler("tiled construction", false, "profiler");
+    TileLayout layout(V, F, grid, tile_shape, threshold, ghost_layers);
+    const int tile_count = layout.tile_count();
+
+    CutCellMeshStitcher stitcher(grid, V, F, tile_shape, level);
+    // tiles are cut in waves so at most max_concurrent_tiles generators are alive, and stitched in order
+    const int wave = std::max(1, max_concurrent_tiles);
+    for (int start = 0; start < tile_count; start += wave) {
+        const int wave_end = std::min(tile_count, start + wave);
+        std::vector<CutCellMeshStitcher::Tile> tiles(wave_end - start);
+#ifdef MTAO_OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(wave)
+#endif
+        for (int i = start; i < wave_end; ++i) {
+            tiles[i - start] = layout.make(i);
+        }
+        for (auto &&tile : tiles) {
+            stitcher.add_tile(tile);
+        }
+    }
+    return stitcher.generate();
+}
+CutCellMesh<3> from_grid_pipelined(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const mtao::geometry::grid::StaggeredGrid3d &grid, int axis, int slab_thickness, int level, std::optional<double> threshold, int max_slabs_in_flight, int ghost_layers) {
+    auto t = mtao::logging::profiler("pipelined construction", false, "profiler");
+    coord_type slab_shape = grid.cell_shape();
+    slab_shape[axis] = std::max(1, slab_thickness);
+    // every other axis has a single block, so the tile index is the slab index
+    TileLayout layout(V, F, grid, slab_shape, threshold, ghost_layers);
+    const int slab_count = layout.tile_count();
+    if (max_slabs_in_flight <= 0) {
+        max_slabs_in_flight = std::max<int>(2, std::thread::hardware_concurrency());
+    }
+
+    CutCellMeshStitcher stitcher(grid, V, F, slab_shape, level);
+    std::vector<std::unique_ptr<CutCellMeshStitcher::Tile>> slabs(slab_count);
+    int next_slab = 0;
+    // slabs are cut concurrently while the ones that finished are stitched in order, so stitching slab k
+    // overlaps with cutting slab k+1 (the stages of a single slab's bake don't overlap).
+    // the token count bounds how many slab generators are alive at once
+    tbb::parallel_pipeline(
+      max_slabs_in_flight,
+      tbb::make_filter<void, int>(pipeline_serial_in_order, [&](tbb::flow_control &fc) -> int {
+          if (next_slab >= slab_count) {
+              fc.stop();
+              return -1;
+          }
+          return next_slab++;
+      }) & tbb::make_filter<int, int>(pipeline_parallel, [&](int slab) -> int {
+          auto t = mtao::logging::profiler("slab construction", false, "profiler");
+          slabs[slab] = std::make_unique<CutCellMeshStitcher::Tile>(layout.make(slab));
+          return slab;
+      }) & tbb::make_filter<int, void>(pipeline_serial_in_order, [&](int slab) {
+          auto t = mtao::logging::profiler("slab stitching", false, "profiler");
+          stitcher.add_tile(*slabs[slab]);
+          slabs[slab].reset();
+      }));
+    return stitcher.generate();
+}
 CutCellMesh<3> from_grid_unnormalized(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const std::array<int, 3> &cell_shape, int level, std::optional<double> threshold) {
     using Vec = mtao::Vec3d;
     auto sg = CutCellMesh<3>::GridType(cell_shape, Vec::Ones());
@@ -42,6 +382,7 @@ DeformingGeometryConstructor::DeformingGeometryConstructor(const mtao::ColVecs3d
         _ccg->add_boundary_elements(F);
         _ccg->bake();
         _dirty = false;
+        _full_rebuild = false;
     }
 }
 DeformingGeometryConstructor::~DeformingGeometryConstructor() {
@@ -50,13 +391,38 @@ DeformingGeometryConstructor::~DeformingGeometryConstructor() {
 void DeformingGeometryConstructor::set_adaptivity(int res) {
     _ccg->adaptive_level = res;
     _dirty = true;
+    _full_rebuild = true;
+}
+void DeformingGeometryConstructor::set_incremental_intersections(bool incremental) {
+    _incremental_intersections = incremental;
+    _ccg->set_incremental(incremental);
 }
 void DeformingGeometryConstructor::update_vertices(const mtao::ColVecs3d &V, const std::optional<double> &threshold) {
+    if (_full_rebuild || V.cols() != _ccg->data().nV()) {
+        _ccg->update_vertices(V, threshold);
+        _dirty = true;
+        _full_rebuild = true;
+        return;
+    }
+    // compare the thresholded grid-space vertices so sub-threshold jitter doesn't count as motion
+    auto old_vertices = _ccg->data().V();
     _ccg->update_vertices(V, threshold);
-    _dirty = true;
+    auto &&new_vertices = _ccg->data().V();
+    for (int i = 0; i < new_vertices.size(); ++i) {
+        const auto &a = old_vertices[i];
+        const auto &b = new_vertices[i];
+        if (a != b || a.clamped_indices != b.clamped_indices) {
+            _moved_vertices.insert(i);
+        }
+    }
+    if (!_moved_vertices.empty()) {
+        _dirty = true;
+    }
 }
 void DeformingGeometryConstructor::update_topology(const mtao::ColVecs3i &F) {
     _ccg->set_boundary_elements(F);
+    _dirty = true;
+    _full_rebuild = true;
 }
 void DeformingGeometryConstructor::update_mesh(const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const std::optional<double> &threshold) {
 
@@ -67,12 +433,39 @@ void DeformingGeometryConstructor::update_mesh(const mtao::ColVecs3d &V, const m
 void DeformingGeometryConstructor::update_grid(const mtao::geometry::grid::StaggeredGrid3d &g) {
     _ccg->update_grid(g);
     _dirty = true;
+    _full_rebuild = true;
 }
 void DeformingGeometryConstructor::bake() {
     if (_dirty) {
-        _ccg->clear();
+        auto &&data = _ccg->data();
+        std::set<int> edges;
+        std::set<int> triangles;
+        if (_incremental_intersections && !_full_rebuild) {
+            auto is_moved = [&](int v) { return _moved_vertices.find(v) != _moved_vertices.end(); };
+            auto &&E = data.E();
+            auto &&F = data.F();
+            for (int i = 0; i < E.cols(); ++i) {
+                if (is_moved(E(0, i)) || is_moved(E(1, i))) {
+                    edges.insert(i);
+                }
+            }
+            for (int i = 0; i < F.cols(); ++i) {
+                if (is_moved(F(0, i)) || is_moved(F(1, i)) || is_moved(F(2, i))) {
+                    triangles.insert(i);
+                }
+            }
+        }
+        // if most of the mesh moved the bookkeeping isn't worth it
+        if (!_incremental_intersections || _full_rebuild || 2 * triangles.size() > data.nF()) {
+            _ccg->clear();
+        } else {
+            spdlog::trace("DeformingGeometryConstructor incremental bake: {}/{} triangles moved", triangles.size(), data.nF());
+            _ccg->clear_intersections(edges, triangles);
+        }
         _ccg->bake();
         _dirty = false;
+        _full_rebuild = false;
+        _moved_vertices.clear();
     }
     spdlog::trace("DeoformingGeometryConstructor Done Baking");
 }
@@ -96,12 +489,15 @@ CutCellMesh<3> DeformingGeometryConstructor::emit() const {
     return _ccg->generate();
 }
 
-DeformingGeometryConstructor::DeformingGeometryConstructor(DeformingGeometryConstructor &&o) : _ccg(o._ccg), _dirty(o._dirty) { o._ccg = nullptr; }
+DeformingGeometryConstructor::DeformingGeometryConstructor(DeformingGeometryConstructor &&o) : _ccg(o._ccg), _dirty(o._dirty), _full_rebuild(o._full_rebuild), _incremental_intersections(o._incremental_intersections), _moved_vertices(std::move(o._moved_vertices)) { o._ccg = nullptr; }
 DeformingGeometryConstructor &DeformingGeometryConstructor::operator=(DeformingGeometryConstructor &&o) {
     _ccg = o._ccg;
     o._ccg = nullptr;
 
     _dirty = o._dirty;
+    _full_rebuild = o._full_rebuild;
+    _incremental_intersections = o._incremental_intersections;
+    _moved_vertices = std::move(o._moved_vertices);
     return *this;
 }
 }// namespace mandoline::construction
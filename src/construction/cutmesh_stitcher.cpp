@@ -0,0 +1,680 @@
+#include "mandoline/construction/cutmesh_stitcher.hpp"
+#include "mandoline/construction/adaptive_grid_factory.hpp"
+#include <mtao/geometry/mesh/boundary_facets.h>
+#include <mtao/data_structures/disjoint_set.hpp>
+#include <mtao/iterator/enumerate.hpp>
+#include <mtao/logging/profiler.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <set>
+#include <stdexcept>
+
+namespace mandoline::construction {
+namespace {
+    // checks whether two copies of a face visit their vertices in the same direction
+    bool same_orientation(const std::set<std::vector<int>> &a, const std::set<std::vector<int>> &b) {
+        auto &&lb = *b.begin();
+        if (lb.size() < 2) {
+            return true;
+        }
+        for (auto &&la : a) {
+            auto it = std::find(la.begin(), la.end(), lb[0]);
+            if (it != la.end()) {
+                ++it;
+                if (it == la.end()) {
+                    it = la.begin();
+                }
+                return *it == lb[1];
+            }
+        }
+        return true;
+    }
+    std::vector<int> sorted_vertices(const std::set<std::vector<int>> &loops) {
+        std::vector<int> ret;
+        for (auto &&loop : loops) {
+            ret.insert(ret.end(), loop.begin(), loop.end());
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+    // the boundary of a union of consistently oriented single loop faces, empty if it isn't a single loop
+    std::vector<int> merge_loops(const std::vector<const std::vector<int> *> &loops) {
+        std::map<std::array<int, 2>, int> edges;
+        for (auto &&loop : loops) {
+            for (size_t j = 0; j < loop->size(); ++j) {
+                int a = (*loop)[j];
+                int b = (*loop)[(j + 1) % loop->size()];
+                // an edge shared by two of the faces shows up once in each direction
+                if (auto it = edges.find({ { b, a } }); it != edges.end()) {
+                    if (--it->second == 0) {
+                        edges.erase(it);
+                    }
+                } else {
+                    edges[{ { a, b } }]++;
+                }
+            }
+        }
+        std::map<int, int> next;
+        for (auto &&[e, count] : edges) {
+            if (count != 1 || !next.emplace(e[0], e[1]).second) {
+                return {};
+            }
+        }
+        std::vector<int> ret;
+        if (next.empty()) {
+            return ret;
+        }
+        int v = next.begin()->first;
+        do {
+            ret.emplace_back(v);
+            auto it = next.find(v);
+            if (it == next.end() || ret.size() > next.size()) {
+                return {};
+            }
+            v = it->second;
+        } while (v != ret.front());
+        if (ret.size() != next.size()) {
+            return {};
+        }
+        return ret;
+    }
+}// namespace
+
+CutCellMeshStitcher::CutCellMeshStitcher(const StaggeredGrid &grid, const mtao::ColVecs3d &V, const mtao::ColVecs3i &F, const coord_type &tile_shape, std::optional<int> adaptive_level) : m_grid(grid), m_grid_vertex_size(grid.vertex_size()), m_tile_shape(tile_shape), m_adaptive_level(adaptive_level), m_origV(V), m_origF(F), m_exterior_mask(GridDatab::Constant(false, grid.cell_shape())) {
+    if (F.size() > 0) {
+        m_origE = mtao::geometry::mesh::boundary_facets(F);
+    }
+    for (int i = 0; i < m_origE.cols(); ++i) {
+        auto e = m_origE.col(i);
+        m_edge_indices[{ { std::min(e(0), e(1)), std::max(e(0), e(1)) } }] = i;
+    }
+}
+
+bool CutCellMeshStitcher::is_seam(int axis, int coord) const {
+    return coord > 0 && coord < m_grid.cell_shape()[axis] && coord % m_tile_shape[axis] == 0;
+}
+bool CutCellMeshStitcher::is_owned(const Tile &tile, const coord_type &cell) const {
+    for (int d = 0; d < 3; ++d) {
+        if (cell[d] < tile.begin[d] || cell[d] >= tile.end[d]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CutCellMeshStitcher::weld_vertex(const Vertex<3> &v, const VertexSource &source) {
+    // tiles are cut in their own coordinates so a shared vertex can differ by rounding between them,
+    // but the input element it comes from and the grid planes it lies on are the same in both
+    int bits = 0;
+    coord_type planes = {};
+    if (source[0] != 0) {
+        for (int d = 0; d < 3; ++d) {
+            if (v.clamped(d) || v.quot(d) == 0) {
+                bits |= 1 << d;
+                planes[d] = v.coord[d];
+            }
+        }
+    }
+    auto [it, inserted] = m_seam_vertices.try_emplace({ source[0], source[1], bits, planes }, m_grid_vertex_size + m_cut_vertices.size());
+    if (inserted) {
+        m_cut_vertices.push_back(v);
+    }
+    return it->second;
+}
+
+auto CutCellMeshStitcher::vertex_sources(const Tile &tile, const std::vector<std::tuple<int, double, double>> &parent_edges) const -> std::vector<VertexSource> {
+    auto &&mesh = tile.mesh;
+    const int grid_vertex_size = mesh.StaggeredGrid::vertex_size();
+    std::vector<VertexSource> ret(mesh.vertex_size(), { { -1, -1 } });
+    // a vertex on several input elements is named after the lowest dimensional one, which every tile that has the vertex sees
+    for (auto &&[i, v] : mtao::iterator::enumerate(tile.vertices)) {
+        if (v >= 0) {
+            ret[grid_vertex_size + i] = { { 0, v } };
+        }
+    }
+    for (auto &&[i, abt] : tile.clipped_vertices) {
+        auto &&[a, b, t] = abt;
+        if (auto it = m_edge_indices.find({ { a, b } }); it != m_edge_indices.end()) {
+            ret[grid_vertex_size + i] = { { 1, it->second } };
+        }
+    }
+    for (auto &&[eidx, ie] : mesh.mesh_cut_edges()) {
+        int parent = std::get<0>(parent_edges[ie.parent_eid]);
+        if (parent < 0) {
+            continue;
+        }
+        for (int v : mesh.cut_edges()[eidx].indices) {
+            if (ret[v][0] < 0 && !mesh.is_grid_vertex(v)) {
+                ret[v] = { { 1, parent } };
+            }
+        }
+    }
+    for (auto &&[fid, btf] : mesh.mesh_cut_faces()) {
+        int parent = tile.triangles[btf.parent_fid];
+        for (auto &&loop : mesh.faces()[fid].indices) {
+            for (int v : loop) {
+                if (ret[v][0] < 0 && !mesh.is_grid_vertex(v)) {
+                    ret[v] = { { 2, parent } };
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+int CutCellMeshStitcher::stitch_vertex(const Tile &tile, int index, const std::vector<VertexSource> &sources, std::vector<int> &vertex_map) {
+    int &ret = vertex_map[index];
+    if (ret >= 0) {
+        return ret;
+    }
+    auto &&mesh = tile.mesh;
+    if (mesh.is_grid_vertex(index)) {
+        coord_type c = mesh.vertex_unindex(index);
+        for (int d = 0; d < 3; ++d) {
+            c[d] += tile.offset[d];
+        }
+        ret = m_grid.vertex_index(c);
+    } else {
+        Vertex<3> v = mesh.cut_vertex(index - mesh.StaggeredGrid::vertex_size());
+        bool seam = false;
+        for (int d = 0; d < 3; ++d) {
+            v.coord[d] += tile.offset[d];
+            if ((v.clamped(d) || v.quot(d) == 0) && is_seam(d, v.coord[d])) {
+                seam = true;
+            }
+        }
+        if (seam) {
+            if (sources[index][0] < 0) {
+                throw std::runtime_error("CutCellMeshStitcher: vertex " + std::to_string(index) + " on a block boundary doesn't lie on the input");
+            }
+            ret = weld_vertex(v, sources[index]);
+        } else {
+            ret = m_grid_vertex_size + m_cut_vertices.size();
+            m_cut_vertices.push_back(v);
+        }
+    }
+    return ret;
+}
+
+auto CutCellMeshStitcher::edge_map(const Tile &tile) const -> std::vector<std::tuple<int, double, double>> {
+    auto &&E = tile.mesh.m_origE;
+    std::vector<std::tuple<int, double, double>> ret(E.cols(), { -1, 0., 0. });
+    // {a, b, t} for a tile vertex on the input edge a < b, or {input vertex, -1, 0} for an input vertex
+    auto location = [&](int v) -> std::tuple<int, int, double> {
+        if (tile.vertices[v] >= 0) {
+            return { tile.vertices[v], -1, 0. };
+        } else if (auto it = tile.clipped_vertices.find(v); it != tile.clipped_vertices.end()) {
+            return it->second;
+        }
+        return { -1, -1, 0. };
+    };
+    // parameter of the input vertex v along the input edge a < b
+    auto endpoint = [](int v, int a, int b) -> std::optional<double> {
+        if (v == a) {
+            return 0.;
+        } else if (v == b) {
+            return 1.;
+        }
+        return {};
+    };
+    for (int i = 0; i < E.cols(); ++i) {
+        auto [a0, b0, t0] = location(E(0, i));
+        auto [a1, b1, t1] = location(E(1, i));
+        if (a0 < 0 || a1 < 0) {
+            continue;
+        }
+        int a = -1, b = -1;
+        std::optional<double> s0, s1;
+        if (b0 < 0 && b1 < 0) {
+            a = std::min(a0, a1);
+            b = std::max(a0, a1);
+            s0 = endpoint(a0, a, b);
+            s1 = endpoint(a1, a, b);
+        } else if (b0 < 0) {
+            a = a1;
+            b = b1;
+            s0 = endpoint(a0, a, b);
+            s1 = t1;
+        } else if (b1 < 0) {
+            a = a0;
+            b = b0;
+            s0 = t0;
+            s1 = endpoint(a1, a, b);
+        } else if (a0 == a1 && b0 == b1) {
+            a = a0;
+            b = b0;
+            s0 = t0;
+            s1 = t1;
+        }
+        if (!s0 || !s1) {
+            continue;
+        }
+        if (auto it = m_edge_indices.find({ { a, b } }); it != m_edge_indices.end()) {
+            if (m_origE(0, it->second) != a) {
+                *s0 = 1 - *s0;
+                *s1 = 1 - *s1;
+            }
+            ret[i] = { it->second, *s0, *s1 };
+        }
+    }
+    return ret;
+}
+
+void CutCellMeshStitcher::add_tile(const Tile &tile) {
+    auto t = mtao::logging::profiler("stitching tile", false, "profiler");
+    auto &&mesh = tile.mesh;
+    // the tile grid is unit spaced with its origin at zero, so these are tile grid coordinates
+    auto V = mesh.vertices();
+    std::vector<int> vertex_map(V.cols(), -1);
+    mtao::geometry::grid::indexing::OrderedIndexer<3> tile_cells(mesh.cell_shape());
+
+    // edges that clipping added across a triangle cross the grid at vertices from_grid doesn't have.
+    // they are dropped, and the faces and axial edges they split are joined back together
+    auto parent_edges = edge_map(tile);
+    const int new_vertex_offset = mesh.StaggeredGrid::vertex_size() + tile.vertices.size();
+    std::set<int> dropped;
+    for (auto &&[eidx, ie] : mesh.mesh_cut_edges()) {
+        if (std::get<0>(parent_edges[ie.parent_eid]) < 0) {
+            for (int v : mesh.cut_edges()[eidx].indices) {
+                if (v >= new_vertex_offset) {
+                    dropped.insert(v);
+                }
+            }
+        }
+    }
+    auto is_dropped = [&](int v) { return dropped.find(v) != dropped.end(); };
+    auto sources = vertex_sources(tile, parent_edges);
+
+    // stitches a face, or the pieces of one clipped input triangle within a cell merged into the loop
+    auto stitch_face = [&](const std::vector<int> &fids, const std::set<std::vector<int>> &tile_loops) -> std::tuple<int, bool> {
+        CutFace<3> f = mesh.faces()[fids.front()];
+        std::vector<int> first_loop;
+        std::set<std::vector<int>> loops;
+        for (auto &&loop : tile_loops) {
+            std::vector<int> l;
+            std::copy_if(loop.begin(), loop.end(), std::back_inserter(l), [&](int v) { return !is_dropped(v); });
+            if (first_loop.empty()) {
+                first_loop = l;
+            }
+            std::transform(l.begin(), l.end(), l.begin(), [&](int v) { return stitch_vertex(tile, v, sources, vertex_map); });
+            loops.emplace(std::move(l));
+        }
+        f.indices = std::move(loops);
+        f.triangulation = {};
+        f.triangulated_vertices = {};
+        bool seam = false;
+        for (int d = 0; d < 3; ++d) {
+            if (f[d] && is_seam(d, *f[d] + tile.offset[d])) {
+                seam = true;
+            }
+        }
+        if (f.is_mesh_face()) {
+            f.id = tile.triangles[f.as_face_id()];
+        } else {
+            auto [axis, coord] = f.as_axial_id();
+            f.id = std::array<int, 2>{ { axis, coord + tile.offset[axis] } };
+        }
+        if (f.external_boundary) {
+            auto &[cid, s] = *f.external_boundary;
+            if (cid >= 0) {
+                coord_type c = tile_cells.unindex(cid);
+                for (int d = 0; d < 3; ++d) {
+                    c[d] += tile.offset[d];
+                }
+                cid = m_grid.cell_index(c);
+            }
+        }
+
+        // faces on a block boundary are generated by the tiles on both sides of it
+        std::vector<int> key;
+        if (seam) {
+            key = sorted_vertices(f.indices);
+            if (auto it = m_seam_faces.find(key); it != m_seam_faces.end()) {
+                return { it->second, !same_orientation(m_faces[it->second].indices, f.indices) };
+            }
+        }
+        int index = m_faces.size();
+        if (seam) {
+            m_seam_faces.emplace(std::move(key), index);
+        }
+
+        // barycentric coordinates of every vertex of the pieces within their input triangle
+        std::map<int, mtao::Vec3d> barys;
+        int parent_fid = -1;
+        for (int fid : fids) {
+            if (auto it = mesh.mesh_cut_faces().find(fid); it != mesh.mesh_cut_faces().end()) {
+                auto &&btf = it->second;
+                mtao::ColVecs3d B = btf.barys;
+                if (auto cit = tile.clipped_triangles.find(btf.parent_fid); cit != tile.clipped_triangles.end()) {
+                    B = cit->second * B;
+                }
+                auto &&loop = *mesh.faces()[fid].indices.begin();
+                for (size_t j = 0; j < loop.size() && j < size_t(B.cols()); ++j) {
+                    barys[loop[j]] = B.col(j);
+                }
+                parent_fid = tile.triangles[btf.parent_fid];
+            }
+        }
+        if (parent_fid >= 0) {
+            BarycentricTriangleFace btf;
+            btf.parent_fid = parent_fid;
+            btf.barys.resize(3, first_loop.size());
+            for (size_t j = 0; j < first_loop.size(); ++j) {
+                auto it = barys.find(first_loop[j]);
+                btf.barys.col(j) = it == barys.end() ? mtao::Vec3d::Zero() : it->second;
+            }
+            m_mesh_cut_faces[index] = std::move(btf);
+        }
+        for (int fid : fids) {
+            if (mesh.is_folded_face(fid)) {
+                m_folded_faces.insert(index);
+            }
+        }
+        for (int d = 0; d < 3; ++d) {
+            if (mesh.m_axial_faces[d].find(fids.front()) != mesh.m_axial_faces[d].end()) {
+                m_axial_faces[d].insert(index);
+            }
+        }
+        m_faces.emplace_back(std::move(f));
+        return { index, false };
+    };
+
+    std::map<int, std::tuple<int, bool>> face_map;
+    std::map<std::vector<int>, std::tuple<int, bool>> merged_face_map;
+    for (auto &&cell : mesh.cells()) {
+        // a cut cell lies in a single grid cell, the center of its bounding box is strictly inside that cell
+        Eigen::AlignedBox<double, 3> bbox;
+        for (auto &&[fid, s] : cell) {
+            for (auto &&loop : mesh.faces()[fid].indices) {
+                for (auto &&v : loop) {
+                    bbox.extend(V.col(v));
+                }
+            }
+        }
+        if (bbox.isEmpty()) {
+            continue;
+        }
+        coord_type grid_cell;
+        mtao::Vec3d center = bbox.center();
+        for (int d = 0; d < 3; ++d) {
+            grid_cell[d] = int(std::floor(center(d))) + tile.offset[d];
+        }
+        if (!is_owned(tile, grid_cell)) {
+            continue;
+        }
+        CutCell c;
+        c.index = m_cells.size();
+        c.grid_cell = grid_cell;
+        auto add_face = [&](int fid, bool s) {
+            auto it = face_map.find(fid);
+            if (it == face_map.end()) {
+                it = face_map.emplace(fid, stitch_face({ fid }, mesh.faces()[fid].indices)).first;
+            }
+            auto [index, flip] = it->second;
+            c[index] = flip ? !s : s;
+        };
+        // input triangle -> the pieces of it that clipping made, which from_grid has as one face
+        std::map<int, std::vector<int>> pieces;
+        for (auto &&[fid, s] : cell) {
+            auto &&f = mesh.faces()[fid];
+            if (f.is_mesh_face() && tile.clipped_triangles.find(f.as_face_id()) != tile.clipped_triangles.end()) {
+                pieces[tile.triangles[f.as_face_id()]].emplace_back(fid);
+            } else {
+                add_face(fid, s);
+            }
+        }
+        for (auto &&[parent, fids] : pieces) {
+            const bool s = cell.at(fids.front());
+            if (fids.size() > 1) {
+                auto it = merged_face_map.find(fids);
+                if (it == merged_face_map.end()) {
+                    bool same_side = std::all_of(fids.begin(), fids.end(), [&](int fid) { return cell.at(fid) == s; });
+                    std::vector<const std::vector<int> *> loops;
+                    for (int fid : fids) {
+                        loops.emplace_back(&*mesh.faces()[fid].indices.begin());
+                    }
+                    if (auto loop = merge_loops(loops); same_side && !loop.empty()) {
+                        it = merged_face_map.emplace(fids, stitch_face(fids, { loop })).first;
+                    }
+                }
+                if (it == merged_face_map.end()) {
+                    // keeping the pieces would leave faces from_grid doesn't have along the clipping planes
+                    throw std::runtime_error(fmt::format("CutCellMeshStitcher: could not merge the {} pieces of clipped triangle {} in cell {},{},{}", fids.size(), parent, grid_cell[0], grid_cell[1], grid_cell[2]));
+                }
+                auto [index, flip] = it->second;
+                c[index] = flip ? !s : s;
+            } else {
+                add_face(fids.front(), s);
+            }
+        }
+        m_cells.emplace_back(std::move(c));
+    }
+
+    // axial edges split at a dropped vertex, which are joined back into a single edge
+    std::map<int, std::vector<int>> dropped_edges;
+    for (auto &&[eidx, e] : mtao::iterator::enumerate(mesh.cut_edges())) {
+        if (mesh.mesh_cut_edges().find(eidx) == mesh.mesh_cut_edges().end()) {
+            for (int v : e.indices) {
+                if (is_dropped(v)) {
+                    dropped_edges[v].emplace_back(eidx);
+                }
+            }
+        }
+    }
+    std::set<int> joined_edges;
+    // the first kept vertex reached by walking from v along edge eidx and on through dropped vertices, -1 if there is none
+    auto chain_end = [&](int eidx, int v) -> int {
+        while (true) {
+            auto &&indices = mesh.cut_edges()[eidx].indices;
+            v = indices[0] == v ? indices[1] : indices[0];
+            if (!is_dropped(v)) {
+                return v;
+            }
+            auto &&edges = dropped_edges[v];
+            if (edges.size() != 2) {
+                return -1;
+            }
+            eidx = edges[0] == eidx ? edges[1] : edges[0];
+            if (!joined_edges.insert(eidx).second) {
+                return -1;
+            }
+        }
+    };
+
+    // edges between two vertices of owned faces lie in the (convex) owned block
+    for (auto &&[eidx, e] : mtao::iterator::enumerate(mesh.cut_edges())) {
+        auto [a, b] = e.indices;
+        auto mesh_edge = mesh.mesh_cut_edges().find(eidx);
+        if (mesh_edge != mesh.mesh_cut_edges().end()) {
+            // edges that clipping added across a triangle aren't edges of the input
+            if (std::get<0>(parent_edges[mesh_edge->second.parent_eid]) < 0) {
+                continue;
+            }
+        } else if (is_dropped(a) || is_dropped(b)) {
+            // the inner pieces are reached from the ends of their chain
+            if ((is_dropped(a) && is_dropped(b)) || !joined_edges.insert(eidx).second) {
+                continue;
+            }
+            if (is_dropped(a)) {
+                a = chain_end(eidx, b);
+            } else {
+                b = chain_end(eidx, a);
+            }
+            if (a < 0 || b < 0) {
+                continue;
+            }
+        }
+        if (vertex_map[a] < 0 || vertex_map[b] < 0) {
+            continue;
+        }
+        CutEdge<3> edge = e;
+        edge.indices = { { vertex_map[a], vertex_map[b] } };
+        bool seam = false;
+        for (int d = 0; d < 3; ++d) {
+            if (e[d] && is_seam(d, *e[d] + tile.offset[d])) {
+                seam = true;
+            }
+        }
+        if (seam) {
+            std::array<int, 2> key{ { std::min(edge.indices[0], edge.indices[1]), std::max(edge.indices[0], edge.indices[1]) } };
+            if (!m_seam_edges.insert(key).second) {
+                continue;
+            }
+        }
+        if (edge.is_axial_edge()) {
+            auto [axis, coord] = edge.as_axial_id();
+            edge.id = std::array<int, 2>{ { axis, coord + tile.offset[axis] } };
+        }
+        int index = m_cut_edges.size();
+        if (mesh_edge != mesh.mesh_cut_edges().end()) {
+            InterpolatedEdge ie = mesh_edge->second;
+            // t0 and t1 are where the tile edge starts and ends on its input edge
+            auto [parent, t0, t1] = parent_edges[ie.parent_eid];
+            ie.parent_eid = parent;
+            edge.id = parent;
+            ie.ts = (t0 + (t1 - t0) * ie.ts.array()).matrix();
+            if (t1 < t0) {
+                std::swap(edge.indices[0], edge.indices[1]);
+                ie.ts = mtao::Vec2d(ie.ts(1), ie.ts(0));
+            }
+            m_mesh_cut_edges[index] = ie;
+        }
+        m_cut_edges.emplace_back(std::move(edge));
+    }
+
+    if (tile.exterior_mask.size() > 0) {
+        auto &&shape = tile.exterior_mask.shape();
+        for (int a = 0; a < shape[0]; ++a) {
+            for (int b = 0; b < shape[1]; ++b) {
+                for (int c = 0; c < shape[2]; ++c) {
+                    m_exterior_mask(a + tile.begin[0], b + tile.begin[1], c + tile.begin[2]) = tile.exterior_mask(a, b, c);
+                }
+            }
+        }
+    }
+}
+
+CutCellMesh<3> CutCellMeshStitcher::generate() const {
+    auto t = mtao::logging::profiler("stitching generate", false, "profiler");
+    CutCellMesh<3> ccm(m_grid, m_cut_vertices);
+    ccm.m_faces = m_faces;
+    for (auto &&f : ccm.m_faces) {
+        f.update_mask(ccm.cut_vertices(), ccm.vertex_grid());
+    }
+    ccm.m_cut_edges = m_cut_edges;
+    for (auto &&e : ccm.m_cut_edges) {
+        e.update_mask(ccm.cut_vertices(), ccm.vertex_grid());
+    }
+    ccm.m_mesh_cut_edges = m_mesh_cut_edges;
+    ccm.m_mesh_cut_faces = m_mesh_cut_faces;
+    ccm.m_axial_faces = m_axial_faces;
+    ccm.m_folded_faces = m_folded_faces;
+    ccm.m_cells = m_cells;
+    ccm.m_origV = m_origV;
+    ccm.m_origE = m_origE;
+    ccm.m_origF = m_origF;
+
+    // exterior cells are numbered after the cut cells, same as CutCellGenerator<3>
+    const int cut_cell_count = m_cells.size();
+    std::map<int, AdaptiveGrid::Cell> exterior_cells;
+    {
+        // built once over the whole grid so cubes aren't cut at block boundaries
+        auto t = mtao::logging::profiler("stitched adaptive grid", false, "profiler");
+        AdaptiveGridFactory factory(m_exterior_mask);
+        factory.make_cells(m_adaptive_level);
+        auto ag = factory.create();
+        for (auto &&[i, c] : mtao::iterator::enumerate(ag.cells())) {
+            exterior_cells[cut_cell_count + i] = std::get<1>(c);
+        }
+    }
+    ccm.m_exterior_grid = AdaptiveGrid(m_grid.vertex_shape(), exterior_cells);
+    auto &&ag = ccm.m_exterior_grid;
+
+    // regions have to be labeled globally, tiles only see part of each region
+    auto &&cells = ccm.m_cells;
+    const int max_cell_id = cut_cell_count + exterior_cells.size();
+    mtao::data_structures::DisjointSet<int> cell_ds;
+    {
+        auto t = mtao::logging::profiler("region disjoint set construction", false, "profiler");
+        for (int i = 0; i < cut_cell_count; ++i) {
+            cell_ds.add_node(i);
+        }
+        for (int i = 0; i < int(m_faces.size()); ++i) {
+            cell_ds.add_node(max_cell_id + i);
+        }
+        for (auto &&[c, b] : ag.cells()) {
+            cell_ds.add_node(c);
+        }
+        for (auto &&f : ag.faces()) {
+            auto &&[a, b] = f.dual_edge;
+            if (a >= 0 && b >= 0) {
+                cell_ds.join(a, b);
+            }
+        }
+        auto grid = ag.cell_ownership_grid();
+        for (auto &&[fid, f] : mtao::iterator::enumerate(m_faces)) {
+            if (f.is_mesh_face()) { continue; }
+            if (f.external_boundary) {
+                auto &[cid, s] = *f.external_boundary;
+                if (cid >= 0) {
+                    int owner = grid.get(cid);
+                    if (owner >= 0) {
+                        cell_ds.join(max_cell_id + fid, owner);
+                    }
+                }
+            }
+        }
+        for (auto &&[cid, cell] : mtao::iterator::enumerate(cells)) {
+            for (auto &&[fid, s] : cell) {
+                if (!m_faces[fid].is_mesh_face()) {
+                    cell_ds.join(cid, fid + max_cell_id);
+                }
+            }
+        }
+        cell_ds.reduce_all();
+    }
+
+    // the outside region is the one touching the face closest to the low x side of the grid
+    int min_face_idx = 0;
+    {
+        int min_face_x = m_grid.vertex_shape()[0];
+        for (auto &&[i, f] : mtao::iterator::enumerate(ccm.m_faces)) {
+            if (f[0]) {
+                int x = *f[0];
+                if (x < min_face_x) {
+                    min_face_idx = i;
+                    min_face_x = x;
+                }
+            }
+        }
+    }
+    int outside_root = -1;
+    for (auto &&[cid, cell] : mtao::iterator::enumerate(cells)) {
+        if (cell.find(min_face_idx) != cell.end()) {
+            outside_root = cell_ds.get_root(cid).data;
+            break;
+        }
+    }
+    std::map<int, int> reindexer;
+    reindexer[outside_root] = 0;
+    for (int i = 0; i < cut_cell_count; ++i) {
+        int root = cell_ds.get_root(i).data;
+        if (root != outside_root && reindexer.find(root) == reindexer.end()) {
+            reindexer[root] = reindexer.size();
+        }
+    }
+    for (auto &&[i, cell] : mtao::iterator::enumerate(cells)) {
+        cell.region = reindexer[cell_ds.get_root(i).data];
+    }
+    for (auto &&[cid, b] : ag.cells()) {
+        ccm.m_adaptive_grid_regions[cid] = reindexer[cell_ds.get_root(cid).data];
+    }
+    // only now that the regions are set, this empties the face maps of the cells
+    ccm.update_cell_face_incidence();
+    spdlog::info("Stitched {} cut cells, {} faces and {} exterior cells into {} regions", cut_cell_count, m_faces.size(), exterior_cells.size(), reindexer.size());
+    return ccm;
+}
+}// namespace mandoline::construction
@@ -5,21 +5,37 @@
 #include <mtao/iterator/enumerate.hpp>
 
 namespace mandoline::construction {
-FaceCollapser::FaceCollapser(const std::set<Edge> &edges) {
+FaceCollapser::FaceCollapser(const std::set<Edge> &edges, bool flat, std::pmr::memory_resource *resource) : m_flat(flat), m_flat_edges(resource), m_flat_edge_faces(resource), m_flat_vertices(resource), m_flat_offsets(resource), m_flat_dual_edges(resource) {
+    std::pmr::vector<std::tuple<Edge, int, bool>> flat_edges(resource);
+    if (m_flat) {
+        flat_edges.reserve(2 * edges.size());
+    }
     for (auto &&[cid, e] : mtao::iterator::enumerate(edges)) {
         face_ds.add_node(2 * cid);
         face_ds.add_node(2 * cid + 1);
+        Edge e2 = e;
+        std::swap(e2[0], e2[1]);
+        if (m_flat) {
+            flat_edges.emplace_back(e, 2 * cid, true);
+            flat_edges.emplace_back(e2, 2 * cid + 1, false);
+            continue;
+        }
         {
             m_edge_to_face[e] = std::make_tuple(2 * cid, true);
         }
-        Edge e2 = e;
-        std::swap(e2[0], e2[1]);
         {
             m_edge_to_face[e2] = std::make_tuple(2 * cid + 1, false);
         }
     }
+    if (m_flat) {
+        set_flat_edges(std::move(flat_edges));
+    }
 }
-FaceCollapser::FaceCollapser(const mtao::ColVecs2i &E) {
+FaceCollapser::FaceCollapser(const mtao::ColVecs2i &E, bool flat, std::pmr::memory_resource *resource) : m_flat(flat), m_flat_edges(resource), m_flat_edge_faces(resource), m_flat_vertices(resource), m_flat_offsets(resource), m_flat_dual_edges(resource) {
+    std::pmr::vector<std::tuple<Edge, int, bool>> flat_edges(resource);
+    if (m_flat) {
+        flat_edges.reserve(2 * E.cols());
+    }
     for (int cid = 0; cid < E.cols(); ++cid) {
 
         Edge e;
@@ -28,23 +44,92 @@ FaceCollapser::FaceCollapser(const mtao::ColVecs2i &E) {
 
         face_ds.add_node(2 * cid);
         face_ds.add_node(2 * cid + 1);
+        Edge e2 = e;
+        std::swap(e2[0], e2[1]);
+        if (m_flat) {
+            flat_edges.emplace_back(e, 2 * cid, true);
+            flat_edges.emplace_back(e2, 2 * cid + 1, false);
+            continue;
+        }
         {
             m_edge_to_face[e] = std::make_tuple(2 * cid, true);
         }
-        Edge e2 = e;
-        std::swap(e2[0], e2[1]);
         {
             m_edge_to_face[e2] = std::make_tuple(2 * cid + 1, false);
         }
     }
+    if (m_flat) {
+        set_flat_edges(std::move(flat_edges));
+    }
+}
+
+void FaceCollapser::set_flat_edges(std::pmr::vector<std::tuple<Edge, int, bool>> &&edges) {
+    // stable so that, like repeated map assignments, the last copy of a duplicate edge wins
+    std::stable_sort(edges.begin(), edges.end(), [](auto &&a, auto &&b) {
+        return std::get<0>(a) < std::get<0>(b);
+    });
+    m_flat_edges.clear();
+    m_flat_edge_faces.clear();
+    m_flat_vertices.clear();
+    m_flat_offsets.clear();
+    m_flat_edges.reserve(edges.size());
+    m_flat_edge_faces.reserve(edges.size());
+    for (auto &&[e, f, s] : edges) {
+        if (!m_flat_edges.empty() && m_flat_edges.back() == e) {
+            m_flat_edge_faces.back() = std::make_tuple(f, s);
+            continue;
+        }
+        if (m_flat_vertices.empty() || m_flat_vertices.back() != e[0]) {
+            m_flat_vertices.push_back(e[0]);
+            m_flat_offsets.push_back(m_flat_edges.size());
+        }
+        m_flat_edges.push_back(e);
+        m_flat_edge_faces.emplace_back(f, s);
+    }
+    m_flat_offsets.push_back(m_flat_edges.size());
+    m_flat_dual_edges.assign(m_flat_edges.size(), -1);
 }
 
+int FaceCollapser::flat_edge_index(const Edge &e) const {
+    auto it = std::lower_bound(m_flat_edges.begin(), m_flat_edges.end(), e);
+    if (it == m_flat_edges.end() || *it != e) {
+        return -1;
+    }
+    return std::distance(m_flat_edges.begin(), it);
+}
 
-auto FaceCollapser::collect_edges() const -> std::map<int, std::set<int>> {
-    std::map<int, std::set<int>> ret;
+const std::map<FaceCollapser::Edge, std::tuple<int, bool>> &FaceCollapser::edge_to_face() const {
+    if (m_flat) {
+        m_flat_edge_to_face_cache.clear();
+        for (size_t idx = 0; idx < m_flat_edges.size(); ++idx) {
+            m_flat_edge_to_face_cache.emplace_hint(m_flat_edge_to_face_cache.end(), m_flat_edges[idx], m_flat_edge_faces[idx]);
+        }
+        return m_flat_edge_to_face_cache;
+    }
+    return m_edge_to_face;
+}
+
+
+auto FaceCollapser::collect_edges() const -> OneRings {
+    if (m_flat) {
+        OneRings ret(m_flat_edges.get_allocator().resource());
+        ret.vertices.assign(m_flat_vertices.begin(), m_flat_vertices.end());
+        ret.offsets.assign(m_flat_offsets.begin(), m_flat_offsets.end());
+        ret.neighbors.resize(m_flat_edges.size());
+        std::transform(m_flat_edges.begin(), m_flat_edges.end(), ret.neighbors.begin(), [](const Edge &e) { return e[1]; });
+        return ret;
+    }
+    // the map is sorted by edge, so the edges leaving a vertex are contiguous and sorted by their second vertex
+    OneRings ret;
+    ret.neighbors.reserve(m_edge_to_face.size());
     for (auto &&[e, pr] : m_edge_to_face) {
-        ret[e[0]].insert(e[1]);
+        if (ret.vertices.empty() || ret.vertices.back() != e[0]) {
+            ret.vertices.push_back(e[0]);
+            ret.offsets.push_back(ret.neighbors.size());
+        }
+        ret.neighbors.push_back(e[1]);
     }
+    ret.offsets.push_back(ret.neighbors.size());
     return ret;
 }
 int FaceCollapser::dual_face(Edge e) const {
@@ -53,6 +138,13 @@ int FaceCollapser::dual_face(Edge e) const {
     return face(e);
 }
 int FaceCollapser::face(const Edge &e) const {
+    if (m_flat) {
+        int idx = flat_edge_index(e);
+        if (idx < 0) {
+            throw std::out_of_range("FaceCollapser::face: edge does not exist");
+        }
+        return std::get<0>(m_flat_edge_faces[idx]);
+    }
     return std::get<0>(m_edge_to_face.at(e));
 }
 
@@ -62,7 +154,11 @@ void FaceCollapser::set_edges_for_removal(const std::vector<int> &boundary_loop)
     for (int i = 0; i < boundary_loop.size(); ++i) {
         int j = (i + 1) % boundary_loop.size();
         Edge e{ { i, j } };
-        if (m_edge_to_face.find(e) != m_edge_to_face.end()) {
+        if (m_flat) {
+            if (int idx = flat_edge_index(e); idx >= 0) {
+                face_ds.join(std::get<0>(m_flat_edge_faces[idx]), -1);
+            }
+        } else if (m_edge_to_face.find(e) != m_edge_to_face.end()) {
             face_ds.join(std::get<0>(m_edge_to_face[e]), -1);
         }
     }
@@ -72,7 +168,11 @@ void FaceCollapser::set_edge_for_removal(const Edge &e) {
     face_ds.add_node(-1);
 
     //
-    if (m_edge_to_face.find(e) != m_edge_to_face.end()) {
+    if (m_flat) {
+        if (int idx = flat_edge_index(e); idx >= 0) {
+            face_ds.join(std::get<0>(m_flat_edge_faces[idx]), -1);
+        }
+    } else if (m_edge_to_face.find(e) != m_edge_to_face.end()) {
         face_ds.join(std::get<0>(m_edge_to_face[e]), -1);
     }
 }
@@ -80,7 +180,7 @@ void FaceCollapser::set_edge_for_removal(const Edge &e) {
 std::map<int, std::map<int, int>> FaceCollapser::face_adjacency_map() const {
     std::map<int, std::map<int, int>> ret;
 
-    for (auto &&[e, pr] : m_edge_to_face) {
+    for (auto &&[e, pr] : edge_to_face()) {
         auto &&[a, b] = e;
         auto &&[c, s] = pr;
         ret[c][a] = b;
@@ -92,6 +192,12 @@ std::map<int, std::map<int, int>> FaceCollapser::face_adjacency_map() const {
 //TODO: faces() and faces_no_holes() use the same code except for emplacement into the we should take care of that
 std::map<int, std::vector<int>> FaceCollapser::faces_no_holes() const {
     std::map<int, std::vector<int>> ret;
+    if (m_flat) {
+        flat_loops([&](int face, const std::vector<int> &loop) {
+            ret[face] = loop;
+        });
+        return ret;
+    }
 
     auto &deg = dual_edge_graph;
     auto inc = [&](auto &&it) {
@@ -158,6 +264,12 @@ auto FaceCollapser::face_edges() const -> std::map<int, std::set<Edge>> {
 
 std::map<int, std::set<std::vector<int>>> FaceCollapser::faces() const {
     std::map<int, std::set<std::vector<int>>> ret;
+    if (m_flat) {
+        flat_loops([&](int face, const std::vector<int> &loop) {
+            ret[face].emplace(loop);
+        });
+        return ret;
+    }
 
     auto &deg = dual_edge_graph;
     auto inc = [&](auto &&it) {
@@ -225,12 +337,18 @@ void FaceCollapser::finalize() {
     }
     reindexer[null_root] = -1;
 
-    for (auto &&[e, pr] : m_edge_to_face) {
-        auto &&[a, b] = e;
+    auto reindex = [&](auto &&pr) {
         auto &&[c, s] = pr;
 
         int root = face_ds.get_root(c).data;
         c = reindexer[root];
+    };
+    if (m_flat) {
+        std::for_each(m_flat_edge_faces.begin(), m_flat_edge_faces.end(), reindex);
+    } else {
+        for (auto &&[e, pr] : m_edge_to_face) {
+            reindex(pr);
+        }
     }
 }
 }// namespace mandoline::construction
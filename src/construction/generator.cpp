@@ -1,4 +1,6 @@
 #include "mandoline/construction/generator2.hpp"
+#include "mandoline/construction/scratch_arena.hpp"
+#include <memory_resource>
 #include <spdlog/spdlog.h>
 
 template <typename GridB>
@@ -76,8 +78,11 @@ auto CutCellEdgeGenerator<2>::compute_planar_hem(const std::vector<VType> &GV, c
     print_gridb(interior_cell_mask);
     bool adaptive = interior_cell_mask.empty();
     auto ret = compute_planar_hem(V, E, interior_cell_mask);
+    // the cell sets below only live as long as this call, so they come from the scratch arena
+    // (which is bulk released when the caller's ScratchArena::Scope closes, or is the heap without one)
+    auto *scratch = ScratchArena::resource();
     //the cells that vertices belong to
-    std::vector<std::set<coord_type>> vertex_cells(GV.size());
+    std::pmr::vector<std::pmr::set<coord_type>> vertex_cells(GV.size(), scratch);
     for (auto &&[v, cs] : mtao::iterator::zip(GV, vertex_cells)) {
         coord_type c = v.coord;
         cs.insert(c);
@@ -105,10 +110,11 @@ auto CutCellEdgeGenerator<2>::compute_planar_hem(const std::vector<VType> &GV, c
             auto e = E.col(i);
             auto a = GV[e(0)];
             auto b = GV[e(1)];
-            for (auto &&[i, v] : mtao::iterator::enumerate(a.mask() & b.mask())) {
-                if (v) {
-                    int vv = *v;
-                    if (vv == 0 || vv == cell_shape()[i]) {
+            auto mask = a.mask() & b.mask();
+            for (int d = 0; d < 2; ++d) {
+                if (mask.is_bound(d)) {
+                    int vv = *mask[d];
+                    if (vv == 0 || vv == cell_shape()[d]) {
                         Es.emplace(Edge{ { e(0), e(1) } });
                     }
                 }
@@ -118,7 +124,7 @@ auto CutCellEdgeGenerator<2>::compute_planar_hem(const std::vector<VType> &GV, c
 
 
     //the cells that each single=-curve face belongs to
-    mtao::map<int, std::set<coord_type>> cell_coords;
+    std::pmr::map<int, std::pmr::set<coord_type>> cell_coords(scratch);
 
     auto ci = hem.cell_indices();
     auto vi = hem.vertex_indices();
@@ -131,15 +137,14 @@ auto CutCellEdgeGenerator<2>::compute_planar_hem(const std::vector<VType> &GV, c
 
             auto &coords = it->second;
             auto &&vc = vertex_cells[vi(i)];
-            std::set<coord_type> gs;
+            std::pmr::set<coord_type> gs(scratch);
             std::set_intersection(coords.begin(), coords.end(), vc.begin(), vc.end(), std::inserter(gs, gs.end()));
-            coords = gs;
+            coords = std::move(gs);
         }
     }
 
-    auto cells_map = hem.cells_map();
     auto cells_halfedge_map = hem.cell_halfedges_map();
-    mtao::map<coord_type, std::set<int>> coord_cells;
+    std::pmr::map<coord_type, std::pmr::set<int>> coord_cells(scratch);
     for (auto &&[cc, cs] : cell_coords) {
         for (auto &&c : cs) {
             coord_cells[c].insert(cc);
@@ -177,14 +182,21 @@ auto CutCellEdgeGenerator<2>::compute_planar_hem(const ColVecs &V, const Edges &
         auto VV = V;
         VV.row(0) = V.row(1);
         VV.row(1) = V.row(0);
-        std::set<Edge> E2;
+        // sorted unique undirected edges, deduplicated in scratch memory
+        std::pmr::vector<Edge> E2(E.cols(), ScratchArena::resource());
         for (int i = 0; i < E.cols(); ++i) {
             auto e_ = E.col(i);
             Edge e{ { e_(0), e_(1) } };
             std::sort(e.begin(), e.end());
-            E2.emplace(e);
+            E2[i] = e;
         }
-        ehem = EmbeddedHalfEdgeMesh<double, 2>::from_edges(VV, mtao::eigen::stl2eigen(E2));
+        std::sort(E2.begin(), E2.end());
+        E2.erase(std::unique(E2.begin(), E2.end()), E2.end());
+        Edges E2m(2, E2.size());
+        for (int i = 0; i < E2m.cols(); ++i) {
+            E2m.col(i) << E2[i][0], E2[i][1];
+        }
+        ehem = EmbeddedHalfEdgeMesh<double, 2>::from_edges(VV, E2m);
         //ehem = EmbeddedHalfEdgeMesh<double,2>::from_edges(VV,E);
     }
     //auto ehem = EmbeddedHalfEdgeMesh<double,2>::from_edges(ret.vertices(),ret.cut_edges);
@@ -1,4 +1,5 @@
 #include "mandoline/construction/generator2.hpp"
+#include "mandoline/construction/scratch_arena.hpp"
 #include <mtao/geometry/grid/grid_data.hpp>
 #include <mtao/eigen/stl2eigen.hpp>
 #include <mtao/colvector_loop.hpp>
@@ -105,7 +106,9 @@ void CutCellGenerator<2>::bake_faces() {
     {
         auto VV = all_GV();
 
-        FaceCollapser fc(mtao::eigen::stl2eigen(edges));
+        // the plane's collapser only lives in this block
+        ScratchArena::Scope scratch;
+        FaceCollapser fc(mtao::eigen::stl2eigen(edges), true, scratch.resource());
         fc.bake(VV,false,edge_map, T);
         auto f = fc.faces();
         std::cout << "facecollapser size: " << f.size() << std::endl;
@@ -146,6 +146,7 @@ CutCellMesh<3> CutCellGenerator<3>::generate() const {
             mtao::logging::warn()<< "Degenerate cell";
         }
     }
+    ccm.update_cell_face_incidence();
     ccm.m_origV.resize(3, origV().size());
     for (int i = 0; i < origV().size(); ++i) {
         ccm.m_origV.col(i) = origV()[i];
@@ -309,7 +310,7 @@ void CutCellGenerator<3>::bake_cells() {
 #if defined(MANDOLINE_USE_ADAPTIVE_GRID)
         auto t = mtao::logging::profiler("Adaptive grid", false, "profiler");
         assert(m_active_grid_cell_mask.shape() == cell_shape());
-        auto adaptive_grid_factory = AdaptiveGridFactory(m_active_grid_cell_mask);
+        auto adaptive_grid_factory = AdaptiveGridFactory(m_active_grid_cell_mask, adaptive_branching_factor, adaptive_balance);
         adaptive_grid_factory.make_cells(adaptive_level);
         adaptive_grid = adaptive_grid_factory.create();
 #else
@@ -331,6 +332,7 @@ void CutCellGenerator<3>::bake_cells() {
                 int id = i + cbsize;
                 ag.m_cells[id] = b;
             }
+            ag.update_ownership_grid();
             max_cell_id = cbsize + ag.m_cells.size();
         }
 #endif
@@ -7,9 +7,14 @@
 #include <mtao/geometry/mesh/dual_edges.hpp>
 #include <mtao/eigen/stl2eigen.hpp>
 #include <mtao/iterator/enumerate.hpp>
+#include <mtao/iterator/zip.hpp>
 #include <mtao/logging/logger.hpp>
 #include "mandoline/construction/subgrid_transformer.hpp"
+#include "mandoline/construction/scratch_arena.hpp"
 #include <variant>
+#include <chrono>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 using namespace mtao::iterator;
 using namespace mtao::logging;
 namespace mandoline::construction {
@@ -47,17 +52,18 @@ void CutCellGenerator<3>::bake_faces() {
         for (auto &&[i, f] : mtao::iterator::enumerate(m_cut_faces)) {
             cut_cell_to_primal_map[i] = f.parent_fid;
             if (active[f.parent_fid]) {
-                for (auto &&[i, c] : mtao::iterator::enumerate(f.mask())) {
-                    if (c) {
-                        double Ni = origN.col(f.parent_fid)(i);
+                auto mask = f.mask();
+                for (int d = 0; d < 3; ++d) {
+                    if (mask.is_bound(d)) {
+                        double Ni = origN.col(f.parent_fid)(d);
                         if (Ni > 0) {
                             auto e = smallest_ordered_edge(f.indices);
                             //std::swap(e[0],e[1]);
-                            axial_primal_faces[i].insert(e);
+                            axial_primal_faces[d].insert(e);
                         } else {
                             auto e = smallest_ordered_edge_reverse(f.indices);
                             //std::swap(e[0],e[1]);
-                            axial_primal_faces[i].insert(e);
+                            axial_primal_faces[d].insert(e);
                         }
                     }
                 }
@@ -89,21 +95,17 @@ void CutCellGenerator<3>::bake_faces() {
 
     auto activeCells = active_cells();
     auto axialEdges = axial_edges();
-    //#pragma omp parallel for
 
     auto t = mtao::logging::profiler("Flagging active cells");
-    for (auto &&c : activeCells) {
-        for (int i = 0; i < D; ++i) {
-            int p1 = (i + 1) % 3;
-            int p2 = (i + 2) % 3;
-            auto &ahdata = axis_hem_data[i];
+    // every axis only touches its own axis_hem_data
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < D; ++i) {
+        int p1 = (i + 1) % 3;
+        int p2 = (i + 2) % 3;
+        auto &ahdata = axis_hem_data[i];
+        activeCells.for_each([&](const coord_type &c) {
             Edge c2{ { c[p1], c[p2] } };
-            if (c[p1] < 0 || c[p1] >= cell_shape()[p1]) {
-                continue;
-            }
-            if (c[p2] < 0 || c[p2] >= cell_shape()[p2]) {
-                continue;
-            }
             auto flag = [&](int idx) {
                 if (auto it = ahdata.find(idx); it == ahdata.end()) {
                     ahdata[idx].active_grid_cell_mask = AxisHEMData::GridDatab::Constant(true, grids[i].cell_shape());
@@ -111,13 +113,9 @@ void CutCellGenerator<3>::bake_faces() {
                 auto &ahd = ahdata[idx];
                 ahd.active_grid_cell_mask(c2) = false;
             };
-            if (c[i] >= 0) {
-                flag(c[i]);
-            }
-            if (c[i] + 1 < vertex_shape()[i]) {
-                flag(c[i] + 1);
-            }
-        }
+            flag(c[i]);
+            flag(c[i] + 1);
+        });
     }
 
     auto V = all_GV();
@@ -159,18 +157,25 @@ void CutCellGenerator<3>::bake_faces() {
             for (it = axial_edge_indices.begin(); it < axial_edge_indices.end(); it++) {
                 int cidx = *it;
                 auto &E = axialEdges_dim[cidx];
+                // the plane's edge lists and compute_planar_hem's cell sets are released together once the plane is done.
+                // the half edge mesh is kept in ahd, and it and the boundary edge set compute_planar_hem returns are on the heap
+                ScratchArena::Scope scratch;
                 //auto&& [cidx,E] = *it;
                 //for(auto&& [cidx,E]: axialEdges_dim) {
                 coord_type coord;
                 coord[dim] = cidx;
                 auto &ahd = ahdata[cidx];
-                std::transform(E.begin(), E.end(), std::inserter(ahd.edges, ahd.edges.end()), [](auto s) {
-                    if (s[0] > s[1]) {
-                        std::swap(s[0], s[1]);
+                {
+                    // sort the plane's edges in scratch memory so they can be appended to the set in order
+                    std::pmr::vector<Edge> sorted_edges(E.begin(), E.end(), scratch.resource());
+                    for (auto &&s : sorted_edges) {
+                        if (s[0] > s[1]) {
+                            std::swap(s[0], s[1]);
+                        }
                     }
-                    //std::cout << s[0] << ":" << s[1] << " ";
-                    return s;
-                });
+                    std::sort(sorted_edges.begin(), sorted_edges.end());
+                    ahd.edges.insert(sorted_edges.begin(), sorted_edges.end());
+                }
                 //std::cout << std::endl;
                 //ahd.edges.insert(E.begin(),E.end());
                 //spdlog::info("AHD size {}", ahd.edges.size());
@@ -190,7 +195,8 @@ void CutCellGenerator<3>::bake_faces() {
                 //    std::cout << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
                 //    std::cout << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^" << std::endl;
                 //}
-                std::transform(bedges.begin(), bedges.end(), std::inserter(ahd.boundary_edges, ahd.boundary_edges.end()), [&, dim = dim](Edge e) -> Edge {
+                std::pmr::vector<Edge> boundary_edges(bedges.size(), scratch.resource());
+                std::transform(bedges.begin(), bedges.end(), boundary_edges.begin(), [&, dim = dim](Edge e) -> Edge {
                     for (auto &&idx : e) {
 
                         auto c = g.vertex_unindex(idx);
@@ -200,6 +206,8 @@ void CutCellGenerator<3>::bake_faces() {
                     }
                     return e;
                 });
+                std::sort(boundary_edges.begin(), boundary_edges.end());
+                ahd.boundary_edges.insert(boundary_edges.begin(), boundary_edges.end());
             }
             for (auto &&[cidx, E] : axialEdges_dim) {
                 coord_type coord;
@@ -249,9 +257,9 @@ void CutCellGenerator<3>::compute_faces() {
         auto t = mtao::logging::timer("Computing input mesh faces");
         compute_faces_vertex();
     }
-    for (int i = 0; i < 3; ++i) {
-        auto t = mtao::logging::timer("Computing input mesh faces");
-        compute_faces_axis(i);
+    {
+        auto t = mtao::logging::timer("Computing axial faces");
+        compute_faces_axes();
     }
     // the sign must be determined by the cell it shares, we just write to external_boundary and let generate_celll fill in the signs
     for (auto &&[fidx, f] : m_faces) {
@@ -329,46 +337,112 @@ void CutCellGenerator<3>::compute_faces_vertex() {
     }
 }
 void CutCellGenerator<3>::compute_faces_axis(int idx) {
-    //axial half edge mesh data
-    auto &ahdata = axis_hem_data[idx];
-
-    //pull the keys out so we can parallel for loop over them
-    std::vector<int> axial_edge_indices(ahdata.size());
-    std::transform(ahdata.begin(), ahdata.end(), axial_edge_indices.begin(), [](auto &&pr) {
-        return pr.first;
-    });
-    auto it = axial_edge_indices.begin();
-    std::vector<mtao::map<int, CutFace<D>>> faces_vec(ahdata.size());
+    compute_faces_axes({ idx });
+}
+void CutCellGenerator<3>::compute_faces_axes(const std::vector<int> &axes) {
+    auto t = mtao::logging::profiler("axial plane faces", false, "profiler");
+    struct PlaneTask {
+        int axis;
+        int coord;
+        size_t cost;
+    };
 
-#pragma omp parallel for
-    for (it = axial_edge_indices.begin(); it < axial_edge_indices.end(); it++) {
-        int cidx = *it;
-        auto &ahd = ahdata.at(cidx);
-        auto r = compute_faces_axis(idx, cidx);
-        //spdlog::info("compute faces axis {} level {} got size {}",idx,cidx,r.size());
-        faces_vec[std::distance(axial_edge_indices.begin(), it)] = std::move(r);
+    // every plane of an axis sees the same projected vertices
+    std::array<mtao::ColVecs2d, 3> projected_vertices;
+    std::vector<PlaneTask> tasks;
+    {
+        auto V = all_GV();
+        for (int idx : axes) {
+            auto &VV = projected_vertices[idx];
+            VV.resize(2, V.cols());
+            VV.row(0) = V.row((idx + 1) % 3);
+            VV.row(1) = V.row((idx + 2) % 3);
+            for (auto &&[cidx, ahd] : axis_hem_data[idx]) {
+                tasks.emplace_back(PlaneTask{ idx, cidx, ahd.edges.size() });
+            }
+        }
     }
+    // planes through the dense part of the mesh have orders of magnitude more edges than the rest.
+    // starting with them keeps a big plane from being the last thing running while the other threads idle
+    std::stable_sort(tasks.begin(), tasks.end(), [](const PlaneTask &a, const PlaneTask &b) {
+        return a.cost > b.cost;
+    });
 
-    for (auto &&fcs : faces_vec) {
+    std::vector<mtao::map<int, CutFace<D>>> faces_vec(tasks.size());
+    m_plane_timings.assign(tasks.size(), {});
+    const auto start = std::chrono::steady_clock::now();
+    auto ms_since_start = [&](const auto &time) {
+        return std::chrono::duration<double, std::milli>(time - start).count();
+    };
+    // one plane per task, idle threads steal the remaining planes
+    tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, tasks.size(), 1), [&](const tbb::blocked_range<size_t> &range) {
+          for (size_t j = range.begin(); j < range.end(); ++j) {
+              auto &&task = tasks[j];
+              auto plane_start = std::chrono::steady_clock::now();
+              faces_vec[j] = compute_faces_axis(task.axis, task.coord, projected_vertices[task.axis]);
+              auto plane_end = std::chrono::steady_clock::now();
+
+              auto &timing = m_plane_timings[j];
+              timing.axis = task.axis;
+              timing.coord = task.coord;
+              timing.edge_count = task.cost;
+              timing.thread = tbb::this_task_arena::current_thread_index();
+              timing.start_ms = ms_since_start(plane_start);
+              timing.duration_ms = ms_since_start(plane_end) - timing.start_ms;
+          }
+      },
+      tbb::simple_partitioner());
+
+    // face indices are unique so the result doesn't depend on the order planes finished in
+    for (auto &&[task, fcs] : mtao::iterator::zip(tasks, faces_vec)) {
         for (auto &&[id, fs] : fcs) {
-            axis_face_indices[idx].insert(id);
-            //std::cout << std::string(fs) << std::endl;
+            axis_face_indices[task.axis].insert(id);
         }
         m_faces.insert(fcs.begin(), fcs.end());
     }
+
+    if (!m_plane_timings.empty()) {
+        std::map<int, double> thread_busy_ms;
+        double wall_ms = 0;
+        for (auto &&timing : m_plane_timings) {
+            thread_busy_ms[timing.thread] += timing.duration_ms;
+            wall_ms = std::max(wall_ms, timing.start_ms + timing.duration_ms);
+        }
+        double busiest = 0;
+        double total = 0;
+        for (auto &&[thread, ms] : thread_busy_ms) {
+            busiest = std::max(busiest, ms);
+            total += ms;
+        }
+        spdlog::debug("Axial faces: {} planes on {} threads in {}ms, busiest thread {}ms, mean thread {}ms",
+                      m_plane_timings.size(),
+                      thread_busy_ms.size(),
+                      wall_ms,
+                      busiest,
+                      total / thread_busy_ms.size());
+    }
+}
+void CutCellGenerator<3>::dump_plane_timings(std::ostream &os) const {
+    os << "axis,coord,edges,thread,start_ms,duration_ms\n";
+    for (auto &&timing : m_plane_timings) {
+        os << timing.axis << "," << timing.coord << "," << timing.edge_count << "," << timing.thread << "," << timing.start_ms << "," << timing.duration_ms << "\n";
+    }
 }
 mtao::map<int, CutFace<3>> CutCellGenerator<3>::compute_faces_axis(int idx, int cidx) const {
-    //spdlog::error("Compute_face_axis({},{})",idx,cidx);
-
-    mtao::map<int, CutFace<D>> faces;
-    auto &ahdata = axis_hem_data[idx];
-    auto &ahd = ahdata.at(cidx);
-
     auto V = all_GV();
 
     mtao::ColVectors<double, 2> VV(2, V.cols());
     VV.row(0) = V.row((idx + 1) % 3);
     VV.row(1) = V.row((idx + 2) % 3);
+    return compute_faces_axis(idx, cidx, VV);
+}
+mtao::map<int, CutFace<3>> CutCellGenerator<3>::compute_faces_axis(int idx, int cidx, const mtao::ColVecs2d &VV) const {
+    //spdlog::error("Compute_face_axis({},{})",idx,cidx);
+
+    mtao::map<int, CutFace<D>> faces;
+    auto &ahdata = axis_hem_data[idx];
+    auto &ahd = ahdata.at(cidx);
 
     mtao::Vec3d N = mtao::Vec3d::Unit((idx + 1) % 3).cross(mtao::Vec3d::Unit((idx + 2) % 3));
 
@@ -384,7 +458,8 @@ mtao::map<int, CutFace<3>> CutCellGenerator<3>::compute_faces_axis(int idx, int
     for (auto &&[i, v] : mesh_faces) {
         CutFace<D> F;
         F.id = Edge{ { idx, cidx } };
-        auto add_loop = [&](const std::vector<int> &v) {
+        // mesh_faces is only read here, so its loops are moved into the face rather than copied
+        auto add_loop = [&](std::vector<int> &v) {
 
             if (v.size() > 2) {
                 //std::copy(v.begin(),v.end(),std::ostream_iterator<int>(std::cout,","));
@@ -0,0 +1,101 @@
+#include "mandoline/construction/plane_crossing_kernel.hpp"
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MANDOLINE_PLANE_CROSSING_AVX2
+#include <immintrin.h>
+#endif
+
+
+namespace mandoline::construction {
+namespace {
+#if defined(MANDOLINE_PLANE_CROSSING_AVX2)
+    bool cpu_has_avx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+    std::atomic<bool> use_simd{ cpu_has_avx2() };
+
+    // four planes at a time. add, div and the comparisons are exactly rounded IEEE operations
+    // on each lane, so every t matches the scalar computation bit for bit
+    __attribute__((target("avx2"))) int plane_crossing_parameters_avx2(double offset, double dir, int count, double *ts, int *steps) {
+        const __m256d o = _mm256_set1_pd(offset);
+        const __m256d d = _mm256_set1_pd(dir);
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d four = _mm256_set1_pd(4.0);
+        __m256d index = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+        alignas(32) double t[4];
+        int kept = 0;
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d tv = _mm256_div_pd(_mm256_add_pd(o, index), d);
+            // the scalar path skips t <= 0 || t >= 1, the unordered negations keep the same set (NaN included)
+            __m256d valid = _mm256_and_pd(_mm256_cmp_pd(tv, zero, _CMP_NLE_UQ), _mm256_cmp_pd(tv, one, _CMP_NGE_UQ));
+            int mask = _mm256_movemask_pd(valid);
+            index = _mm256_add_pd(index, four);
+            if (mask == 0) continue;
+            _mm256_store_pd(t, tv);
+            for (int k = 0; k < 4; ++k) {
+                if (mask & (1 << k)) {
+                    ts[kept] = t[k];
+                    steps[kept] = i + k;
+                    ++kept;
+                }
+            }
+        }
+        for (; i < count; ++i) {
+            double t = (offset + i) / dir;
+            if (t <= 0 || t >= 1) {
+                continue;
+            }
+            ts[kept] = t;
+            steps[kept] = i;
+            ++kept;
+        }
+        return kept;
+    }
+#else
+    std::atomic<bool> use_simd{ false };
+#endif
+}// namespace
+
+void PlaneCrossings::reserve(size_t edges, size_t crossings) {
+    offsets.reserve(edges + 1);
+    ts.reserve(crossings);
+    axes.reserve(crossings);
+    steps.reserve(crossings);
+}
+
+int plane_crossing_parameters_scalar(double offset, double dir, int count, double *ts, int *steps) {
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        double t = (offset + i) / dir;
+        if (t <= 0 || t >= 1) {
+            continue;
+        }
+        ts[kept] = t;
+        steps[kept] = i;
+        ++kept;
+    }
+    return kept;
+}
+
+int plane_crossing_parameters(double offset, double dir, int count, double *ts, int *steps) {
+#if defined(MANDOLINE_PLANE_CROSSING_AVX2)
+    if (use_simd) {
+        return plane_crossing_parameters_avx2(offset, dir, count, ts, steps);
+    }
+#endif
+    return plane_crossing_parameters_scalar(offset, dir, count, ts, steps);
+}
+
+bool plane_crossing_simd_enabled() {
+    return use_simd;
+}
+void set_plane_crossing_simd(bool enabled) {
+#if defined(MANDOLINE_PLANE_CROSSING_AVX2)
+    use_simd = enabled && cpu_has_avx2();
+#endif
+}
+}// namespace mandoline::construction
@@ -0,0 +1,79 @@
+#include "mandoline/construction/scratch_arena.hpp"
+
+namespace mandoline::construction {
+std::atomic<bool> ScratchArena::s_enabled{ true };
+std::atomic<size_t> ScratchArena::s_allocations{ 0 };
+std::atomic<size_t> ScratchArena::s_heap_allocations{ 0 };
+std::atomic<size_t> ScratchArena::s_heap_bytes{ 0 };
+
+ScratchArena::ScratchArena() : m_buffer(64 * 1024, &m_heap) {
+    m_front.arena = this;
+}
+
+ScratchArena &ScratchArena::local() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+std::pmr::memory_resource *ScratchArena::resource() {
+    return &local().m_front;
+}
+
+void ScratchArena::set_enabled(bool enabled) {
+    s_enabled = enabled;
+}
+bool ScratchArena::enabled() {
+    return s_enabled;
+}
+
+auto ScratchArena::statistics() -> Statistics {
+    Statistics s;
+    s.allocations = s_allocations;
+    s.heap_allocations = s_heap_allocations;
+    s.heap_bytes = s_heap_bytes;
+    return s;
+}
+void ScratchArena::reset_statistics() {
+    s_allocations = 0;
+    s_heap_allocations = 0;
+    s_heap_bytes = 0;
+}
+
+ScratchArena::Scope::Scope() : m_arena(local()) {
+    if (m_arena.m_depth++ == 0) {
+        m_arena.m_buffered = s_enabled;
+    }
+}
+ScratchArena::Scope::~Scope() {
+    if (--m_arena.m_depth == 0) {
+        m_arena.m_buffer.release();
+        m_arena.m_buffered = false;
+    }
+}
+std::pmr::memory_resource *ScratchArena::Scope::resource() const {
+    return &m_arena.m_front;
+}
+
+void *ScratchArena::FrontResource::do_allocate(size_t bytes, size_t alignment) {
+    s_allocations++;
+    if (arena->m_buffered) {
+        return arena->m_buffer.allocate(bytes, alignment);
+    } else {
+        return arena->m_heap.allocate(bytes, alignment);
+    }
+}
+void ScratchArena::FrontResource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+    // monotonic memory is only given back when the scope ends
+    if (!arena->m_buffered) {
+        arena->m_heap.deallocate(p, bytes, alignment);
+    }
+}
+
+void *ScratchArena::HeapResource::do_allocate(size_t bytes, size_t alignment) {
+    s_heap_allocations++;
+    s_heap_bytes += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+void ScratchArena::HeapResource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+}// namespace mandoline::construction
@@ -0,0 +1,114 @@
+#include "mandoline/cutcell_locator.hpp"
+#include <mtao/iterator/enumerate.hpp>
+#include <limits>
+#include <numeric>
+
+
+namespace mandoline {
+CutCellLocator::CutCellLocator(const CutCellMesh<3> &mesh) : m_mesh(mesh), m_V(mesh.vertices()) {
+    auto &&inc = mesh.cell_face_incidence();
+    auto &&faces = mesh.faces();
+    auto cs = mesh.cell_shape();
+    const int cell_count = inc.cell_size();
+
+    // counting sort of the cut cells by grid cell
+    m_grid_cell_offsets.assign(cs[0] * cs[1] * cs[2] + 1, 0);
+    for (int i = 0; i < cell_count; ++i) {
+        if (int g = grid_cell_index(mesh.cut_cell_grid_cell(i)); g >= 0) {
+            m_grid_cell_offsets[g + 1]++;
+        }
+    }
+    std::partial_sum(m_grid_cell_offsets.begin(), m_grid_cell_offsets.end(), m_grid_cell_offsets.begin());
+    m_grid_cell_cells.resize(m_grid_cell_offsets.back());
+    {
+        std::vector<int> cursor(m_grid_cell_offsets.begin(), m_grid_cell_offsets.end() - 1);
+        for (int i = 0; i < cell_count; ++i) {
+            if (int g = grid_cell_index(mesh.cut_cell_grid_cell(i)); g >= 0) {
+                m_grid_cell_cells[cursor[g]++] = i;
+            }
+        }
+    }
+
+    m_bounding_boxes.resize(cell_count);
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < cell_count; ++i) {
+        auto &bb = m_bounding_boxes[i];
+        for (int j = inc.begin(i); j < inc.end(i); ++j) {
+            for (auto &&loop : faces[inc.face(j)].indices) {
+                for (auto &&v : loop) {
+                    bb.extend(m_V.col(v));
+                }
+            }
+        }
+    }
+}
+
+int CutCellLocator::grid_cell_index(const coord_type &c) const {
+    auto cs = m_mesh.cell_shape();
+    for (int d = 0; d < 3; ++d) {
+        if (c[d] < 0 || c[d] >= cs[d]) {
+            return -1;
+        }
+    }
+    return m_mesh.cell_grid().index(c);
+}
+
+std::vector<int> CutCellLocator::cells_in_grid_cell(const coord_type &c) const {
+    int g = grid_cell_index(c);
+    if (g < 0) {
+        return {};
+    }
+    return { m_grid_cell_cells.begin() + m_grid_cell_offsets[g], m_grid_cell_cells.begin() + m_grid_cell_offsets[g + 1] };
+}
+
+int CutCellLocator::locate(const mtao::Vec3d &p) const {
+    auto v = m_mesh.vertex_grid().local_coord(p);
+    if (int ret = m_mesh.exterior_grid().get_cell_index(v); ret != -1) {
+        return ret;
+    }
+    auto [c, q] = m_mesh.vertex_grid().coord(p);
+    int g = grid_cell_index(c);
+    if (g < 0) {
+        return -1;
+    }
+    const int begin = m_grid_cell_offsets[g];
+    const int end = m_grid_cell_offsets[g + 1];
+    // the cut cells of a grid cell tile it, so a lone cell needs no test
+    if (end - begin == 1) {
+        return m_grid_cell_cells[begin];
+    }
+    auto &&inc = m_mesh.cell_face_incidence();
+    auto &&faces = m_mesh.faces();
+    int best = -1;
+    double best_sa = -std::numeric_limits<double>::infinity();
+    for (int j = begin; j < end; ++j) {
+        int ci = m_grid_cell_cells[j];
+        if (!m_bounding_boxes[ci].contains(p)) {
+            continue;
+        }
+        //> 4 * M_PI, but with some slack, same as CutCell::contains
+        double sa = 0;
+        for (int k = inc.begin(ci); k < inc.end(ci); ++k) {
+            sa += (inc.sign(k) ? -1 : 1) * faces[inc.face(k)].solid_angle(m_V, p);
+        }
+        if (sa > .5) {
+            return ci;
+        } else if (sa > best_sa) {
+            best_sa = sa;
+            best = ci;
+        }
+    }
+    return best;
+}
+
+mtao::VecXi CutCellLocator::locate(const mtao::ColVecs3d &P) const {
+    mtao::VecXi R(P.cols());
+    int i;
+#pragma omp parallel for schedule(dynamic, 256)
+    for (i = 0; i < P.cols(); ++i) {
+        R(i) = locate(mtao::Vec3d(P.col(i)));
+    }
+    return R;
+}
+}// namespace mandoline
@@ -208,7 +208,7 @@ void CutFace<3>::serialize(protobuf::CutFace &face) const {
             c.add_indices(v);
         }
     }
-    if (triangulation) {
+    if (has_persistent_triangulation()) {
         auto &&T = *triangulation;
         for (int i = 0; i < T.cols(); ++i) {
             protobuf::serialize(T.col(i), *face.add_triangulation());
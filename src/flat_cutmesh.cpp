@@ -0,0 +1,614 @@
+#include "mandoline/flat_cutmesh.hpp"
+#include "mandoline/mesh3.hpp"
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <mtao/eigen/stl2eigen.hpp>
+#include <mtao/logging/logger.hpp>
+#if defined(__unix__) || defined(__APPLE__)
+#define MANDOLINE_FLAT_CUTMESH_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "flat cutmesh files are little-endian and are read in place"
+#endif
+
+
+namespace mandoline {
+namespace flat {
+    bool is_flat_file(const std::string &filename) {
+        std::ifstream ifs(filename, std::ios::binary);
+        char m[sizeof(magic)];
+        if (!ifs.read(m, sizeof(m))) {
+            return false;
+        }
+        return std::memcmp(m, magic, sizeof(magic)) == 0;
+    }
+}// namespace flat
+
+namespace {
+    size_t aligned(size_t offset) {
+        return (offset + flat::alignment - 1) / flat::alignment * flat::alignment;
+    }
+    // the sections of a file before they are written out
+    struct SectionData {
+        uint32_t scalar_size = 0;
+        std::vector<char> bytes;
+    };
+    using Sections = std::array<SectionData, size_t(flat::Section::Count)>;
+
+    template<typename T>
+    void set_section(Sections &sections, flat::Section s, const std::vector<T> &data) {
+        auto &sd = sections[size_t(s)];
+        sd.scalar_size = sizeof(T);
+        sd.bytes.resize(data.size() * sizeof(T));
+        if (!data.empty()) {
+            std::memcpy(sd.bytes.data(), data.data(), sd.bytes.size());
+        }
+    }
+    template<typename Derived>
+    void set_section(Sections &sections, flat::Section s, const Eigen::DenseBase<Derived> &data) {
+        using T = typename Derived::Scalar;
+        std::vector<T> v(data.size());
+        Eigen::Map<Eigen::Matrix<T, Derived::RowsAtCompileTime, Eigen::Dynamic>>(v.data(), data.rows(), data.cols()) = data;
+        set_section(sections, s, v);
+    }
+}// namespace
+
+bool write_flat_cutmesh(const CutCellMesh<3> &mesh, const std::string &filename) {
+    using flat::Section;
+    Sections sections;
+    {
+        auto &&V = mesh.cut_vertices();
+        std::vector<int32_t> coords(3 * V.size());
+        std::vector<double> quots(3 * V.size());
+        std::vector<uint8_t> clamped(V.size());
+        for (size_t i = 0; i < V.size(); ++i) {
+            auto &&v = V[i];
+            for (int d = 0; d < 3; ++d) {
+                coords[3 * i + d] = v.coord[d];
+                quots[3 * i + d] = v.quot(d);
+            }
+            clamped[i] = uint8_t(v.clamped_indices.to_ulong());
+        }
+        set_section(sections, Section::VertexCoords, coords);
+        set_section(sections, Section::VertexQuotients, quots);
+        set_section(sections, Section::VertexClamped, clamped);
+    }
+    {
+        auto &&F = mesh.faces();
+        std::vector<double> normals(3 * F.size());
+        std::vector<int32_t> ids(2 * F.size());
+        std::vector<int32_t> boundaries(2 * F.size());
+        std::vector<int32_t> face_loop_offsets{ 0 }, loop_offsets{ 0 }, loop_indices;
+        std::vector<int32_t> triangle_offsets{ 0 }, triangles;
+        face_loop_offsets.reserve(F.size() + 1);
+        triangle_offsets.reserve(F.size() + 1);
+        for (size_t i = 0; i < F.size(); ++i) {
+            auto &&f = F[i];
+            for (int d = 0; d < 3; ++d) {
+                normals[3 * i + d] = f.N(d);
+            }
+            if (f.is_mesh_face()) {
+                ids[2 * i] = -1;
+                ids[2 * i + 1] = f.as_face_id();
+            } else {
+                auto &&[axis, coord] = f.as_axial_id();
+                ids[2 * i] = axis;
+                ids[2 * i + 1] = coord;
+            }
+            if (f.external_boundary) {
+                auto [c, s] = *f.external_boundary;
+                boundaries[2 * i] = c;
+                boundaries[2 * i + 1] = s;
+            } else {
+                boundaries[2 * i] = 0;
+                boundaries[2 * i + 1] = -1;
+            }
+            for (auto &&loop : f.indices) {
+                loop_indices.insert(loop_indices.end(), loop.begin(), loop.end());
+                loop_offsets.emplace_back(loop_indices.size());
+            }
+            face_loop_offsets.emplace_back(loop_offsets.size() - 1);
+            if (f.has_persistent_triangulation()) {
+                auto &&T = *f.triangulation;
+                triangles.insert(triangles.end(), T.data(), T.data() + T.size());
+            }
+            triangle_offsets.emplace_back(triangles.size() / 3);
+        }
+        set_section(sections, Section::FaceNormals, normals);
+        set_section(sections, Section::FaceIds, ids);
+        set_section(sections, Section::FaceBoundaries, boundaries);
+        set_section(sections, Section::FaceLoopOffsets, face_loop_offsets);
+        set_section(sections, Section::LoopOffsets, loop_offsets);
+        set_section(sections, Section::LoopIndices, loop_indices);
+        set_section(sections, Section::FaceTriangleOffsets, triangle_offsets);
+        set_section(sections, Section::FaceTriangles, triangles);
+    }
+    {
+        auto &&inc = mesh.cell_face_incidence();
+        std::vector<int32_t> info(5 * inc.cell_size());
+        for (size_t i = 0; i < inc.cell_size(); ++i) {
+            info[5 * i] = mesh.cut_cell_index(i);
+            info[5 * i + 1] = mesh.cut_cell_region(i);
+            auto &&gc = mesh.cut_cell_grid_cell(i);
+            for (int d = 0; d < 3; ++d) {
+                info[5 * i + 2 + d] = gc[d];
+            }
+        }
+        std::vector<uint8_t> signs(inc.size());
+        for (size_t i = 0; i < inc.size(); ++i) {
+            signs[i] = inc.sign(i);
+        }
+        set_section(sections, Section::CellInfo, info);
+        set_section(sections, Section::CellOffsets, inc.offsets());
+        set_section(sections, Section::CellFaces, inc.faces());
+        set_section(sections, Section::CellSigns, signs);
+    }
+    {
+        std::vector<int32_t> info, offsets{ 0 };
+        std::vector<double> barys;
+        for (auto &&[idx, bmf] : mesh.mesh_cut_faces()) {
+            info.emplace_back(idx);
+            info.emplace_back(bmf.parent_fid);
+            barys.insert(barys.end(), bmf.barys.data(), bmf.barys.data() + bmf.barys.size());
+            offsets.emplace_back(barys.size() / 3);
+        }
+        set_section(sections, Section::MeshFaceInfo, info);
+        set_section(sections, Section::MeshFaceOffsets, offsets);
+        set_section(sections, Section::MeshFaceBarycentrics, barys);
+    }
+    set_section(sections, Section::OrigV, mesh.origV());
+    set_section(sections, Section::OrigF, mesh.origF());
+    set_section(sections, Section::FoldedFaces, std::vector<int32_t>(mesh.folded_faces().begin(), mesh.folded_faces().end()));
+    {
+        std::vector<int32_t> cubes;
+        for (auto &&[idx, c] : mesh.exterior_grid().cells()) {
+            cubes.emplace_back(idx);
+            cubes.insert(cubes.end(), c.corner().begin(), c.corner().end());
+            cubes.emplace_back(c.width());
+        }
+        std::vector<int32_t> regions;
+        for (auto &&[a, b] : mesh.adaptive_grid_regions()) {
+            regions.emplace_back(a);
+            regions.emplace_back(b);
+        }
+        set_section(sections, Section::Cubes, cubes);
+        set_section(sections, Section::CubeRegions, regions);
+    }
+
+    flat::Header header = {};
+    std::memcpy(header.magic, flat::magic, sizeof(flat::magic));
+    header.version = flat::version;
+    header.section_count = sections.size();
+    for (int d = 0; d < 3; ++d) {
+        header.origin[d] = mesh.origin()(d);
+        header.dx[d] = mesh.dx()(d);
+        header.shape[d] = mesh.vertex_shape()[d];
+    }
+
+    std::vector<flat::SectionEntry> table(sections.size());
+    size_t offset = aligned(sizeof(flat::Header) + table.size() * sizeof(flat::SectionEntry));
+    for (size_t i = 0; i < sections.size(); ++i) {
+        auto &&sd = sections[i];
+        auto &e = table[i];
+        e.id = i;
+        e.scalar_size = sd.scalar_size;
+        e.offset = offset;
+        e.count = sd.scalar_size == 0 ? 0 : sd.bytes.size() / sd.scalar_size;
+        offset = aligned(offset + sd.bytes.size());
+    }
+
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs.good()) {
+        mtao::logging::error() << "Could not open " << filename << " for writing";
+        return false;
+    }
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(flat::SectionEntry));
+    const char zeros[flat::alignment] = {};
+    size_t position = sizeof(flat::Header) + table.size() * sizeof(flat::SectionEntry);
+    for (size_t i = 0; i < sections.size(); ++i) {
+        ofs.write(zeros, table[i].offset - position);
+        ofs.write(sections[i].bytes.data(), sections[i].bytes.size());
+        position = table[i].offset + sections[i].bytes.size();
+    }
+    ofs.write(zeros, offset - position);
+    return ofs.good();
+}
+
+FlatCutMeshView::FlatCutMeshView(const std::string &filename) {
+#if defined(MANDOLINE_FLAT_CUTMESH_MMAP)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *ptr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                m_data = static_cast<const char *>(ptr);
+                m_size = st.st_size;
+                m_mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    if (!m_data) {
+        std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+        if (ifs.good()) {
+            m_buffer.resize(ifs.tellg());
+            ifs.seekg(0);
+            if (ifs.read(m_buffer.data(), m_buffer.size())) {
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            }
+        }
+    }
+    if (m_data && !validate()) {
+        mtao::logging::error() << filename << " is not a valid flat cutmesh file";
+        close();
+    }
+}
+FlatCutMeshView::FlatCutMeshView(FlatCutMeshView &&o) {
+    *this = std::move(o);
+}
+FlatCutMeshView &FlatCutMeshView::operator=(FlatCutMeshView &&o) {
+    if (this != &o) {
+        close();
+        m_buffer = std::move(o.m_buffer);
+        m_data = o.m_mapped ? o.m_data : m_buffer.data();
+        m_size = o.m_size;
+        m_mapped = o.m_mapped;
+        if (!o.m_data) {
+            m_data = nullptr;
+        }
+        o.m_data = nullptr;
+        o.m_size = 0;
+        o.m_mapped = false;
+    }
+    return *this;
+}
+FlatCutMeshView::~FlatCutMeshView() {
+    close();
+}
+void FlatCutMeshView::close() {
+#if defined(MANDOLINE_FLAT_CUTMESH_MMAP)
+    if (m_mapped && m_data) {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+}
+
+bool FlatCutMeshView::validate() {
+    if (m_size < sizeof(flat::Header)) {
+        return false;
+    }
+    auto &&h = header();
+    if (std::memcmp(h.magic, flat::magic, sizeof(flat::magic)) != 0 || h.version != flat::version) {
+        return false;
+    }
+    if (m_size < sizeof(flat::Header) + h.section_count * sizeof(flat::SectionEntry)) {
+        return false;
+    }
+    auto table = reinterpret_cast<const flat::SectionEntry *>(m_data + sizeof(flat::Header));
+    for (uint32_t i = 0; i < h.section_count; ++i) {
+        auto &&e = table[i];
+        // count * scalar_size could overflow
+        if (e.offset % flat::alignment != 0 || e.offset > m_size || (e.scalar_size == 0 ? e.count != 0 : e.count > (m_size - e.offset) / e.scalar_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const flat::Header &FlatCutMeshView::header() const {
+    return *reinterpret_cast<const flat::Header *>(m_data);
+}
+std::array<double, 3> FlatCutMeshView::origin() const {
+    auto &&h = header();
+    return { { h.origin[0], h.origin[1], h.origin[2] } };
+}
+std::array<double, 3> FlatCutMeshView::dx() const {
+    auto &&h = header();
+    return { { h.dx[0], h.dx[1], h.dx[2] } };
+}
+std::array<int, 3> FlatCutMeshView::shape() const {
+    auto &&h = header();
+    return { { h.shape[0], h.shape[1], h.shape[2] } };
+}
+const flat::SectionEntry *FlatCutMeshView::find(flat::Section s) const {
+    if (!m_data) {
+        return nullptr;
+    }
+    auto &&h = header();
+    auto table = reinterpret_cast<const flat::SectionEntry *>(m_data + sizeof(flat::Header));
+    // sections are written in order, but older or newer writers may have a different count
+    if (uint32_t(s) < h.section_count && table[uint32_t(s)].id == uint32_t(s)) {
+        return table + uint32_t(s);
+    }
+    for (uint32_t i = 0; i < h.section_count; ++i) {
+        if (table[i].id == uint32_t(s)) {
+            return table + i;
+        }
+    }
+    return nullptr;
+}
+
+namespace {
+    // sections can be read independently, so from_flat checks that the ones it needs agree with each other
+    // before indexing one with another
+    [[noreturn]] void inconsistent_section(flat::Section s) {
+        throw std::runtime_error("flat cutmesh: section " + std::to_string(uint32_t(s)) + " is missing or inconsistent");
+    }
+    template<typename T>
+    flat::Span<T> sized_section(const FlatCutMeshView &view, flat::Section s, size_t size) {
+        auto sp = view.section<T>(s);
+        if (sp.size() != size) {
+            inconsistent_section(s);
+        }
+        return sp;
+    }
+    // a section whose size is a multiple of width, returns the number of columns
+    template<typename T>
+    size_t column_count(const FlatCutMeshView &view, flat::Section s, size_t width) {
+        auto sp = view.section<T>(s);
+        if (sp.size() % width != 0) {
+            inconsistent_section(s);
+        }
+        return sp.size() / width;
+    }
+    // count + 1 offsets that start at 0, never decrease and end at end
+    flat::Span<int32_t> offsets_section(const FlatCutMeshView &view, flat::Section s, size_t count, size_t end) {
+        auto sp = sized_section<int32_t>(view, s, count + 1);
+        if (sp[0] != 0 || size_t(sp[count]) != end) {
+            inconsistent_section(s);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (sp[i] > sp[i + 1]) {
+                inconsistent_section(s);
+            }
+        }
+        return sp;
+    }
+    // every index in [0,end)
+    void check_indices(const FlatCutMeshView &view, flat::Section s, size_t end) {
+        for (int32_t idx : view.section<int32_t>(s)) {
+            if (idx < 0 || size_t(idx) >= end) {
+                inconsistent_section(s);
+            }
+        }
+    }
+    bool in_range(int32_t idx, size_t end) {
+        return idx >= 0 && size_t(idx) < end;
+    }
+    void check_sections(const FlatCutMeshView &view) {
+        using flat::Section;
+        // the header holds the vertex shape, cells and cubes are indexed in the cell shape
+        std::array<int, 3> cell_shape = view.shape();
+        size_t vertex_count = 1;
+        for (auto &&s : cell_shape) {
+            if (s < 1) {
+                throw std::runtime_error("flat cutmesh: grid shape is invalid");
+            }
+            vertex_count *= s;
+            s -= 1;
+        }
+        auto in_grid = [&](int32_t corner, int32_t width, int d) {
+            return corner >= 0 && width >= 1 && int64_t(corner) + width <= cell_shape[d];
+        };
+        const size_t cut_vertex_count = view.vertex_count();
+        vertex_count += cut_vertex_count;
+        sized_section<int32_t>(view, Section::VertexCoords, 3 * cut_vertex_count);
+        sized_section<double>(view, Section::VertexQuotients, 3 * cut_vertex_count);
+
+        const size_t input_vertex_count = column_count<double>(view, Section::OrigV, 3);
+        const size_t input_face_count = column_count<int32_t>(view, Section::OrigF, 3);
+        check_indices(view, Section::OrigF, input_vertex_count);
+
+        if (view.face_loop_offsets().empty()) {
+            inconsistent_section(Section::FaceLoopOffsets);
+        }
+        const size_t face_count = view.face_count();
+        sized_section<double>(view, Section::FaceNormals, 3 * face_count);
+        sized_section<int32_t>(view, Section::FaceIds, 2 * face_count);
+        sized_section<int32_t>(view, Section::FaceBoundaries, 2 * face_count);
+        {
+            auto ids = view.face_ids();
+            for (size_t i = 0; i < face_count; ++i) {
+                if (ids(0, i) == -1 ? !in_range(ids(1, i), input_face_count) : !in_range(ids(0, i), 3)) {
+                    inconsistent_section(Section::FaceIds);
+                }
+            }
+        }
+        const size_t loop_count = view.loop_offsets().empty() ? 0 : view.loop_offsets().size() - 1;
+        offsets_section(view, Section::FaceLoopOffsets, face_count, loop_count);
+        offsets_section(view, Section::LoopOffsets, loop_count, view.loop_indices().size());
+        check_indices(view, Section::LoopIndices, vertex_count);
+        const size_t triangle_count = column_count<int32_t>(view, Section::FaceTriangles, 3);
+        offsets_section(view, Section::FaceTriangleOffsets, face_count, triangle_count);
+        check_indices(view, Section::FaceTriangles, vertex_count);
+
+        if (view.cell_offsets().empty()) {
+            inconsistent_section(Section::CellOffsets);
+        }
+        const size_t cell_count = view.cell_count();
+        sized_section<int32_t>(view, Section::CellInfo, 5 * cell_count);
+        {
+            auto info = view.cell_info();
+            for (size_t i = 0; i < cell_count; ++i) {
+                for (int d = 0; d < 3; ++d) {
+                    if (!in_grid(info(2 + d, i), 1, d)) {
+                        inconsistent_section(Section::CellInfo);
+                    }
+                }
+            }
+        }
+        const size_t entry_count = view.cell_faces().size();
+        offsets_section(view, Section::CellOffsets, cell_count, entry_count);
+        sized_section<uint8_t>(view, Section::CellSigns, entry_count);
+        check_indices(view, Section::CellFaces, face_count);
+        check_indices(view, Section::FoldedFaces, face_count);
+
+        const size_t mesh_face_count = column_count<int32_t>(view, Section::MeshFaceInfo, 2);
+        offsets_section(view, Section::MeshFaceOffsets, mesh_face_count, column_count<double>(view, Section::MeshFaceBarycentrics, 3));
+        auto info = view.mesh_face_info();
+        for (size_t i = 0; i < mesh_face_count; ++i) {
+            if (!in_range(info(0, i), face_count) || !in_range(info(1, i), input_face_count)) {
+                inconsistent_section(Section::MeshFaceInfo);
+            }
+        }
+
+        // cubes are rasterized into the cell grid, so each one has to fit inside it
+        const size_t cube_count = column_count<int32_t>(view, Section::Cubes, 5);
+        std::set<int32_t> cube_indices;
+        {
+            auto cubes = view.cubes();
+            for (size_t i = 0; i < cube_count; ++i) {
+                const int32_t *cube = cubes.data() + 5 * i;
+                for (int d = 0; d < 3; ++d) {
+                    if (!in_grid(cube[1 + d], cube[4], d)) {
+                        inconsistent_section(Section::Cubes);
+                    }
+                }
+                if (!cube_indices.insert(cube[0]).second) {
+                    inconsistent_section(Section::Cubes);
+                }
+            }
+        }
+        const size_t region_count = column_count<int32_t>(view, Section::CubeRegions, 2);
+        {
+            auto regions = view.cube_regions();
+            for (size_t i = 0; i < region_count; ++i) {
+                if (cube_indices.count(regions[2 * i]) == 0) {
+                    inconsistent_section(Section::CubeRegions);
+                }
+            }
+        }
+        // an external boundary is a cube, -1 for an unowned cell or -2 for the domain boundary
+        {
+            auto boundaries = view.face_boundaries();
+            for (size_t i = 0; i < face_count; ++i) {
+                if (boundaries(1, i) == -1) {
+                    continue;
+                }
+                int32_t cell = boundaries(0, i);
+                if (!in_range(boundaries(1, i), 2) || (cell < -2 || (cell >= 0 && cube_indices.count(cell) == 0))) {
+                    inconsistent_section(Section::FaceBoundaries);
+                }
+            }
+        }
+    }
+}// namespace
+
+CutCellMesh<3> CutCellMesh<3>::from_flat(const std::string &filename) {
+    FlatCutMeshView view(filename);
+    if (!view.valid()) {
+        return {};
+    }
+    return from_flat(view);
+}
+CutCellMesh<3> CutCellMesh<3>::from_flat(const FlatCutMeshView &view) {
+    check_sections(view);
+    mtao::Vec3d o = mtao::eigen::stl2eigen(view.origin());
+    mtao::Vec3d dx = mtao::eigen::stl2eigen(view.dx());
+    CutCellMesh<3> ret = CutCellMesh<3>::StaggeredGrid(GridType(view.shape(), dx, o));
+
+    {
+        auto coords = view.vertex_coords();
+        auto quots = view.vertex_quotients();
+        auto clamped = view.vertex_clamped();
+        ret.invalidate_vertex_cache();
+        ret.m_cut_vertices.resize(view.vertex_count());
+        for (size_t i = 0; i < ret.m_cut_vertices.size(); ++i) {
+            auto &v = ret.m_cut_vertices[i];
+            for (int d = 0; d < 3; ++d) {
+                v.coord[d] = coords(d, i);
+            }
+            v.quot = quots.col(i);
+            v.clamped_indices = std::bitset<3>(clamped[i]);
+        }
+    }
+    ret.m_origV = view.origV().cast<double>();
+    ret.m_origF = view.origF().cast<int>();
+    {
+        auto normals = view.face_normals();
+        auto ids = view.face_ids();
+        auto boundaries = view.face_boundaries();
+        auto face_loops = view.face_loop_offsets();
+        auto loops = view.loop_offsets();
+        auto indices = view.loop_indices();
+        auto tri_offsets = view.face_triangle_offsets();
+        auto tris = view.face_triangles();
+        ret.m_faces.resize(view.face_count());
+        for (size_t i = 0; i < ret.m_faces.size(); ++i) {
+            auto &f = ret.m_faces[i];
+            f.N = normals.col(i);
+            if (ids(0, i) == -1) {
+                f.id = int(ids(1, i));
+            } else {
+                f.id = std::array<int, 2>{ { ids(0, i), ids(1, i) } };
+            }
+            if (boundaries(1, i) != -1) {
+                f.external_boundary = std::make_tuple(int(boundaries(0, i)), bool(boundaries(1, i)));
+            }
+            for (int l = face_loops[i]; l < face_loops[i + 1]; ++l) {
+                f.indices.emplace(indices.begin() + loops[l], indices.begin() + loops[l + 1]);
+            }
+            if (int tb = tri_offsets[i], te = tri_offsets[i + 1]; te > tb) {
+                f.triangulation = mtao::ColVecs3i(tris.middleCols(tb, te - tb).cast<int>());
+            }
+            f.update_mask(ret.cut_vertices(), ret.vertex_grid());
+        }
+    }
+    {
+        auto info = view.cell_info();
+        auto offsets = view.cell_offsets();
+        auto faces = view.cell_faces();
+        auto signs = view.cell_signs();
+        ret.m_cells.resize(view.cell_count());
+        for (size_t i = 0; i < ret.m_cells.size(); ++i) {
+            auto &c = ret.m_cells[i];
+            c.index = info(0, i);
+            c.region = info(1, i);
+            for (int d = 0; d < 3; ++d) {
+                c.grid_cell[d] = info(2 + d, i);
+            }
+            for (int j = offsets[i]; j < offsets[i + 1]; ++j) {
+                c.emplace_hint(c.end(), faces[j], bool(signs[j]));
+            }
+        }
+        ret.update_cell_face_incidence();
+    }
+    ret.m_folded_faces.insert(view.folded_faces().begin(), view.folded_faces().end());
+    {
+        auto info = view.mesh_face_info();
+        auto offsets = view.mesh_face_offsets();
+        auto barys = view.mesh_face_barycentrics();
+        for (int i = 0; i < info.cols(); ++i) {
+            ret.m_mesh_cut_faces[info(0, i)] = { mtao::ColVecs3d(barys.middleCols(offsets[i], offsets[i + 1] - offsets[i])), info(1, i) };
+        }
+    }
+    {
+        auto cubes = view.cubes();
+        for (size_t i = 0; i + 5 <= cubes.size(); i += 5) {
+            ret.m_exterior_grid.m_cells[cubes[i]] = AdaptiveGrid::Cell(AdaptiveGrid::coord_type{ { cubes[i + 1], cubes[i + 2], cubes[i + 3] } }, cubes[i + 4]);
+        }
+        ret.m_exterior_grid.make_faces();
+        auto regions = view.cube_regions();
+        for (size_t i = 0; i + 2 <= regions.size(); i += 2) {
+            ret.m_adaptive_grid_regions[regions[i]] = regions[i + 1];
+        }
+    }
+    return ret;
+}
+}// namespace mandoline
@@ -34,7 +34,7 @@ int CutCellMesh<2>::num_edges() const {
 auto CutCellMesh<2>::centroids() const -> ColVecs {
     ColVecs C(2,num_cells());
 
-    auto V = vertices();
+    auto &&V = cached_vertices();
     for(auto&& [idx, face]: mtao::iterator::enumerate(cut_faces())) {
         C.col(idx) = face.brep_centroid(V);
     }
@@ -112,7 +112,7 @@ auto CutCellMesh<2>::dual_edge_volumes() const -> VecX {
 //    return V;
 //}
 bool CutCellMesh<2>::in_cell(const VecCRef &p, int idx) const {
-    auto V = vertices();
+    auto &&V = cached_vertices();
     return in_cell(V, p, idx);
 }
 bool CutCellMesh<2>::in_cell(const ColVecs &V, const VecCRef &p, int idx) const {
@@ -133,7 +133,7 @@ int CutCellMesh<2>::cell_index(const VecCRef &p) const {
     }
 
 
-    auto V = vertices();
+    auto &&V = cached_vertices();
     int exterior_cell_index = exterior_grid.cell_index(c);
     if(exterior_cell_index == -1) {
         int grid_cell = grid_cell_index(c);
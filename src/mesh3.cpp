@@ -9,12 +9,16 @@
 #include <mtao/geometry/kdtree.hpp>
 #include <mtao/iterator/range.hpp>
 #include <igl/winding_number.h>
+#include <stdexcept>
+#include <string>
 #include "mandoline/diffgeo_utils.hpp"
 #include "mandoline/proto_util.hpp"
 #include "mandoline/operators/interpolation3.hpp"
 #include "mandoline/operators/boundary3.hpp"
 #include "mandoline/operators/volume3.hpp"
 #include "mandoline/operators/masks.hpp"
+#include "mandoline/cutcell_locator.hpp"
+#include "mandoline/flat_cutmesh.hpp"
 
 
 namespace mandoline {
@@ -66,7 +70,7 @@ auto CutCellMesh<3>::face_centroids() const -> mtao::ColVecs3d {
            V.topRows(StaggeredGrid::cell_size()).array() = dx().prod();
            */
     mtao::ColVecs3d ret(3, m_faces.size());
-    auto Vs = vertices();
+    auto &&Vs = cached_vertices();
     for (auto &&[i, f] : mtao::iterator::enumerate(m_faces)) {
         auto v = ret.col(i);
         v.setZero();
@@ -90,7 +94,7 @@ auto CutCellMesh<3>::cell_centroids() const -> mtao::ColVecs3d {
            V.topRows(StaggeredGrid::cell_size()).array() = dx().prod();
            */
     mtao::ColVecs3d face_brep_cents(3, face_size());
-    auto Vs = vertices();
+    auto &&Vs = cached_vertices();
     for (auto &&[i, f] : mtao::iterator::enumerate(m_faces)) {
         face_brep_cents.col(i) = f.brep_centroid(Vs);
         //face_brep_cents.col(i) = f.brep_volume(Vs) * f.brep_centroid(Vs);
@@ -98,8 +102,14 @@ auto CutCellMesh<3>::cell_centroids() const -> mtao::ColVecs3d {
     mtao::ColVecs3d V(3, cell_size());
     V.setZero();
     auto vols = cell_volumes();
-    for (auto &&[k, c] : mtao::iterator::enumerate(m_cells)) {
-        V.col(k) = c.moment(face_brep_cents);
+    auto &&inc = m_cell_face_incidence;
+    for (int k = 0; k < int(inc.cell_size()); ++k) {
+        // same as CutCell::moment
+        mtao::Vec3d c = mtao::Vec3d::Zero();
+        for (int j = inc.begin(k); j < inc.end(k); ++j) {
+            c += face_brep_cents.col(inc.face(j));
+        }
+        V.col(k) = c / inc.face_count(k);
         //V.col(k) = c.moment(face_brep_cents) / vols(k);
     }
 
@@ -121,29 +131,48 @@ int CutCellMesh<3>::local_grid_cell_index(const VecCRef &p) const {
 int CutCellMesh<3>::world_grid_cell_index(const VecCRef &p) const {
     return local_grid_cell_index(vertex_grid().local_coord(p));
 }
+void CutCellMesh<3>::update_cell_face_incidence() {
+    m_cell_face_incidence = CellFaceIncidence(m_cells);
+    for (auto &&c : m_cells) {
+        c.clear();
+    }
+    m_cell_maps.reset();
+}
+auto CutCellMesh<3>::cells() const -> const std::vector<CutCell> & {
+    auto maps = std::atomic_load(&m_cell_maps);
+    if (!maps) {
+        auto &&inc = m_cell_face_incidence;
+        auto built = std::make_shared<std::vector<CutCell>>(m_cells);
+        for (int i = 0; i < int(built->size()); ++i) {
+            auto &c = (*built)[i];
+            for (int k = inc.begin(i); k < inc.end(i); ++k) {
+                c.emplace_hint(c.end(), inc.face(k), inc.sign(k));
+            }
+        }
+        std::shared_ptr<const std::vector<CutCell>> cbuilt = std::move(built);
+        // if another thread finished first keep its copy so references already handed out stay valid
+        if (std::atomic_compare_exchange_strong(&m_cell_maps, &maps, cbuilt)) {
+            maps = std::move(cbuilt);
+        }
+    }
+    return *maps;
+}
 std::vector<std::set<int>> CutCellMesh<3>::cell_faces() const {
-    std::vector<std::set<int>> ret(m_cells.size());
-    std::transform(m_cells.begin(), m_cells.end(), ret.begin(), [](auto &&V) {
-        std::set<int> ret;
-        std::transform(V.begin(), V.end(), std::inserter(ret, ret.end()), [](auto &&v) {
-            return std::get<0>(v);
-        });
-
-        return ret;
-    });
+    auto &&inc = m_cell_face_incidence;
+    std::vector<std::set<int>> ret(inc.cell_size());
+    for (int i = 0; i < inc.cell_size(); ++i) {
+        auto b = inc.faces().begin();
+        ret[i] = std::set<int>(b + inc.begin(i), b + inc.end(i));
+    }
     return ret;
 }
 std::set<int> CutCellMesh<3>::cell_faces(int index) const {
-    auto &V = m_cells.at(index);
-    std::set<int> ret;
-    std::transform(V.begin(), V.end(), std::inserter(ret, ret.end()), [](auto &&v) {
-        return std::get<0>(v);
-    });
-
-    return ret;
+    auto &&inc = m_cell_face_incidence;
+    auto b = inc.faces().begin();
+    return std::set<int>(b + inc.begin(index), b + inc.end(index));
 }
 
-void CutCellMesh<3>::write(const std::string &prefix) const {
+void CutCellMesh<3>::write(const std::string &prefix, int version) const {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
     std::stringstream ss;
     auto CS = StaggeredGrid::cell_shape();
@@ -154,7 +183,7 @@ void CutCellMesh<3>::write(const std::string &prefix) const {
     //std::cout << "Output filename: " << ss.str() << std::endl;
     std::ofstream ofs(ss.str(), std::ios::binary);
     protobuf::CutMeshProto cmp;
-    serialize(cmp);
+    serialize(cmp, version);
     cmp.SerializeToOstream(&ofs);
 }
 
@@ -171,11 +200,12 @@ std::vector<int> CutCellMesh<3>::regions(bool boundary_sign_regions) const {
     std::vector<int> ret(cell_size(), 1);
 
     if (boundary_sign_regions) {
-        for (auto &&[idx, c] : mtao::iterator::enumerate(m_cells)) {
+        auto &&inc = m_cell_face_incidence;
+        for (int idx = 0; idx < inc.cell_size(); ++idx) {
             Edge counts{ { 0, 0 } };// 1 -1
-            for (auto &&[f, b] : c) {
-                if (is_mesh_face(f)) {
-                    counts[b ? 0 : 1]++;
+            for (int k = inc.begin(idx); k < inc.end(idx); ++k) {
+                if (is_mesh_face(inc.face(k))) {
+                    counts[inc.sign(k) ? 0 : 1]++;
                 }
             }
             if (counts[0] + counts[1] > 0) {
@@ -201,13 +231,13 @@ std::vector<std::array<std::set<int>, 2>> CutCellMesh<3>::face_regions() const {
     auto R = regions();
     std::copy(R.begin(), R.end(), std::ostream_iterator<int>(std::cout, ","));
     std::vector<std::array<std::set<int>, 2>> ret(*std::max_element(R.begin(), R.end()) + 1);
-    for (auto &&[cidx, c] : mtao::iterator::enumerate(cells())) {
-        for (auto &&[fidx, s] : c) {
-            auto &f = faces()[fidx];
-            int region = R[cidx];
-            auto &rset = ret[region];
-            if (f.is_mesh_face()) {
-                rset[s ? 0 : 1].insert(fidx);
+    auto &&inc = m_cell_face_incidence;
+    for (int cidx = 0; cidx < inc.cell_size(); ++cidx) {
+        auto &rset = ret[R[cidx]];
+        for (int k = inc.begin(cidx); k < inc.end(cidx); ++k) {
+            int fidx = inc.face(k);
+            if (faces()[fidx].is_mesh_face()) {
+                rset[inc.sign(k) ? 0 : 1].insert(fidx);
             }
         }
     }
@@ -277,16 +307,30 @@ mtao::ColVecs3d CutCellMesh<3>::region_centroids() const {
 
 
 CutCellMesh<3> CutCellMesh<3>::from_file(const std::string &filename) {
+    if (flat::is_flat_file(filename)) {
+        return from_flat(filename);
+    }
     return from_proto(filename);
 }
 
 
-void CutCellMesh<3>::serialize(protobuf::CutMeshProto &cmp) const {
+void CutCellMesh<3>::serialize(protobuf::CutMeshProto &cmp, int version) const {
 
     protobuf::serialize(origin(), *cmp.mutable_origin());
     protobuf::serialize(dx(), *cmp.mutable_dx());
     protobuf::serialize(vertex_shape(), *cmp.mutable_shape());
 
+    for (auto &&i : m_folded_faces) {
+        cmp.add_foldedfaces(i);
+    }
+    if (version >= 2) {
+        cmp.set_version(2);
+        serialize_v2(cmp);
+    } else {
+        serialize_v1(cmp);
+    }
+}
+void CutCellMesh<3>::serialize_v1(protobuf::CutMeshProto &cmp) const {
 
     for (int i = 0; i < cut_vertex_size(); ++i) {
         protobuf::serialize(cut_vertex(i), *cmp.add_vertices());
@@ -306,12 +350,9 @@ void CutCellMesh<3>::serialize(protobuf::CutMeshProto &cmp) const {
     for (auto &&f : m_faces) {
         f.serialize(*cmp.add_faces());
     }
-    for (auto &&c : m_cells) {
+    for (auto &&c : cells()) {
         c.serialize(*cmp.add_cells());
     }
-    for (auto &&i : m_folded_faces) {
-        cmp.add_foldedfaces(i);
-    }
     auto &&mf = *cmp.mutable_mesh_faces();
     for (auto &&[idx, bmf] : m_mesh_cut_faces) {
         auto &b = mf[idx];
@@ -331,6 +372,183 @@ void CutCellMesh<3>::serialize(protobuf::CutMeshProto &cmp) const {
         }
     }
 }
+
+namespace {
+    // resizes a packed field and returns its storage so it can be filled in place
+    template<typename T>
+    T *packed_storage(google::protobuf::RepeatedField<T> *field, size_t size) {
+        field->Resize(size, T{});
+        return field->mutable_data();
+    }
+
+    // the packed columns are validated before they are read so a malformed message can't index out of bounds
+    [[noreturn]] void malformed_packed_column(const std::string &name) {
+        throw std::runtime_error("CutMeshProto: malformed packed column " + name);
+    }
+    template<typename T>
+    void check_packed_size(const google::protobuf::RepeatedField<T> &field, size_t size, const std::string &name) {
+        if (size_t(field.size()) != size) {
+            malformed_packed_column(name);
+        }
+    }
+    // count + 1 offsets that start at 0, never decrease and end at end
+    void check_packed_offsets(const google::protobuf::RepeatedField<int> &offsets, size_t count, size_t end, const std::string &name) {
+        check_packed_size(offsets, count + 1, name);
+        if (offsets[0] != 0 || size_t(offsets[count]) != end) {
+            malformed_packed_column(name);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                malformed_packed_column(name);
+            }
+        }
+    }
+    // every index in [0,end)
+    void check_packed_indices(const google::protobuf::RepeatedField<int> &indices, size_t end, const std::string &name) {
+        for (int idx : indices) {
+            if (idx < 0 || size_t(idx) >= end) {
+                malformed_packed_column(name);
+            }
+        }
+    }
+    // every coordinate triple spans a cube of its width (1 without widths) inside shape
+    void check_packed_coords(const google::protobuf::RepeatedField<int> &coords, const std::array<int, 3> &shape, const google::protobuf::RepeatedField<int> *widths, const std::string &name) {
+        for (int i = 0; i < coords.size() / 3; ++i) {
+            const int width = widths ? (*widths)[i] : 1;
+            for (int d = 0; d < 3; ++d) {
+                int c = coords[3 * i + d];
+                if (width < 1 || c < 0 || int64_t(c) + width > shape[d]) {
+                    malformed_packed_column(name);
+                }
+            }
+        }
+    }
+}// namespace
+void CutCellMesh<3>::serialize_v2(protobuf::CutMeshProto &cmp) const {
+    {
+        auto &pv = *cmp.mutable_packed_vertices();
+        const size_t size = m_cut_vertices.size();
+        int *coords = packed_storage(pv.mutable_coords(), 3 * size);
+        double *quots = packed_storage(pv.mutable_quotients(), 3 * size);
+        uint32_t *clamped = packed_storage(pv.mutable_clamped(), size);
+        for (size_t i = 0; i < size; ++i) {
+            auto &&v = m_cut_vertices[i];
+            for (int d = 0; d < 3; ++d) {
+                coords[3 * i + d] = v.coord[d];
+                quots[3 * i + d] = v.quot(d);
+            }
+            clamped[i] = v.clamped_indices.to_ulong();
+        }
+    }
+    std::copy(m_origV.data(), m_origV.data() + m_origV.size(), packed_storage(cmp.mutable_packed_origv(), m_origV.size()));
+    std::copy(m_origF.data(), m_origF.data() + m_origF.size(), packed_storage(cmp.mutable_packed_origf(), m_origF.size()));
+    {
+        auto &pf = *cmp.mutable_packed_faces();
+        const size_t size = m_faces.size();
+        double *normals = packed_storage(pf.mutable_normals(), 3 * size);
+        int *axes = packed_storage(pf.mutable_axes(), size);
+        int *ids = packed_storage(pf.mutable_ids(), size);
+        int *face_curve_offsets = packed_storage(pf.mutable_face_curve_offsets(), size + 1);
+        size_t curve_count = 0, index_count = 0, triangle_count = 0;
+        for (auto &&f : m_faces) {
+            curve_count += f.indices.size();
+            for (auto &&c : f.indices) {
+                index_count += c.size();
+            }
+            if (f.has_persistent_triangulation()) {
+                triangle_count += f.triangulation->cols();
+            }
+        }
+        int *curve_offsets = packed_storage(pf.mutable_curve_offsets(), curve_count + 1);
+        int *curve_indices = packed_storage(pf.mutable_curve_indices(), index_count);
+        int *triangulation_offsets = nullptr;
+        int *triangulation = nullptr;
+        if (triangle_count > 0) {
+            triangulation_offsets = packed_storage(pf.mutable_triangulation_offsets(), size + 1);
+            triangulation = packed_storage(pf.mutable_triangulation(), 3 * triangle_count);
+            triangulation_offsets[0] = 0;
+        }
+        face_curve_offsets[0] = 0;
+        curve_offsets[0] = 0;
+        int curve = 0, index = 0, triangle = 0;
+        for (size_t i = 0; i < size; ++i) {
+            auto &&f = m_faces[i];
+            for (int d = 0; d < 3; ++d) {
+                normals[3 * i + d] = f.N(d);
+            }
+            if (f.is_mesh_face()) {
+                axes[i] = -1;
+                ids[i] = f.as_face_id();
+            } else {
+                auto &&[axis, value] = f.as_axial_id();
+                axes[i] = axis;
+                ids[i] = value;
+            }
+            for (auto &&c : f.indices) {
+                index = std::copy(c.begin(), c.end(), curve_indices + index) - curve_indices;
+                curve_offsets[++curve] = index;
+            }
+            face_curve_offsets[i + 1] = curve;
+            if (triangulation) {
+                if (f.has_persistent_triangulation()) {
+                    auto &&T = *f.triangulation;
+                    std::copy(T.data(), T.data() + T.size(), triangulation + 3 * triangle);
+                    triangle += T.cols();
+                }
+                triangulation_offsets[i + 1] = triangle;
+            }
+            if (f.external_boundary) {
+                auto [b, s] = *f.external_boundary;
+                pf.add_boundary_faces(i);
+                pf.add_boundary_indices(b);
+                pf.add_boundary_signs(s);
+            }
+        }
+    }
+    {
+        auto &pc = *cmp.mutable_packed_cells();
+        const size_t size = m_cells.size();
+        int *ids = packed_storage(pc.mutable_ids(), size);
+        int *regions = packed_storage(pc.mutable_regions(), size);
+        int *grid_cells = packed_storage(pc.mutable_grid_cells(), 3 * size);
+        auto &&inc = m_cell_face_incidence;
+        std::copy(inc.offsets().begin(), inc.offsets().end(), packed_storage(pc.mutable_offsets(), inc.offsets().size()));
+        std::copy(inc.faces().begin(), inc.faces().end(), packed_storage(pc.mutable_faces(), inc.size()));
+        bool *signs = packed_storage(pc.mutable_signs(), inc.size());
+        for (size_t k = 0; k < inc.size(); ++k) {
+            signs[k] = inc.sign(k);
+        }
+        for (size_t i = 0; i < size; ++i) {
+            auto &&c = m_cells[i];
+            ids[i] = c.index;
+            regions[i] = c.region;
+            std::copy(c.grid_cell.begin(), c.grid_cell.end(), grid_cells + 3 * i);
+        }
+    }
+    {
+        auto &pm = *cmp.mutable_packed_mesh_faces();
+        pm.add_offsets(0);
+        for (auto &&[idx, bmf] : m_mesh_cut_faces) {
+            pm.add_faces(idx);
+            pm.add_parent_ids(bmf.parent_fid);
+            auto &&B = bmf.barys;
+            pm.mutable_barycentric_coordinates()->Add(B.data(), B.data() + B.size());
+            pm.add_offsets(pm.barycentric_coordinates_size() / 3);
+        }
+    }
+    {
+        auto &pc = *cmp.mutable_packed_cubes();
+        for (auto &&[c, cell] : m_exterior_grid.cells()) {
+            pc.add_ids(c);
+            pc.mutable_corners()->Add(cell.corner().begin(), cell.corner().end());
+            pc.add_radii(cell.width());
+        }
+        for (auto &&[a, b] : m_adaptive_grid_regions) {
+            pc.add_region_cubes(a);
+            pc.add_regions(b);
+        }
+    }
+}
 CutCellMesh<3> CutCellMesh<3>::from_proto(const std::string &filename) {
     std::ifstream ifs(filename, std::ios::binary);
     if (ifs.good()) {
@@ -353,35 +571,50 @@ CutCellMesh<3> CutCellMesh<3>::from_proto(const protobuf::CutMeshProto &cmp) {
     CutCellMesh<3> ret = CutCellMesh<3>::StaggeredGrid(GridType(s, dx, o));
     //ret.m_face_volumes.resize(20);
 
-    ret.m_cut_vertices.resize(cmp.vertices().size());
-    for (int i = 0; i < ret.cut_vertex_size(); ++i) {
-        protobuf::deserialize(cmp.vertices(i), ret.m_cut_vertices[i]);
+    if (cmp.version() > 2) {
+        throw std::runtime_error("CutMeshProto: unknown version " + std::to_string(cmp.version()));
+    } else if (cmp.version() == 2) {
+        ret.deserialize_v2(cmp);
+    } else {
+        ret.deserialize_v1(cmp);
+    }
+    ret.update_cell_face_incidence();
+    std::copy(cmp.foldedfaces().begin(), cmp.foldedfaces().end(), std::inserter(ret.m_folded_faces, ret.m_folded_faces.end()));
+    ret.m_exterior_grid.make_faces();
+
+    return ret;
+}
+void CutCellMesh<3>::deserialize_v1(const protobuf::CutMeshProto &cmp) {
+
+    invalidate_vertex_cache();
+    m_cut_vertices.resize(cmp.vertices().size());
+    for (int i = 0; i < cut_vertex_size(); ++i) {
+        protobuf::deserialize(cmp.vertices(i), m_cut_vertices[i]);
     }
     // TODO: Add back in after updating proto
     /*
-        ret.m_cut_edges.resize(2,cmp.edges().size());
-        for(int i = 0; i < ret.cut_edge_size(); ++i) {
-            ret.m_cut_edges.col(i) = protobuf::deserialize(cmp.edges(i));
+        m_cut_edges.resize(2,cmp.edges().size());
+        for(int i = 0; i < cut_edge_size(); ++i) {
+            m_cut_edges.col(i) = protobuf::deserialize(cmp.edges(i));
         }
         */
-    ret.m_origV.resize(3, cmp.origv().size());
-    for (int i = 0; i < ret.m_origV.cols(); ++i) {
-        ret.m_origV.col(i) = protobuf::deserialize(cmp.origv(i));
+    m_origV.resize(3, cmp.origv().size());
+    for (int i = 0; i < m_origV.cols(); ++i) {
+        m_origV.col(i) = protobuf::deserialize(cmp.origv(i));
     }
-    ret.m_origF.resize(3, cmp.origf().size());
-    for (int i = 0; i < ret.m_origF.cols(); ++i) {
-        ret.m_origF.col(i) = protobuf::deserialize(cmp.origf(i));
+    m_origF.resize(3, cmp.origf().size());
+    for (int i = 0; i < m_origF.cols(); ++i) {
+        m_origF.col(i) = protobuf::deserialize(cmp.origf(i));
     }
-    ret.m_faces.resize(cmp.faces().size());
+    m_faces.resize(cmp.faces().size());
     for (int i = 0; i < cmp.faces().size(); ++i) {
-        ret.m_faces[i] = CutFace<3>::from_proto(cmp.faces(i));
-        ret.m_faces[i].update_mask(ret.cut_vertices(), ret.vertex_grid());
+        m_faces[i] = CutFace<3>::from_proto(cmp.faces(i));
+        m_faces[i].update_mask(cut_vertices(), vertex_grid());
     }
-    ret.m_cells.resize(cmp.cells().size());
+    m_cells.resize(cmp.cells().size());
     for (int i = 0; i < cmp.cells().size(); ++i) {
-        ret.m_cells[i] = CutCell::from_proto(cmp.cells(i));
+        m_cells[i] = CutCell::from_proto(cmp.cells(i));
     }
-    std::copy(cmp.foldedfaces().begin(), cmp.foldedfaces().end(), std::inserter(ret.m_folded_faces, ret.m_folded_faces.end()));
 
 
     for (auto &&[idx, btf] : cmp.mesh_faces()) {
@@ -391,21 +624,168 @@ CutCellMesh<3> CutCellMesh<3>::from_proto(const protobuf::CutMeshProto &cmp) {
         for (int i = 0; i < bssize; ++i) {
             B.col(i) = protobuf::deserialize(btf.barycentric_coordinates(i));
         }
-        ret.m_mesh_cut_faces[idx] = { B, pid };
+        m_mesh_cut_faces[idx] = { B, pid };
     }
 
     for (auto &&[a, b] : cmp.cubes()) {
-        ret.m_exterior_grid.m_cells[a] = AdaptiveGrid::Cell::from_proto(b);
+        m_exterior_grid.m_cells[a] = AdaptiveGrid::Cell::from_proto(b);
     }
-    ret.m_exterior_grid.make_faces();
     for (auto &&[a, b] : cmp.cube_regions()) {
-        ret.m_adaptive_grid_regions[a] = b;
+        m_adaptive_grid_regions[a] = b;
+    }
+}
+void CutCellMesh<3>::deserialize_v2(const protobuf::CutMeshProto &cmp) {
+    {
+        auto &&pv = cmp.packed_vertices();
+        const size_t size = pv.clamped_size();
+        check_packed_size(pv.coords(), 3 * size, "packed_vertices.coords");
+        check_packed_size(pv.quotients(), 3 * size, "packed_vertices.quotients");
+        invalidate_vertex_cache();
+        m_cut_vertices.resize(size);
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < cut_vertex_size(); ++i) {
+            auto &v = m_cut_vertices[i];
+            for (int d = 0; d < 3; ++d) {
+                v.coord[d] = pv.coords(3 * i + d);
+                v.quot(d) = pv.quotients(3 * i + d);
+            }
+            v.clamped_indices = std::bitset<3>(pv.clamped(i));
+        }
+    }
+    if (cmp.packed_origv_size() % 3 != 0) {
+        malformed_packed_column("packed_origV");
+    }
+    if (cmp.packed_origf_size() % 3 != 0) {
+        malformed_packed_column("packed_origF");
+    }
+    check_packed_indices(cmp.packed_origf(), cmp.packed_origv_size() / 3, "packed_origF");
+    m_origV = Eigen::Map<const mtao::ColVecs3d>(cmp.packed_origv().data(), 3, cmp.packed_origv_size() / 3);
+    m_origF = Eigen::Map<const mtao::ColVecs3i>(cmp.packed_origf().data(), 3, cmp.packed_origf_size() / 3);
+    {
+        auto &&pf = cmp.packed_faces();
+        auto &&face_curves = pf.face_curve_offsets();
+        auto &&curves = pf.curve_offsets();
+        auto &&indices = pf.curve_indices();
+        auto &&tri_offsets = pf.triangulation_offsets();
+        auto &&tris = pf.triangulation();
+        const size_t size = pf.axes_size();
+        check_packed_size(pf.normals(), 3 * size, "packed_faces.normals");
+        check_packed_size(pf.ids(), size, "packed_faces.ids");
+        check_packed_offsets(face_curves, size, curves.empty() ? 0 : curves.size() - 1, "packed_faces.face_curve_offsets");
+        check_packed_offsets(curves, face_curves[size], indices.size(), "packed_faces.curve_offsets");
+        check_packed_indices(indices, num_vertices(), "packed_faces.curve_indices");
+        const bool has_triangulations = !tri_offsets.empty();
+        if (has_triangulations) {
+            if (tris.size() % 3 != 0) {
+                malformed_packed_column("packed_faces.triangulation");
+            }
+            check_packed_offsets(tri_offsets, size, tris.size() / 3, "packed_faces.triangulation_offsets");
+            check_packed_indices(tris, num_vertices(), "packed_faces.triangulation");
+        } else if (!tris.empty()) {
+            malformed_packed_column("packed_faces.triangulation");
+        }
+        check_packed_size(pf.boundary_indices(), pf.boundary_faces_size(), "packed_faces.boundary_indices");
+        check_packed_size(pf.boundary_signs(), pf.boundary_faces_size(), "packed_faces.boundary_signs");
+        check_packed_indices(pf.boundary_faces(), size, "packed_faces.boundary_faces");
+        for (size_t j = 0; j < size; ++j) {
+            if (pf.axes(j) == -1 ? pf.ids(j) < 0 || pf.ids(j) >= m_origF.cols() : pf.axes(j) < 0 || pf.axes(j) >= 3) {
+                malformed_packed_column("packed_faces.ids");
+            }
+        }
+        m_faces.resize(size);
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < m_faces.size(); ++i) {
+            auto &f = m_faces[i];
+            f.N = Eigen::Map<const mtao::Vec3d>(pf.normals().data() + 3 * i);
+            if (pf.axes(i) == -1) {
+                f.id = int(pf.ids(i));
+            } else {
+                f.id = std::array<int, 2>{ { pf.axes(i), pf.ids(i) } };
+            }
+            for (int c = face_curves[i]; c < face_curves[i + 1]; ++c) {
+                f.indices.emplace(indices.begin() + curves[c], indices.begin() + curves[c + 1]);
+            }
+            if (has_triangulations && tri_offsets[i + 1] > tri_offsets[i]) {
+                f.triangulation = mtao::ColVecs3i(Eigen::Map<const mtao::ColVecs3i>(tris.data() + 3 * tri_offsets[i], 3, tri_offsets[i + 1] - tri_offsets[i]));
+            }
+            f.update_mask(cut_vertices(), vertex_grid());
+        }
+        for (int j = 0; j < pf.boundary_faces_size(); ++j) {
+            m_faces[pf.boundary_faces(j)].external_boundary = std::make_tuple(int(pf.boundary_indices(j)), pf.boundary_signs(j));
+        }
+    }
+    {
+        auto &&pc = cmp.packed_cells();
+        auto &&offsets = pc.offsets();
+        const size_t size = pc.ids_size();
+        check_packed_size(pc.regions(), size, "packed_cells.regions");
+        check_packed_size(pc.grid_cells(), 3 * size, "packed_cells.grid_cells");
+        check_packed_size(pc.signs(), pc.faces_size(), "packed_cells.signs");
+        check_packed_offsets(offsets, size, pc.faces_size(), "packed_cells.offsets");
+        check_packed_indices(pc.faces(), m_faces.size(), "packed_cells.faces");
+        check_packed_coords(pc.grid_cells(), StaggeredGrid::cell_shape(), nullptr, "packed_cells.grid_cells");
+        m_cells.resize(size);
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < m_cells.size(); ++i) {
+            auto &c = m_cells[i];
+            c.index = pc.ids(i);
+            c.region = pc.regions(i);
+            for (int d = 0; d < 3; ++d) {
+                c.grid_cell[d] = pc.grid_cells(3 * i + d);
+            }
+            for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+                c.emplace_hint(c.end(), pc.faces(k), pc.signs(k));
+            }
+        }
+    }
+    {
+        auto &&pm = cmp.packed_mesh_faces();
+        auto &&offsets = pm.offsets();
+        check_packed_size(pm.parent_ids(), pm.faces_size(), "packed_mesh_faces.parent_ids");
+        if (pm.barycentric_coordinates_size() % 3 != 0) {
+            malformed_packed_column("packed_mesh_faces.barycentric_coordinates");
+        }
+        check_packed_offsets(offsets, pm.faces_size(), pm.barycentric_coordinates_size() / 3, "packed_mesh_faces.offsets");
+        check_packed_indices(pm.faces(), m_faces.size(), "packed_mesh_faces.faces");
+        check_packed_indices(pm.parent_ids(), m_origF.cols(), "packed_mesh_faces.parent_ids");
+        for (int i = 0; i < pm.faces_size(); ++i) {
+            mtao::ColVecs3d B = Eigen::Map<const mtao::ColVecs3d>(pm.barycentric_coordinates().data() + 3 * offsets[i], 3, offsets[i + 1] - offsets[i]);
+            m_mesh_cut_faces[pm.faces(i)] = { B, pm.parent_ids(i) };
+        }
+    }
+    {
+        auto &&pc = cmp.packed_cubes();
+        check_packed_size(pc.corners(), 3 * pc.ids_size(), "packed_cubes.corners");
+        check_packed_size(pc.radii(), pc.ids_size(), "packed_cubes.radii");
+        check_packed_size(pc.regions(), pc.region_cubes_size(), "packed_cubes.regions");
+        // cubes are rasterized into the cell grid, so each one has to fit inside it
+        check_packed_coords(pc.corners(), StaggeredGrid::cell_shape(), &pc.radii(), "packed_cubes.corners");
+        for (int i = 0; i < pc.ids_size(); ++i) {
+            auto [it, inserted] = m_exterior_grid.m_cells.try_emplace(pc.ids(i), AdaptiveGrid::Cell(AdaptiveGrid::coord_type{ { pc.corners(3 * i), pc.corners(3 * i + 1), pc.corners(3 * i + 2) } }, pc.radii(i)));
+            if (!inserted) {
+                malformed_packed_column("packed_cubes.ids");
+            }
+        }
+        auto &&cubes = m_exterior_grid.m_cells;
+        for (int i = 0; i < pc.region_cubes_size(); ++i) {
+            if (cubes.count(pc.region_cubes(i)) == 0) {
+                malformed_packed_column("packed_cubes.region_cubes");
+            }
+            m_adaptive_grid_regions[pc.region_cubes(i)] = pc.regions(i);
+        }
+        // an external boundary is a cube, -1 for an unowned cell or -2 for the domain boundary
+        for (int idx : cmp.packed_faces().boundary_indices()) {
+            if (idx < -2 || (idx >= 0 && cubes.count(idx) == 0)) {
+                malformed_packed_column("packed_faces.boundary_indices");
+            }
+        }
     }
-
-    return ret;
 }
 std::array<mtao::ColVecs2d, 3> CutCellMesh<3>::compute_subVs() const {
-    auto V = vertices();
+    auto &&V = cached_vertices();
     std::array<mtao::ColVecs2d, 3> subVs;
     for (int d = 0; d < 3; ++d) {
         int n0 = (d + 1) % 3;
@@ -419,6 +799,13 @@ std::array<mtao::ColVecs2d, 3> CutCellMesh<3>::compute_subVs() const {
     return subVs;
 }
 std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::triangulate_face(int face_index) const {
+    if (auto &&f = m_faces[face_index]; f.triangulation) {
+        if (f.triangulated_vertices) {
+            return { vertex_grid().world_coord(*f.triangulated_vertices), *f.triangulation };
+        } else {
+            return { mtao::ColVecs3d{}, *f.triangulation };
+        }
+    }
     mtao::logging::warn() << "Inefficient use of triangulation!  try caching your triangulations";
     std::array<mtao::ColVecs2d, 3> subVs = compute_subVs();
     auto [V, F] = m_faces[face_index].triangulate(subVs, true);
@@ -429,13 +816,25 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::triangulate_face(in
     }
 }
 
-void CutCellMesh<3>::triangulate_faces(bool add_verts) {
+void CutCellMesh<3>::triangulate_faces(bool add_verts, bool force) {
+    std::vector<int> missing;
+    for (auto &&[i, face] : mtao::iterator::enumerate(m_faces)) {
+        // a cached triangulation with extra vertices can't be used if only the mesh vertices are wanted
+        if (force || !face.triangulation || (!add_verts && face.triangulated_vertices)) {
+            missing.emplace_back(i);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
     std::array<mtao::ColVecs2d, 3> subVs = compute_subVs();
 
     int i = 0;
-#pragma omp parallel for
-    for (i = 0; i < m_faces.size(); ++i) {
-        auto &&face = m_faces[i];
+#pragma omp parallel for schedule(dynamic, 64)
+    for (i = 0; i < missing.size(); ++i) {
+        auto &&face = m_faces[missing[i]];
+        face.triangulated_vertices = {};
+        face.triangulation = {};
         face.cache_triangulation(subVs, add_verts);
     }
 }
@@ -547,7 +946,9 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::triangulated_cell(i
     if (is_cut_cell(idx)) {
         std::vector<mtao::ColVecs3d> mVs;
         std::vector<mtao::ColVecs3i> mFs;
-        for (auto &&[fidx, b] : m_cells[idx]) {
+        auto &&inc = m_cell_face_incidence;
+        for (int k = inc.begin(idx); k < inc.end(idx); ++k) {
+            int fidx = inc.face(k);
             bool is_flap = m_folded_faces.find(fidx) != m_folded_faces.end();
             bool is_base = !is_flap;
             if ((use_flap && is_flap) || (use_base && !is_flap)) {
@@ -563,7 +964,7 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::triangulated_cell(i
                 } else {
                     std::tie(V, F) = triangulate_face(fidx);
                 }
-                if (!b) {
+                if (!inc.sign(k)) {
                     auto tmp = F.row(0).eval();
                     F.row(0) = F.row(1);
                     F.row(1) = tmp;
@@ -593,7 +994,7 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::triangulated_cell(i
 
 std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::compact_triangulated_cell(int cell_index) const {
     auto [V, F] = triangulated_cell(cell_index, true, true);
-    return mtao::geometry::mesh::compactify(mtao::eigen::hstack(vertices(), V), F);
+    return mtao::geometry::mesh::compactify(mtao::eigen::hstack(cached_vertices(), V), F);
 }
 std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::compact_triangulated_face(int face_index, bool flip) const {
     auto &f = m_faces[face_index];
@@ -604,9 +1005,9 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::compact_triangulate
         mtao::ColVecs3d V;
         mtao::ColVecs3i F;
         if (f.triangulated_vertices) {
-            std::tie(V, F) = mtao::geometry::mesh::compactify(mtao::eigen::hstack(vertices(), vertex_grid().world_coord(*f.triangulated_vertices)), *f.triangulation);
+            std::tie(V, F) = mtao::geometry::mesh::compactify(mtao::eigen::hstack(cached_vertices(), vertex_grid().world_coord(*f.triangulated_vertices)), *f.triangulation);
         } else {
-            std::tie(V, F) = mtao::geometry::mesh::compactify(vertices(), *f.triangulation);
+            std::tie(V, F) = mtao::geometry::mesh::compactify(cached_vertices(), *f.triangulation);
         }
         if (flip) {
             auto R = F.row(0).eval();
@@ -619,14 +1020,14 @@ std::tuple<mtao::ColVecs3d, mtao::ColVecs3i> CutCellMesh<3>::compact_triangulate
 
 auto CutCellMesh<3>::cells_by_grid_cell() const -> std::map<coord_type, std::set<int>> {
     std::map<coord_type, std::set<int>> R;
-    for (auto &&[i, c] : mtao::iterator::enumerate(cells())) {
+    for (auto &&[i, c] : mtao::iterator::enumerate(m_cells)) {
         R[c.grid_cell].insert(i);
     }
     return R;
 }
 std::set<int> CutCellMesh<3>::cells_in_grid_cell(const coord_type &c) const {
     std::set<int> R;
-    for (auto &&[i, cell] : mtao::iterator::enumerate(cells())) {
+    for (auto &&[i, cell] : mtao::iterator::enumerate(m_cells)) {
         if (cell.grid_cell == c) {
             R.insert(i);
         }
@@ -646,10 +1047,15 @@ int CutCellMesh<3>::get_cell_index(const VecCRef &p) const {
 
         auto [c, q] = vertex_grid().coord(p);
         auto cell_indices = cells_in_grid_cell(c);
-        auto V = vertices();
+        auto &&V = cached_vertices();
+        auto &&inc = m_cell_face_incidence;
         for (auto &&ci : cell_indices) {
-            auto &&cell = cells().at(ci);
-            if (cell.contains(V, faces(), p)) {
+            //> 4 * M_PI, but with some slack, same as CutCell::contains
+            double sa = 0;
+            for (int k = inc.begin(ci); k < inc.end(ci); ++k) {
+                sa += (inc.sign(k) ? -1 : 1) * m_faces[inc.face(k)].solid_angle(V, p);
+            }
+            if (sa > .5) {
                 std::cout << std::endl;
                 return ci;
             }
@@ -662,6 +1068,10 @@ int CutCellMesh<3>::get_cell_index(const VecCRef &p) const {
     return -1;
 }
 
+mtao::VecXi CutCellMesh<3>::get_cell_indices(const ColVecs &P) const {
+    return CutCellLocator(*this).locate(P);
+}
+
 auto CutCellMesh<3>::edges() const -> Edges {
     return Base::edges();
 }
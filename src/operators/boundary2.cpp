@@ -40,9 +40,9 @@ std::set<int> grid_boundary_faces(const CutCellMesh<2> &ccm) {
     std::set<int> ret;
     for (auto &&[fidx, f] : mtao::iterator::enumerate(ccm.cut_edges())) {
         auto mask = f.mask();
-        for (auto [dim, valo] : mtao::iterator::enumerate(mask)) {
-            if (valo) {
-                int val = *valo;
+        for (int dim = 0; dim < 2; ++dim) {
+            if (mask.is_bound(dim)) {
+                int val = *mask[dim];
                 if (val == 0) {
                     ret.insert(fidx);
                 } else if (val == ccm.vertex_shape()[dim] - 1) {
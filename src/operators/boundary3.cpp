@@ -1,45 +1,63 @@
 #include "mandoline/operators/boundary3.hpp"
 #include "mandoline/operators/boundary.hpp"
+#include "mandoline/operators/sparse_assembly.hpp"
 
 
 namespace mandoline::operators {
 
 Eigen::SparseMatrix<double> boundary(const CutCellMesh<3> &ccm, bool include_domain_boundary) {
-    auto trips = boundary_triplets(ccm.exterior_grid(), ccm.faces().size(), include_domain_boundary);
-    Eigen::SparseMatrix<double> B(ccm.face_size(), ccm.cell_size());
+    auto &&ag = ccm.exterior_grid();
+    auto &&ag_faces = ag.faces();
+    auto &&faces = ccm.faces();
+    auto &&inc = ccm.cell_face_incidence();
 
-    auto g = ccm.exterior_grid().cell_ownership_grid();
+    auto g = ag.cell_ownership_grid();
 
-    for (auto &&c : ccm.cells()) {
-        int region = c.region;
-        for (auto &&[fidx, s] : c) {
-            auto &f = ccm.faces()[fidx];
-            if(include_domain_boundary || !(f.external_boundary && std::get<0>(*f.external_boundary) == -2)) {
-                trips.emplace_back(fidx, c.index, s ? -1 : 1);
+    const int cell_count = inc.cell_size();
+    const int face_count = faces.size();
+    // sources are the cut cells, then the cut faces (for their exterior neighbor), then the adaptive grid faces
+    return assemble_sparse(ccm.face_size(), ccm.cell_size(), cell_count + face_count + ag_faces.size(), [&](int i, auto &&emit) {
+        if (i < cell_count) {
+            int cidx = ccm.cut_cell_index(i);
+            for (int j = inc.begin(i); j < inc.end(i); ++j) {
+                int fidx = inc.face(j);
+                auto &f = faces[fidx];
+                if (include_domain_boundary || !(f.external_boundary && std::get<0>(*f.external_boundary) == -2)) {
+                    emit(fidx, cidx, inc.sign(j) ? -1 : 1);
+                }
             }
-        }
-    }
-    for (auto &&[fidx, f] : mtao::iterator::enumerate(ccm.faces())) {
-        if (f.external_boundary) {
-            auto [c, s] = *f.external_boundary;
-            if (c >= 0) {
-                trips.emplace_back(fidx, g.get(c), s ? -1 : 1);
+        } else if (int fidx = i - cell_count; fidx < face_count) {
+            auto &f = faces[fidx];
+            if (f.external_boundary) {
+                auto [c, s] = *f.external_boundary;
+                if (c >= 0) {
+                    emit(fidx, g.get(c), s ? -1 : 1);
+                }
+            }
+        } else {
+            // same entries as boundary_triplets(ag, face_count, include_domain_boundary)
+            int agidx = fidx - face_count;
+            auto &e = ag_faces[agidx].dual_edge;
+            if (!include_domain_boundary || ag.is_boundary_face(e)) {
+                auto [l, h] = e;
+                if (l >= 0) {
+                    emit(face_count + agidx, l, -1);
+                }
+                if (h >= 0) {
+                    emit(face_count + agidx, h, 1);
+                }
             }
         }
-    }
-
-
-    B.setFromTriplets(trips.begin(), trips.end());
-    return B;
+    });
 }
 //for removing mesh faces
 std::set<int> grid_boundary_faces(const CutCellMesh<3> &ccm) {
     std::set<int> ret;
     for (auto &&[fidx, f] : mtao::iterator::enumerate(ccm.faces())) {
         auto mask = f.mask();
-        for (auto [dim, valo] : mtao::iterator::enumerate(mask)) {
-            if (valo) {
-                int val = *valo;
+        for (int dim = 0; dim < 3; ++dim) {
+            if (mask.is_bound(dim)) {
+                int val = *mask[dim];
                 if (val == 0) {
                     ret.insert(fidx);
                 } else if (val == ccm.vertex_shape()[dim] - 1) {
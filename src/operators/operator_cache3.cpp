@@ -0,0 +1,171 @@
+#include "mandoline/operators/operator_cache3.hpp"
+#include "mandoline/operators/boundary3.hpp"
+#include "mandoline/operators/masks.hpp"
+#include "mandoline/operators/volume3.hpp"
+#include <mtao/logging/profiler.hpp>
+#include <tbb/parallel_sort.h>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+
+namespace mandoline::operators {
+
+OperatorCache::OperatorCache(const CutCellMesh<3> &ccm) {
+    auto t = mtao::logging::profiler("operator cache", false, "profiler");
+    m_boundary = operators::boundary(ccm, false);
+    m_cell_volumes = operators::cell_volumes(ccm);
+    m_face_volumes = operators::face_volumes(ccm);
+    m_dual_edge_lengths = operators::dual_edge_lengths(ccm);
+    m_dual_hodge2 = operators::dual_hodge2(m_face_volumes, m_dual_edge_lengths);
+    m_primal_hodge2 = operators::primal_hodge2(m_face_volumes, m_dual_edge_lengths);
+    m_dual_hodge3 = operators::dual_hodge3(m_cell_volumes);
+    m_primal_hodge3 = operators::primal_hodge3(m_cell_volumes);
+    m_face_centroids = ccm.face_centroids();
+    m_cell_centroids = ccm.cell_centroids();
+    m_regions = ccm.regions();
+    m_mesh_face_mask = operators::mesh_face_mask(ccm);
+
+    m_boundary_transpose = m_boundary.transpose();
+    m_boundary_transpose.makeCompressed();
+    m_divergence = m_boundary_transpose;
+    build_laplacian_pattern();
+
+    m_face_weights = m_dual_hodge2;
+    m_cell_weights = mtao::VecXd::Zero(cell_size());
+    update_weighted_operators();
+}
+
+void OperatorCache::build_laplacian_pattern() {
+    // every pair of cells on the boundary of a face gets an entry, regardless of the face's weight.
+    // every cell also gets a diagonal entry, from a face of -1 that contributes nothing if it has no faces
+    Eigen::SparseMatrix<double, Eigen::RowMajor> F = m_boundary;
+    const int face_count = F.rows();
+    const int cell_count = m_boundary.cols();
+    std::vector<int> offsets(face_count + 1, 0);
+    int f;
+#pragma omp parallel for
+    for (f = 0; f < face_count; ++f) {
+        int n = F.outerIndexPtr()[f + 1] - F.outerIndexPtr()[f];
+        offsets[f + 1] = n * n;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    // (col, row, face, coefficient)
+    std::vector<std::tuple<int, int, int, double>> contributions(offsets.back() + cell_count);
+    int c;
+#pragma omp parallel for
+    for (c = 0; c < cell_count; ++c) {
+        contributions[offsets.back() + c] = { c, c, -1, 0. };
+    }
+#pragma omp parallel for
+    for (f = 0; f < face_count; ++f) {
+        int k = offsets[f];
+        const int begin = F.outerIndexPtr()[f];
+        const int end = F.outerIndexPtr()[f + 1];
+        for (int a = begin; a < end; ++a) {
+            for (int b = begin; b < end; ++b) {
+                contributions[k++] = { F.innerIndexPtr()[b], F.innerIndexPtr()[a], f, F.valuePtr()[a] * F.valuePtr()[b] };
+            }
+        }
+    }
+    tbb::parallel_sort(contributions.begin(), contributions.end());
+
+    m_laplacian = SparseMatrix(cell_count, cell_count);
+    m_laplacian.makeCompressed();
+    std::vector<int> inner;
+    m_laplacian_offsets.assign(1, 0);
+    m_laplacian_diagonal.resize(cell_count);
+    m_laplacian_faces.resize(contributions.size());
+    m_laplacian_coefficients.resize(contributions.size());
+    std::vector<int> column_sizes(cell_count, 0);
+    for (size_t k = 0; k < contributions.size(); ++k) {
+        auto &&[col, row, face, coefficient] = contributions[k];
+        if (k > 0 && (col != std::get<0>(contributions[k - 1]) || row != std::get<1>(contributions[k - 1]))) {
+            m_laplacian_offsets.emplace_back(k);
+        }
+        if (m_laplacian_offsets.size() > inner.size()) {
+            if (row == col) {
+                m_laplacian_diagonal[col] = inner.size();
+            }
+            inner.emplace_back(row);
+            column_sizes[col]++;
+        }
+        m_laplacian_faces[k] = face;
+        m_laplacian_coefficients[k] = coefficient;
+    }
+    m_laplacian_offsets.emplace_back(contributions.size());
+
+    int *outer = m_laplacian.outerIndexPtr();
+    outer[0] = 0;
+    for (int j = 0; j < cell_count; ++j) {
+        outer[j + 1] = outer[j] + column_sizes[j];
+    }
+    m_laplacian.resizeNonZeros(inner.size());
+    std::copy(inner.begin(), inner.end(), m_laplacian.innerIndexPtr());
+}
+
+void OperatorCache::set_face_weights(const mtao::VecXd &W) {
+    if (size_t(W.size()) != face_size()) {
+        throw std::invalid_argument("OperatorCache::set_face_weights: expected a weight per face");
+    }
+    m_face_weights = W;
+    update_weighted_operators();
+}
+
+void OperatorCache::set_cell_weights(const mtao::VecXd &C) {
+    if (size_t(C.size()) != cell_size()) {
+        throw std::invalid_argument("OperatorCache::set_cell_weights: expected a weight per cell");
+    }
+    m_cell_weights = C;
+    update_weighted_operators();
+}
+
+void OperatorCache::update_weighted_operators() {
+    const int face_count = m_boundary_transpose.cols();
+    const int *div_outer = m_boundary_transpose.outerIndexPtr();
+    const double *B_values = m_boundary_transpose.valuePtr();
+    double *div_values = m_divergence.valuePtr();
+    int f;
+#pragma omp parallel for
+    for (f = 0; f < face_count; ++f) {
+        for (int k = div_outer[f]; k < div_outer[f + 1]; ++k) {
+            div_values[k] = B_values[k] * m_face_weights(f);
+        }
+    }
+
+    const int nonzeros = m_laplacian.nonZeros();
+    double *values = m_laplacian.valuePtr();
+    int k;
+#pragma omp parallel for
+    for (k = 0; k < nonzeros; ++k) {
+        double v = 0;
+        for (int j = m_laplacian_offsets[k]; j < m_laplacian_offsets[k + 1]; ++j) {
+            const int face = m_laplacian_faces[j];
+            if (face >= 0) {
+                v += m_laplacian_coefficients[j] * m_face_weights(face);
+            }
+        }
+        values[k] = v;
+    }
+    const int cell_count = m_cell_weights.size();
+    int c;
+#pragma omp parallel for
+    for (c = 0; c < cell_count; ++c) {
+        values[m_laplacian_diagonal[c]] += m_cell_weights(c);
+    }
+    m_factorization_current = false;
+}
+
+auto OperatorCache::factorization() -> const Factorization & {
+    if (!m_factorization) {
+        m_factorization = std::make_unique<Factorization>();
+        m_factorization->analyzePattern(m_laplacian);
+    }
+    if (!m_factorization_current) {
+        m_factorization->factorize(m_laplacian);
+        m_factorization_current = true;
+    }
+    return *m_factorization;
+}
+}// namespace mandoline::operators
@@ -0,0 +1,399 @@
+#include "mandoline/operators/poisson3.hpp"
+#include "mandoline/operators/sparse_assembly.hpp"
+#include <Eigen/Dense>
+#include <mtao/logging/profiler.hpp>
+#include <spdlog/spdlog.h>
+#include <tbb/parallel_sort.h>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+
+namespace mandoline::operators {
+
+// A level of the hierarchy. Its operator is the energy
+//   sum_f weight_f (x_a + sign_f x_b)^2 + sum_c cell_weights_c x_c^2
+// of couplings f between two cells a,b, which is what B^T W B is for a boundary operator with +-1 entries
+// (faces with a single cell become cell_weights) and stays closed under the piecewise constant galerkin product
+struct AssembledMultigridPCG::Level {
+    struct Coupling {
+        std::array<int, 2> cells;
+        double weight;
+        double sign;
+    };
+    std::vector<Coupling> couplings;
+    mtao::VecXd cell_weights;
+    // the assembled operator: the couplings of each cell flattened into its neighbors and their weight * sign,
+    // so applying it is a CSR matrix-vector product
+    std::vector<int> stencil_offsets;
+    std::vector<int> stencil_cells;
+    std::vector<double> stencil_weights;
+    mtao::VecXd diagonal;
+    mtao::VecXd inverse_diagonal;
+
+    // used to build the next level
+    std::vector<coord_type> coords;
+    std::vector<int> regions;
+    // cell of the next level each cell belongs to, and the cells that make up each cell of the next level
+    std::vector<int> parents;
+    std::vector<int> child_offsets;
+    std::vector<int> children;
+
+    // direct solve of the coarsest level, if it is small enough.
+    // The neumann regions make the operator singular, pivots below pivot_threshold belong to their constant modes
+    // and are skipped instead of inverting their round-off
+    Eigen::LDLT<Eigen::MatrixXd> ldlt;
+    double pivot_threshold = 0;
+    bool direct = false;
+
+    // work vectors for the V-cycle
+    mtao::VecXd residual;
+    mtao::VecXd coarse_rhs;
+    mtao::VecXd coarse_x;
+
+    int size() const { return cell_weights.size(); }
+
+    // builds the per cell stencils and the diagonal from the couplings
+    void finalize() {
+        const int cell_count = size();
+        stencil_offsets.assign(cell_count + 1, 0);
+        for (auto &&f : couplings) {
+            stencil_offsets[f.cells[0] + 1]++;
+            stencil_offsets[f.cells[1] + 1]++;
+        }
+        std::partial_sum(stencil_offsets.begin(), stencil_offsets.end(), stencil_offsets.begin());
+        stencil_cells.resize(stencil_offsets.back());
+        stencil_weights.resize(stencil_offsets.back());
+        diagonal = cell_weights;
+        std::vector<int> cursor(stencil_offsets.begin(), stencil_offsets.end() - 1);
+        for (auto &&f : couplings) {
+            auto [a, b] = f.cells;
+            stencil_cells[cursor[a]] = b;
+            stencil_weights[cursor[a]++] = f.weight * f.sign;
+            stencil_cells[cursor[b]] = a;
+            stencil_weights[cursor[b]++] = f.weight * f.sign;
+            diagonal(a) += f.weight;
+            diagonal(b) += f.weight;
+        }
+        inverse_diagonal.resize(cell_count);
+        for (int c = 0; c < cell_count; ++c) {
+            // cells without couplings are left alone by the smoother
+            inverse_diagonal(c) = diagonal(c) > 0 ? 1. / diagonal(c) : 0.;
+        }
+    }
+
+    // y = A x, gathered per cell so every entry of y is written by one thread
+    void apply(const mtao::VecXd &x, mtao::VecXd &y) const {
+        const int cell_count = size();
+        y.resize(cell_count);
+        int c;
+#pragma omp parallel for
+        for (c = 0; c < cell_count; ++c) {
+            double v = diagonal(c) * x(c);
+            for (int k = stencil_offsets[c]; k < stencil_offsets[c + 1]; ++k) {
+                v += stencil_weights[k] * x(stencil_cells[k]);
+            }
+            y(c) = v;
+        }
+    }
+
+    // x += w D^{-1} (b - A x)
+    void smooth(const mtao::VecXd &b, mtao::VecXd &x, double w) {
+        apply(x, residual);
+        residual = b - residual;
+        x += w * inverse_diagonal.cwiseProduct(residual);
+    }
+
+    void restrict_to_coarse(const mtao::VecXd &r, mtao::VecXd &rc) const {
+        const int parent_count = child_offsets.size() - 1;
+        rc.resize(parent_count);
+        int p;
+#pragma omp parallel for
+        for (p = 0; p < parent_count; ++p) {
+            double v = 0;
+            for (int k = child_offsets[p]; k < child_offsets[p + 1]; ++k) {
+                v += r(children[k]);
+            }
+            rc(p) = v;
+        }
+    }
+
+    void prolong_add(const mtao::VecXd &xc, mtao::VecXd &x) const {
+        const int cell_count = size();
+        int c;
+#pragma omp parallel for
+        for (c = 0; c < cell_count; ++c) {
+            x(c) += xc(parents[c]);
+        }
+    }
+
+    Eigen::MatrixXd dense() const {
+        Eigen::MatrixXd A = cell_weights.asDiagonal();
+        for (auto &&f : couplings) {
+            auto [a, b] = f.cells;
+            A(a, a) += f.weight;
+            A(b, b) += f.weight;
+            A(a, b) += f.weight * f.sign;
+            A(b, a) += f.weight * f.sign;
+        }
+        return A;
+    }
+
+    // merges the cells of each 2x2x2 block of coords that share a region, returns the next level
+    Level coarsen() {
+        const int cell_count = size();
+        std::vector<std::tuple<coord_type, int, int>> keys(cell_count);
+        int c;
+#pragma omp parallel for
+        for (c = 0; c < cell_count; ++c) {
+            coord_type block = coords[c];
+            for (auto &&v : block) {
+                v >>= 1;
+            }
+            keys[c] = { block, regions[c], c };
+        }
+        tbb::parallel_sort(keys.begin(), keys.end());
+
+        Level next;
+        parents.resize(cell_count);
+        children.resize(cell_count);
+        child_offsets.assign(1, 0);
+        for (int k = 0; k < cell_count; ++k) {
+            auto &&[block, region, cell] = keys[k];
+            if (k == 0 || std::tie(block, region) != std::tie(std::get<0>(keys[k - 1]), std::get<1>(keys[k - 1]))) {
+                if (k > 0) {
+                    child_offsets.emplace_back(k);
+                }
+                next.coords.emplace_back(block);
+                next.regions.emplace_back(region);
+            }
+            parents[cell] = next.coords.size() - 1;
+            children[k] = cell;
+        }
+        child_offsets.emplace_back(cell_count);
+
+        const int parent_count = next.coords.size();
+        next.cell_weights = mtao::VecXd::Zero(parent_count);
+        restrict_to_coarse(cell_weights, next.cell_weights);
+
+        // couplings inside of a coarse cell drop out (or turn into cell weights if both ends have the same sign)
+        std::vector<Coupling> coarse;
+        coarse.reserve(couplings.size());
+        for (auto &&f : couplings) {
+            int a = parents[f.cells[0]];
+            int b = parents[f.cells[1]];
+            if (a == b) {
+                if (f.sign > 0) {
+                    next.cell_weights(a) += 4 * f.weight;
+                }
+            } else {
+                coarse.emplace_back(Coupling{ { { std::min(a, b), std::max(a, b) } }, f.weight, f.sign });
+            }
+        }
+        auto key = [](const Coupling &f) { return std::tie(f.cells, f.sign); };
+        tbb::parallel_sort(coarse.begin(), coarse.end(), [&](const Coupling &a, const Coupling &b) { return key(a) < key(b); });
+        for (auto &&f : coarse) {
+            if (!next.couplings.empty() && key(next.couplings.back()) == key(f)) {
+                next.couplings.back().weight += f.weight;
+            } else {
+                next.couplings.emplace_back(f);
+            }
+        }
+        next.finalize();
+        return next;
+    }
+};
+
+namespace {
+    std::vector<AssembledMultigridPCG::coord_type> cell_coords(const CutCellMesh<3> &ccm) {
+        std::vector<AssembledMultigridPCG::coord_type> ret(ccm.cell_size());
+        for (int i = 0; i < int(ccm.cut_cell_size()); ++i) {
+            ret[ccm.cut_cell_index(i)] = ccm.cut_cell_grid_cell(i);
+        }
+        for (auto &&[idx, c] : ccm.exterior_grid().cells()) {
+            ret[idx] = c.corner();
+        }
+        return ret;
+    }
+    mtao::VecXd face_weights(const CutCellMesh<3> &ccm) {
+        mtao::VecXd W = ccm.mesh_face_mask().cwiseProduct(ccm.dual_hodge2());
+        // faces without a dual edge have an infinite hodge star, they don't couple cells
+        for (int i = 0; i < W.size(); ++i) {
+            if (!std::isfinite(W(i))) {
+                W(i) = 0;
+            }
+        }
+        return W;
+    }
+}// namespace
+
+AssembledMultigridPCG::AssembledMultigridPCG(const CutCellMesh<3> &ccm, const AssembledMultigridPCGOptions &options) : AssembledMultigridPCG(ccm.boundary(), face_weights(ccm), cell_coords(ccm), ccm.regions(), options) {}
+
+AssembledMultigridPCG::AssembledMultigridPCG(const Eigen::SparseMatrix<double> &B, const mtao::VecXd &face_weights, const std::vector<coord_type> &cell_coords, const std::vector<int> &cell_regions, const AssembledMultigridPCGOptions &options) : m_options(options) {
+    auto t = mtao::logging::profiler("multigrid pcg hierarchy", false, "profiler");
+    Level fine;
+    fine.coords = cell_coords;
+    fine.regions = cell_regions;
+    fine.cell_weights = mtao::VecXd::Zero(B.cols());
+
+    Eigen::SparseMatrix<double, Eigen::RowMajor> F = B;
+    for (int f = 0; f < F.outerSize(); ++f) {
+        const double w = face_weights(f);
+        if (w == 0) {
+            continue;
+        }
+        std::array<int, 2> cells;
+        std::array<double, 2> values;
+        int count = 0;
+        for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(F, f); it; ++it) {
+            if (it.value() == 0) {
+                continue;
+            }
+            if (count == 2) {
+                spdlog::error("AssembledMultigridPCG: face {} is on the boundary of more than two cells, ignoring it", f);
+                count = 0;
+                break;
+            }
+            cells[count] = it.col();
+            values[count] = it.value();
+            ++count;
+        }
+        if (count == 1) {
+            fine.cell_weights(cells[0]) += w * values[0] * values[0];
+        } else if (count == 2) {
+            fine.couplings.emplace_back(Level::Coupling{ cells, w * values[0] * values[0], values[1] / values[0] });
+        }
+    }
+    fine.finalize();
+    m_levels.emplace_back(std::move(fine));
+    build_hierarchy();
+}
+
+AssembledMultigridPCG::AssembledMultigridPCG(AssembledMultigridPCG &&) = default;
+AssembledMultigridPCG &AssembledMultigridPCG::operator=(AssembledMultigridPCG &&) = default;
+AssembledMultigridPCG::~AssembledMultigridPCG() = default;
+
+void AssembledMultigridPCG::build_hierarchy() {
+    while (m_levels.size() < m_options.max_levels && m_levels.back().size() > m_options.coarsest_size) {
+        Level next = m_levels.back().coarsen();
+        if (next.size() == m_levels.back().size()) {
+            // nothing left to merge
+            break;
+        }
+        m_levels.emplace_back(std::move(next));
+    }
+    auto &coarsest = m_levels.back();
+    if (coarsest.size() <= m_options.coarsest_size) {
+        coarsest.ldlt.compute(coarsest.dense());
+        const auto &D = coarsest.ldlt.vectorD();
+        coarsest.pivot_threshold = D.cwiseAbs().maxCoeff() * D.size() * std::numeric_limits<double>::epsilon();
+        coarsest.direct = true;
+    } else {
+        spdlog::warn("AssembledMultigridPCG: coarsest level has {} cells, smoothing it instead of solving", coarsest.size());
+    }
+}
+
+int AssembledMultigridPCG::rows() const {
+    return m_levels.front().size();
+}
+int AssembledMultigridPCG::level_count() const {
+    return m_levels.size();
+}
+int AssembledMultigridPCG::level_size(int level) const {
+    return m_levels.at(level).size();
+}
+
+mtao::VecXd AssembledMultigridPCG::apply(const mtao::VecXd &x) const {
+    mtao::VecXd y;
+    m_levels.front().apply(x, y);
+    return y;
+}
+
+Eigen::SparseMatrix<double> AssembledMultigridPCG::matrix() const {
+    auto &&L = m_levels.front();
+    return assemble_sparse(L.size(), L.size(), L.size(), [&](int c, auto &&emit) {
+        if (L.diagonal(c) != 0) {
+            emit(c, c, L.diagonal(c));
+        }
+        for (int k = L.stencil_offsets[c]; k < L.stencil_offsets[c + 1]; ++k) {
+            emit(L.stencil_cells[k], c, L.stencil_weights[k]);
+        }
+    });
+}
+
+void AssembledMultigridPCG::vcycle(int level, const mtao::VecXd &b, mtao::VecXd &x) {
+    auto &L = m_levels[level];
+    const int steps = m_options.smoothing_steps;
+    const double w = m_options.jacobi_weight;
+    if (level + 1 == m_levels.size()) {
+        if (L.direct) {
+            x = L.ldlt.transpositionsP() * b;
+            L.ldlt.matrixL().solveInPlace(x);
+            const auto &D = L.ldlt.vectorD();
+            for (int j = 0; j < x.size(); ++j) {
+                x(j) = std::abs(D(j)) > L.pivot_threshold ? x(j) / D(j) : 0.;
+            }
+            L.ldlt.matrixU().solveInPlace(x);
+            x = L.ldlt.transpositionsP().transpose() * x;
+        } else {
+            x = mtao::VecXd::Zero(L.size());
+            for (int j = 0; j < 4 * steps; ++j) {
+                L.smooth(b, x, w);
+            }
+        }
+        return;
+    }
+    // the first sweep starts from x = 0, so it doesn't need the residual
+    if (steps > 0) {
+        x = w * L.inverse_diagonal.cwiseProduct(b);
+    } else {
+        x = mtao::VecXd::Zero(L.size());
+    }
+    for (int j = 1; j < steps; ++j) {
+        L.smooth(b, x, w);
+    }
+    L.apply(x, L.residual);
+    L.residual = b - L.residual;
+    L.restrict_to_coarse(L.residual, L.coarse_rhs);
+    vcycle(level + 1, L.coarse_rhs, L.coarse_x);
+    L.prolong_add(L.coarse_x, x);
+    for (int j = 0; j < steps; ++j) {
+        L.smooth(b, x, w);
+    }
+}
+
+mtao::VecXd AssembledMultigridPCG::solve(const mtao::VecXd &b) {
+    auto t = mtao::logging::profiler("multigrid pcg solve", false, "profiler");
+    auto &&A = m_levels.front();
+    mtao::VecXd x = mtao::VecXd::Zero(b.size());
+    mtao::VecXd r = b;
+    mtao::VecXd z, p, Ap;
+    const double bnorm = b.norm();
+    m_iterations = 0;
+    m_error = 0;
+    if (bnorm == 0) {
+        return x;
+    }
+
+    vcycle(0, r, z);
+    p = z;
+    double rz = r.dot(z);
+    for (m_iterations = 0; m_iterations < m_options.max_iterations; ++m_iterations) {
+        m_error = r.norm() / bnorm;
+        if (m_error <= m_options.tolerance) {
+            break;
+        }
+        A.apply(p, Ap);
+        const double alpha = rz / p.dot(Ap);
+        x += alpha * p;
+        r -= alpha * Ap;
+        vcycle(0, r, z);
+        const double rz_new = r.dot(z);
+        p = z + (rz_new / rz) * p;
+        rz = rz_new;
+    }
+    m_error = r.norm() / bnorm;
+    return x;
+}
+}// namespace mandoline::operators
@@ -10,7 +10,7 @@ namespace mandoline::operators {
 mtao::VecXd face_volumes(const CutCellMesh<2> &ccm, bool from_triangulation) {
 
     mtao::VecXd FV(ccm.cut_faces().size());
-    auto V = ccm.vertices();
+    auto &&V = ccm.cached_vertices();
     if (from_triangulation) {
         for (auto &&[i, face] : mtao::iterator::enumerate(ccm.cut_faces())) {
             if (face.triangulation) {
@@ -7,14 +7,24 @@ namespace mandoline::operators {
 mtao::VecXd cell_volumes(const CutCellMesh<3> &ccm) {
     mtao::VecXd V(ccm.cells().size());
     V.setZero();
-    auto Vs = ccm.vertices();
-    mtao::VecXd face_brep_vols(ccm.faces().size());
-    for (auto &&[i, f] : mtao::iterator::enumerate(ccm.faces())) {
-        face_brep_vols(i) = f.brep_volume(Vs);
+    auto &&Vs = ccm.cached_vertices();
+    auto &&faces = ccm.faces();
+    mtao::VecXd face_brep_vols(faces.size());
+    int i;
+#pragma omp parallel for
+    for (i = 0; i < faces.size(); ++i) {
+        face_brep_vols(i) = faces[i].brep_volume(Vs);
     }
 
-    for (auto &&[k, c] : mtao::iterator::enumerate(ccm.cells())) {
-        V(k) = c.volume(face_brep_vols);
+    auto &&inc = ccm.cell_face_incidence();
+    int k;
+#pragma omp parallel for
+    for (k = 0; k < inc.cell_size(); ++k) {
+        double vol = 0;
+        for (int j = inc.begin(k); j < inc.end(k); ++j) {
+            vol += (inc.sign(j) ? 1 : -1) * face_brep_vols(inc.face(j));
+        }
+        V(k) = vol;
         //V(k) = c.volume(Vs,faces);
         //V(k) = mtao::geometry::brep_volume(Vs,c.triangulated(faces));
         //std::cout << (V(k) / std::abs(c.volume(Vs,faces))) << std::endl;
@@ -27,8 +37,12 @@ mtao::VecXd face_volumes(const CutCellMesh<3> &ccm, bool from_triangulation) {
 
     mtao::VecXd FV(ccm.faces().size());
     if (from_triangulation) {
-        for (auto &&[i, face] : mtao::iterator::enumerate(ccm.faces())) {
-            auto V = ccm.vertices();
+        auto &&V = ccm.cached_vertices();
+        auto &&faces = ccm.faces();
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < faces.size(); ++i) {
+            auto &face = faces[i];
             if (face.triangulation) {
                 auto &&T = *face.triangulation;
                 FV(i) = mtao::geometry::volumes(V, T).sum();
@@ -42,7 +56,11 @@ mtao::VecXd face_volumes(const CutCellMesh<3> &ccm, bool from_triangulation) {
         if (trimesh_vols.size() > 0) {
             FV = face_barycentric_volume_matrix(ccm) * trimesh_vols;
             auto subVs = ccm.compute_subVs();
-            for (auto &&[i, f] : mtao::iterator::enumerate(ccm.faces())) {
+            auto &&faces = ccm.faces();
+            int i;
+#pragma omp parallel for
+            for (i = 0; i < faces.size(); ++i) {
+                auto &f = faces[i];
                 if (f.is_axial_face()) {
                     auto [dim, coord] = f.as_axial_id();
                     auto &vol = FV(i) = 0;
@@ -74,9 +92,14 @@ mtao::VecXd dual_edge_lengths(const CutCellMesh<3> &ccm) {
 
     auto &dx = ccm.Base::dx();
     auto g = ccm.exterior_grid().cell_ownership_grid();
-    for (auto &&c : ccm.cells()) {
-        auto &gc = c.grid_cell;
-        for (auto &&[fidx, s] : c) {
+    auto &&inc = ccm.cell_face_incidence();
+    // a face with an exterior neighbor belongs to a single cut cell, so every DL entry has one writer
+    int k;
+#pragma omp parallel for
+    for (k = 0; k < inc.cell_size(); ++k) {
+        auto &gc = ccm.cut_cell_grid_cell(k);
+        for (int j = inc.begin(k); j < inc.end(k); ++j) {
+            int fidx = inc.face(j);
             auto &f = ccm.faces()[fidx];
             if (f.external_boundary) {
                 auto [cid, s] = *f.external_boundary;
@@ -91,7 +114,11 @@ mtao::VecXd dual_edge_lengths(const CutCellMesh<3> &ccm) {
             }
         }
     }
-    for (auto &&[fidx, f] : mtao::iterator::enumerate(ccm.faces())) {
+    auto &&faces = ccm.faces();
+    int fidx;
+#pragma omp parallel for
+    for (fidx = 0; fidx < faces.size(); ++fidx) {
+        auto &f = faces[fidx];
         if (f.is_axial_face() && !f.external_boundary) {
             int ba = f.as_axial_axis();
             DL(fidx) = dx(ba);
@@ -102,8 +129,19 @@ mtao::VecXd dual_edge_lengths(const CutCellMesh<3> &ccm) {
     return DL;
 }
 mtao::VecXd dual_hodge2(const CutCellMesh<3> &ccm) {
-    auto PV = face_volumes(ccm);
-    auto DV = dual_edge_lengths(ccm);
+    return dual_hodge2(face_volumes(ccm), dual_edge_lengths(ccm));
+}
+mtao::VecXd primal_hodge2(const CutCellMesh<3> &ccm) {
+    return primal_hodge2(face_volumes(ccm), dual_edge_lengths(ccm));
+}
+mtao::VecXd dual_hodge3(const CutCellMesh<3> &ccm) {
+    return dual_hodge3(cell_volumes(ccm));
+}
+mtao::VecXd primal_hodge3(const CutCellMesh<3> &ccm) {
+    return primal_hodge3(cell_volumes(ccm));
+}
+
+mtao::VecXd dual_hodge2(const mtao::VecXd &PV, const mtao::VecXd &DV) {
     mtao::VecXd CV = (DV.array() > 1e-5).select(PV.cwiseQuotient(DV), 0);
     for (int i = 0; i < CV.size(); ++i) {
         if (!std::isfinite(CV(i))) {
@@ -112,9 +150,7 @@ mtao::VecXd dual_hodge2(const CutCellMesh<3> &ccm) {
     }
     return CV;
 }
-mtao::VecXd primal_hodge2(const CutCellMesh<3> &ccm) {
-    auto PV = face_volumes(ccm);
-    auto DV = dual_edge_lengths(ccm);
+mtao::VecXd primal_hodge2(const mtao::VecXd &PV, const mtao::VecXd &DV) {
     mtao::VecXd CV = (PV.array() > 1e-5).select(DV.cwiseQuotient(PV), 0);
     for (int i = 0; i < CV.size(); ++i) {
         if (!std::isfinite(CV(i))) {
@@ -123,8 +159,8 @@ mtao::VecXd primal_hodge2(const CutCellMesh<3> &ccm) {
     }
     return CV;
 }
-mtao::VecXd dual_hodge3(const CutCellMesh<3> &ccm) {
-    auto CV = cell_volumes(ccm);
+mtao::VecXd dual_hodge3(const mtao::VecXd &cell_volumes) {
+    mtao::VecXd CV = cell_volumes;
     for (int i = 0; i < CV.size(); ++i) {
         if (!std::isfinite(CV(i))) {
             CV(i) = 0;
@@ -132,8 +168,8 @@ mtao::VecXd dual_hodge3(const CutCellMesh<3> &ccm) {
     }
     return CV;
 }
-mtao::VecXd primal_hodge3(const CutCellMesh<3> &ccm) {
-    auto CV = cell_volumes(ccm);
+mtao::VecXd primal_hodge3(const mtao::VecXd &cell_volumes) {
+    mtao::VecXd CV = cell_volumes;
     for (int i = 0; i < CV.size(); ++i) {
         CV(i) = (std::abs(CV(i)) < 1e-5) ? 0 : (1. / CV(i));
         if (!std::isfinite(CV(i))) {
@@ -13,7 +13,7 @@ std::vector<std::tuple<std::vector<int>, bool>> edge_to_plcurves(
   const mtao::ColVecs2d &V,
   const mtao::ColVecs2i &E,
   bool closed_only) {
-    construction::FaceCollapser fc(E);
+    construction::FaceCollapser fc(E, true);
     fc.bake(V, false);// ignore finding faces in faces
     std::vector<std::tuple<std::vector<int>, bool>> ret;
     for (auto &&[fidx, edges] : fc.face_edges()) {
@@ -429,3 +429,53 @@ TEST_CASE("Cubes", "[cell_collapser]") {
 
 }
 
+
+TEST_CASE("ParallelMerge", "[cell_collapser]") {
+    // a stack of N unit cubes, the parallel merge has to produce exactly the serial cells
+    int N = 6;
+    mtao::ColVecs3d V(3,4*N+4);
+    std::map<int,CutFace<3>> faces;
+    int face_count = 0;
+    for(int i = 0; i <= N; ++i) {
+        V.col(4*i+0) = mtao::Vec3d(0,0,i);
+        V.col(4*i+1) = mtao::Vec3d(1,0,i);
+        V.col(4*i+2) = mtao::Vec3d(1,1,i);
+        V.col(4*i+3) = mtao::Vec3d(0,1,i);
+        faces[face_count++] = CutFace<3>(
+                coord_mask<3>(2,i),
+                {4*i,4*i+1,4*i+2,4*i+3},
+                std::array<int,2>{{2,i}},
+                mtao::Vec3d::UnitZ());
+    }
+    for(int i = 0; i < N; ++i) {
+        faces[face_count++] = CutFace<3>(
+                coord_mask<3>(1,0),
+                {4*i+1,4*i+0,4*(i+1)+0,4*(i+1)+1},
+                std::array<int,2>{{1,0}},
+                mtao::Vec3d::UnitY());
+        faces[face_count++] = CutFace<3>(
+                coord_mask<3>(1,1),
+                {4*i+2,4*i+3,4*(i+1)+3,4*(i+1)+2},
+                std::array<int,2>{{1,1}},
+                mtao::Vec3d::UnitY());
+        faces[face_count++] = CutFace<3>(
+                coord_mask<3>(0,0),
+                {4*i+0,4*i+3,4*(i+1)+3,4*(i+1)+0},
+                std::array<int,2>{{0,0}},
+                mtao::Vec3d::UnitX());
+        faces[face_count++] = CutFace<3>(
+                coord_mask<3>(0,1),
+                {4*i+1,4*i+2,4*(i+1)+2,4*(i+1)+1},
+                std::array<int,2>{{0,1}},
+                mtao::Vec3d::UnitX());
+    }
+
+    CellCollapser serial(faces);
+    serial.merge(V, true, false);
+    CellCollapser parallel(faces);
+    parallel.merge(V, true, true);
+
+    REQUIRE(serial.cell_faces().size() == N+1);
+    CHECK(serial.cell_boundaries() == parallel.cell_boundaries());
+    CHECK(serial.m_halfface_to_cell == parallel.m_halfface_to_cell);
+}
@@ -0,0 +1,71 @@
+#include <mtao/types.hpp>
+#include <mtao/geometry/bounding_box.hpp>
+#include <mtao/geometry/mesh/sphere.hpp>
+#include <mtao/logging/logger.hpp>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mandoline/construction/construct.hpp>
+#include <mandoline/mesh3.hpp>
+
+// Compares the per-frame cost of DeformingGeometryConstructor with and without
+// incremental rebakes. Every frame a small cap of a sphere is pushed in and out,
+// so only a few triangles move between frames. Only the intersection stage is
+// incremental, so the difference is bounded by how much of a bake that stage takes.
+using namespace mandoline::construction;
+using namespace mtao::logging;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: <scriptname> <grid edge> [frames=10] [sphere subdivisions=5]" << std::endl;
+        return 1;
+    }
+    active_loggers["default"].set_level(Level::Error);
+
+    int N = std::atoi(argv[1]);
+    int frames = argc > 2 ? std::atoi(argv[2]) : 10;
+    int subdivisions = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    mtao::ColVecs3d V;
+    mtao::ColVecs3i F;
+    std::tie(V, F) = mtao::geometry::mesh::sphere<double>(subdivisions);
+    auto bbox = mtao::geometry::bounding_box(V);
+    mtao::Vec3d C = (bbox.min() + bbox.max()) / 2;
+    mtao::Vec3d s = bbox.sizes() / 2;
+    bbox.min() = C - 1.2 * s;
+    bbox.max() = C + 1.2 * s;
+    auto grid = mandoline::CutCellMesh<3>::StaggeredGrid::from_bbox(bbox, std::array<int, 3>{ { N, N, N } }, false);
+
+    auto frame_vertices = [&](int frame) -> mtao::ColVecs3d {
+        mtao::ColVecs3d R = V;
+        double scale = 1 + .05 * std::sin(frame);
+        for (int i = 0; i < R.cols(); ++i) {
+            if (R(0, i) > .9) {
+                R.col(i) *= scale;
+            }
+        }
+        return R;
+    };
+
+    auto run = [&](bool incremental) {
+        DeformingGeometryConstructor dgc(V, F, grid);
+        dgc.set_incremental_intersections(incremental);
+        double total = 0;
+        for (int frame = 1; frame <= frames; ++frame) {
+            dgc.update_vertices(frame_vertices(frame));
+            auto start = std::chrono::steady_clock::now();
+            dgc.bake();
+            auto end = std::chrono::steady_clock::now();
+            total += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+        auto ccm = dgc.emit();
+        std::cout << (incremental ? "incremental intersections" : "full rebuild") << ": "
+                  << total / frames << "ms/frame, "
+                  << ccm.faces().size() << " faces, "
+                  << ccm.cells().size() << " cells" << std::endl;
+    };
+    run(false);
+    run(true);
+
+    return 0;
+}
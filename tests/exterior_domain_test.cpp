@@ -1,7 +1,9 @@
 #include <iostream>
 #include <mandoline/exterior_grid.hpp>
+#include <mandoline/construction/adaptive_grid_factory.hpp>
 #include <catch2/catch.hpp>
 #include <iterator>
+#include <set>
 
 template<int D>
 auto print_eg_dual_edges(const mandoline::ExteriorGrid<D> &eg) {
@@ -98,3 +100,209 @@ TEST_CASE("2D single ", "[exterior_grid]") {
         REQUIRE(bt.size() == 2);
     }
 }
+
+TEST_CASE("Adaptive grid cell lookup", "[adaptive_grid]") {
+    using AG = mandoline::AdaptiveGrid;
+    using GridData3 = AdaptiveGridFactory::GridData3;
+
+    int N = 8;
+    GridData3 mask = GridData3::Constant(true, N, N, N);
+    // carve out a corner so the grid has cells of several widths and uncovered grid cells
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            for (int k = 0; k < 3; ++k) {
+                mask(i, j, k) = false;
+            }
+        }
+    }
+    AdaptiveGridFactory agf(mask);
+    agf.make_cells(2);
+    AG ag = agf.create();
+
+    mtao::ColVecs3d P = N * (mtao::ColVecs3d::Random(3, 500).array() + 1) / 2;
+    P.col(0).setConstant(N);
+    P.col(1).setConstant(0);
+    P.col(2) << -.5, 1, 1;
+    P.col(3) << 1, 1, N + .5;
+
+    auto linear = [&](const mtao::Vec3d &p) -> int {
+        if (p.minCoeff() < 0 || p.maxCoeff() > N) {
+            return -2;
+        }
+        for (auto &&[i, c] : ag.cells()) {
+            if (c.is_inside(p)) {
+                return i;
+            }
+        }
+        return -1;
+    };
+    mtao::VecXi R = ag.get_cell_indices(P);
+    for (int i = 0; i < P.cols(); ++i) {
+        REQUIRE(ag.get_cell_index(P.col(i)) == linear(P.col(i)));
+        REQUIRE(R(i) == linear(P.col(i)));
+    }
+}
+
+TEST_CASE("Adaptive grid faces", "[adaptive_grid]") {
+    using AG = mandoline::AdaptiveGrid;
+    using GridData3 = AdaptiveGridFactory::GridData3;
+
+    int N = 16;
+    GridData3 mask = GridData3::Constant(true, N, N, N);
+    // a hole in the middle and a missing corner leave interior boundaries of several sizes
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            for (int k = 0; k < N; ++k) {
+                if ((std::abs(2 * i - N) < 5 && std::abs(2 * j - N) < 7 && std::abs(2 * k - N) < 3) || (i < 3 && j < 5 && k < 2)) {
+                    mask(i, j, k) = false;
+                }
+            }
+        }
+    }
+    AdaptiveGridFactory agf(mask);
+    agf.make_cells(3);
+    AG ag = agf.create();
+    auto &&grid = ag.ownership_grid();
+    auto shape = ag.cell_shape();
+
+    // every staggered face with an adaptive cell on at least one side, -2 on the domain boundary
+    std::set<std::tuple<int, AG::Edge>> expected;
+    for (int d = 0; d < 3; ++d) {
+        for (int i = 0; i < shape[0]; ++i) {
+            for (int j = 0; j < shape[1]; ++j) {
+                for (int k = 0; k < shape[2]; ++k) {
+                    AG::coord_type c{ { i, j, k } };
+                    int a = grid(c);
+                    if (a < 0) continue;
+                    if (c[d] == 0) {
+                        expected.emplace(d, AG::Edge{ { -2, a } });
+                    }
+                    if (c[d] == shape[d] - 1) {
+                        expected.emplace(d, AG::Edge{ { a, -2 } });
+                    } else {
+                        c[d]++;
+                        int b = grid(c);
+                        if (b >= 0 && b != a) {
+                            expected.emplace(d, AG::Edge{ { a, b } });
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto &&faces = ag.faces();
+    REQUIRE(faces.size() == expected.size());
+    auto it = expected.begin();
+    for (auto &&f : faces) {
+        // the faces come out in (axis, dual edge) order
+        REQUIRE(std::make_tuple(f.axis(), f.dual_edge) == *it++);
+        auto [a, b] = f.dual_edge;
+        if (a >= 0 && b >= 0) {
+            REQUIRE(f.width() == std::min(ag.cell(a).width(), ag.cell(b).width()));
+        } else {
+            REQUIRE(f.width() == ag.cell(std::max(a, b)).width());
+        }
+    }
+    auto again = ag.faces(grid);
+    REQUIRE(again.size() == faces.size());
+    for (size_t i = 0; i < faces.size(); ++i) {
+        REQUIRE(again[i].dual_edge == faces[i].dual_edge);
+        REQUIRE(again[i].corner() == faces[i].corner());
+    }
+}
+
+namespace {
+// the grid cells crossed by a sphere of radius .3 * N centered in an N^3 grid
+AdaptiveGridFactory::GridData3 sphere_shell_mask(int N) {
+    using GridData3 = AdaptiveGridFactory::GridData3;
+    GridData3 mask = GridData3::Constant(true, N, N, N);
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            for (int k = 0; k < N; ++k) {
+                mtao::Vec3d p(i + .5, j + .5, k + .5);
+                if (std::abs((p.array() - N / 2.).matrix().norm() - .3 * N) < 1) {
+                    mask(i, j, k) = false;
+                }
+            }
+        }
+    }
+    return mask;
+}
+}// namespace
+
+TEST_CASE("Adaptive grid branching and balancing", "[adaptive_grid]") {
+    using AG = mandoline::AdaptiveGrid;
+
+    for (int N : { 16, 27 }) {
+        auto mask = sphere_shell_mask(N);
+        for (int branching_factor : { 2, 3, 4 }) {
+            for (bool balanced : { false, true }) {
+                AdaptiveGridFactory agf(mask, branching_factor, balanced);
+                agf.make_cells(3);
+                AG ag = agf.create();
+                auto &&grid = ag.ownership_grid();
+
+                // the cubes tile exactly the free grid cells
+                for (int i = 0; i < N; ++i) {
+                    for (int j = 0; j < N; ++j) {
+                        for (int k = 0; k < N; ++k) {
+                            REQUIRE((grid(i, j, k) >= 0) == mask(i, j, k));
+                        }
+                    }
+                }
+                int max_level = 0;
+                for (auto &&[cid, c] : ag.cells()) {
+                    int level = agf.cell_level(c.width());
+                    max_level = std::max(max_level, level);
+                    int width = 1;
+                    for (int l = 0; l < level; ++l) {
+                        width *= branching_factor;
+                    }
+                    REQUIRE(c.width() == width);
+                    for (int d = 0; d < 3; ++d) {
+                        REQUIRE(c.corner()[d] % width == 0);
+                    }
+                }
+                REQUIRE(max_level > 0);
+                if (balanced) {
+                    // cut-cells count as level 0
+                    auto level = [&](const AG::coord_type &c) {
+                        int id = grid(c);
+                        return id >= 0 ? agf.cell_level(ag.cell(id).width()) : 0;
+                    };
+                    for (int d = 0; d < 3; ++d) {
+                        for (int i = 0; i < N; ++i) {
+                            for (int j = 0; j < N; ++j) {
+                                for (int k = 0; k < N; ++k) {
+                                    AG::coord_type a{ { i, j, k } };
+                                    AG::coord_type b = a;
+                                    if (++b[d] == N) continue;
+                                    REQUIRE(std::abs(level(a) - level(b)) <= 1);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Adaptive grid level report", "[.][adaptive_grid][benchmark]") {
+    for (int N : { 64, 128 }) {
+        auto mask = sphere_shell_mask(N);
+        std::cout << "sphere shell in a " << N << "^3 grid" << std::endl;
+        for (int branching_factor : { 2, 4 }) {
+            for (bool balanced : { false, true }) {
+                for (int level = 0; level <= 6; ++level) {
+                    AdaptiveGridFactory agf(mask, branching_factor, balanced);
+                    agf.make_cells(level);
+                    auto ag = agf.create();
+                    std::cout << "  branching " << branching_factor << (balanced ? " balanced" : " unbalanced") << " level " << level << ": "
+                              << ag.num_cells() << " cells, " << ag.num_faces() << " faces" << std::endl;
+                }
+            }
+        }
+    }
+}
@@ -1,12 +1,54 @@
 #include <iostream>
 #include <mandoline/construction/face_collapser.hpp>
+#include <mandoline/construction/scratch_arena.hpp>
 #include <catch2/catch.hpp>
 #include <iterator>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
 #include <mandoline/tools/edges_to_plcurves.hpp>
 
 using E = std::array<int, 2>;
 using namespace mandoline::construction;
 
+namespace {
+// counts the allocations the flat containers make through it
+class CountingResource : public std::pmr::memory_resource {
+  public:
+    size_t allocations = 0;
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override { return this == &o; }
+};
+// the benchmark counts every heap allocation while it times a collapse, so the tree mode's nodes show up too
+std::atomic<bool> counting_allocations{ false };
+std::atomic<size_t> heap_allocations{ 0 };
+}// namespace
+void *operator new(std::size_t size) {
+    if (counting_allocations) {
+        heap_allocations++;
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
 TEST_CASE("Polygon", "[face_collapser]") {
     for (int N = 3; N < 50; ++N) {
         std::stringstream ss;
@@ -398,3 +440,107 @@ TEST_CASE("EdgeToPLCurve", "[face_collapser]") {
         }
     }
 }
+
+namespace {
+// an N x N grid of unit squares with one diagonal per square, the kind of planar graph the facet
+// intersections hand to the collapser
+std::tuple<mtao::ColVecs2d, std::set<E>> triangulated_grid(int N) {
+    mtao::ColVecs2d V(2, (N + 1) * (N + 1));
+    auto vidx = [&](int i, int j) { return i * (N + 1) + j; };
+    for (int i = 0; i <= N; ++i) {
+        for (int j = 0; j <= N; ++j) {
+            V.col(vidx(i, j)) << i + .1 * std::sin(j), j + .1 * std::cos(i);
+        }
+    }
+    std::set<E> edges;
+    for (int i = 0; i <= N; ++i) {
+        for (int j = 0; j <= N; ++j) {
+            if (i < N) edges.emplace(E{ { vidx(i, j), vidx(i + 1, j) } });
+            if (j < N) edges.emplace(E{ { vidx(i, j), vidx(i, j + 1) } });
+            if (i < N && j < N) edges.emplace(E{ { vidx(i, j), vidx(i + 1, j + 1) } });
+        }
+    }
+    return { V, edges };
+}
+}// namespace
+
+TEST_CASE("Flat containers", "[face_collapser]") {
+    for (int N = 1; N < 6; ++N) {
+        auto [V, edges] = triangulated_grid(N);
+        for (bool nonsimple : { false, true }) {
+            FaceCollapser tree(edges);
+            FaceCollapser flat(edges, true);
+            REQUIRE(flat.flat());
+            tree.set_edge_for_removal(E{ { N + 1, 0 } });
+            flat.set_edge_for_removal(E{ { N + 1, 0 } });
+            tree.bake(V, nonsimple);
+            flat.bake(V, nonsimple);
+            CHECK(tree.faces() == flat.faces());
+            CHECK(tree.faces_no_holes() == flat.faces_no_holes());
+            CHECK(tree.face_edges() == flat.face_edges());
+            CHECK(tree.edge_to_face() == flat.edge_to_face());
+            CHECK(tree.collect_edges() == flat.collect_edges());
+            REQUIRE(flat.faces_no_holes().size() == 2 * N * N);
+
+            ScratchArena::Scope scratch;
+            FaceCollapser scratch_flat(edges, true, scratch.resource());
+            scratch_flat.set_edge_for_removal(E{ { N + 1, 0 } });
+            scratch_flat.bake(V, nonsimple);
+            CHECK(tree.faces() == scratch_flat.faces());
+
+            // the flat containers take all of their memory from the resource they are given
+            CountingResource counter;
+            FaceCollapser counted_flat(edges, true, &counter);
+            counted_flat.set_edge_for_removal(E{ { N + 1, 0 } });
+            counted_flat.bake(V, nonsimple);
+            CHECK(tree.faces() == counted_flat.faces());
+            CHECK(counter.allocations > 0);
+        }
+    }
+    // a hole has to be merged into its outer loop in both modes
+    {
+        mtao::ColVecs2d V(2, 8);
+        V << 0, 3, 3, 0, 1, 2, 2, 1,
+            0, 0, 3, 3, 1, 1, 2, 2;
+        std::set<E> edges;
+        for (int j = 0; j < 4; ++j) {
+            edges.emplace(E{ { j, (j + 1) % 4 } });
+            edges.emplace(E{ { 4 + j, 4 + (j + 1) % 4 } });
+        }
+        FaceCollapser tree(edges);
+        FaceCollapser flat(edges, true);
+        tree.set_edge_for_removal(E{ { 1, 0 } });
+        flat.set_edge_for_removal(E{ { 1, 0 } });
+        tree.bake(V);
+        flat.bake(V);
+        CHECK(tree.faces() == flat.faces());
+    }
+}
+
+TEST_CASE("Flat containers benchmark", "[.][face_collapser][benchmark]") {
+    for (int N : { 4, 16, 64 }) {
+        auto [V, edges] = triangulated_grid(N);
+        const int repeats = std::max(1, 4096 / (N * N));
+        for (bool flat : { false, true }) {
+            // only the flat containers allocate through the resource, every allocation goes through operator new
+            CountingResource counter;
+            heap_allocations = 0;
+            counting_allocations = true;
+            auto start = std::chrono::steady_clock::now();
+            size_t face_count = 0;
+            for (int r = 0; r < repeats; ++r) {
+                FaceCollapser fc(edges, flat, &counter);
+                fc.bake(V, false);
+                face_count += fc.faces_no_holes().size();
+            }
+            auto end = std::chrono::steady_clock::now();
+            counting_allocations = false;
+            double ms = std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+            double allocs = double(heap_allocations) / repeats;
+            double resource_allocs = double(counter.allocations) / repeats;
+            std::cout << (flat ? "flat" : "tree") << " grid " << N << "x" << N << " (" << edges.size() << " edges, "
+                      << face_count / repeats << " faces): " << ms << "ms, " << allocs << " heap allocations per collapse ("
+                      << resource_allocs << " through the collapser's resource)" << std::endl;
+        }
+    }
+}
@@ -4,6 +4,10 @@
 #include <mandoline/construction/cutdata.hpp>
 #include <mtao/geometry/mesh/face_normals.hpp>
 #include <mandoline/construction/generator3.hpp>
+#include <mandoline/construction/plane_crossing_kernel.hpp>
+#include <cstring>
+#include <random>
+#include <set>
 
 using namespace mtao::geometry::trigonometry;
 
@@ -60,3 +64,183 @@ TEST_CASE("Cutdata Orientation", "[cutdata]") {
         }
     }
 }
+
+TEST_CASE("Plane crossing kernel", "[cutdata]") {
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> q(0, 1);
+    std::uniform_real_distribution<double> dirs(0, 20);
+    std::uniform_int_distribution<int> counts(0, 23);
+
+    std::vector<double> scalar_t(32), simd_t(32);
+    std::vector<int> scalar_s(32), simd_s(32);
+    for (int j = 0; j < 2000; ++j) {
+        double offset = j % 7 == 0 ? 0 : q(gen);
+        double dir = j % 11 == 0 ? 0 : dirs(gen);
+        int count = counts(gen);
+        int a = plane_crossing_parameters_scalar(offset, dir, count, scalar_t.data(), scalar_s.data());
+        int b = plane_crossing_parameters(offset, dir, count, simd_t.data(), simd_s.data());
+        REQUIRE(a == b);
+        REQUIRE(std::memcmp(scalar_t.data(), simd_t.data(), a * sizeof(double)) == 0);
+        REQUIRE(std::equal(scalar_s.begin(), scalar_s.begin() + a, simd_s.begin()));
+    }
+
+    // baking edges through the batched kernel must match the scalar kernel exactly
+    mtao::vector<Vertex<3>> V;
+    std::uniform_real_distribution<double> p(-3, 3);
+    for (int j = 0; j < 200; ++j) {
+        V.emplace_back(Vertex<3>::from_vertex(mtao::Vec3d(p(gen), p(gen), p(gen))));
+    }
+    mtao::ColVecs2i E(2, V.size() / 2);
+    for (int j = 0; j < E.cols(); ++j) {
+        E.col(j) << 2 * j, 2 * j + 1;
+    }
+    std::vector<EdgeIntersections<3>> batched, scalar;
+    std::vector<PlaneSweep<3>> sweeps;
+    for (int j = 0; j < E.cols(); ++j) {
+        batched.emplace_back(V, E, j);
+        sweeps.emplace_back(batched.back().plane_sweep());
+    }
+    PlaneCrossings crossings = plane_crossings(sweeps);
+    for (int j = 0; j < E.cols(); ++j) {
+        batched[j].bake({}, sweeps[j], crossings, j);
+    }
+    // a block of the sweeps gets the same crossings as it does in the whole batch
+    {
+        const int first = 17;
+        PlaneCrossings block = plane_crossings(sweeps.data() + first, sweeps.data() + sweeps.size());
+        REQUIRE(block.edge_count() == crossings.edge_count() - first);
+        for (int j = 0; j < block.edge_count(); ++j) {
+            REQUIRE(block.size(j) == crossings.size(j + first));
+            for (int k = 0; k < block.size(j); ++k) {
+                REQUIRE(block.ts[block.offsets[j] + k] == crossings.ts[crossings.offsets[j + first] + k]);
+                REQUIRE(block.axes[block.offsets[j] + k] == crossings.axes[crossings.offsets[j + first] + k]);
+                REQUIRE(block.steps[block.offsets[j] + k] == crossings.steps[crossings.offsets[j + first] + k]);
+            }
+        }
+    }
+    bool simd = plane_crossing_simd_enabled();
+    set_plane_crossing_simd(false);
+    for (int j = 0; j < E.cols(); ++j) {
+        scalar.emplace_back(V, E, j);
+        scalar.back().bake();
+    }
+    set_plane_crossing_simd(simd);
+    for (int j = 0; j < E.cols(); ++j) {
+        auto &&a = batched[j].intersections;
+        auto &&b = scalar[j].intersections;
+        REQUIRE(a.size() == b.size());
+        for (size_t k = 0; k < a.size(); ++k) {
+            REQUIRE(a[k].coord == b[k].coord);
+            REQUIRE(std::memcmp(&a[k].edge_coord, &b[k].edge_coord, sizeof(double)) == 0);
+            REQUIRE(a[k].quot == b[k].quot);
+        }
+    }
+}
+
+TEST_CASE("Cell bitmask", "[cutdata]") {
+    using Coord = std::array<int, 3>;
+    mandoline::construction::CellBitmask<3> mask(Coord{ { 5, 7, 11 } });
+    REQUIRE(mask.count() == 0);
+
+    std::mt19937 gen(4);
+    std::set<Coord> cells;
+    for (int j = 0; j < 200; ++j) {
+        Coord c{ { int(gen() % 5), int(gen() % 7), int(gen() % 11) } };
+        cells.insert(c);
+    }
+    std::vector<Coord> coords(cells.begin(), cells.end());
+    int j;
+#pragma omp parallel for
+    for (j = 0; j < coords.size(); ++j) {
+        mask.set_atomic(coords[j]);
+    }
+    REQUIRE(mask.count() == cells.size());
+    REQUIRE(!mask.valid_index(Coord{ { -1, 0, 0 } }));
+    REQUIRE(!mask.valid_index(Coord{ { 0, 7, 0 } }));
+    for (auto &&c : cells) {
+        REQUIRE(mask(c));
+        REQUIRE(mask.unindex(mask.index(c)) == c);
+    }
+
+    // set bits are visited in the order of a std::set of coords
+    std::vector<Coord> visited;
+    mask.for_each([&](const Coord &c) { visited.emplace_back(c); });
+    REQUIRE(visited == coords);
+}
+
+TEST_CASE("Grid line crossings", "[cutdata]") {
+    using Coord = std::array<int, 3>;
+    using namespace mandoline::construction;
+    // rows: two crossings on the same x line (given out of order, plus a repeated position),
+    // one crossing on a z line, and a triangle crossing that isn't on any line
+    CrossingTable<3> table;
+    table.resize(5);
+    table.coords.setZero();
+    table.quots.setZero();
+    table.coords.col(0) << 1, 2, 3;
+    table.quots(0, 0) = .75;
+    table.coords.col(1) << 1, 2, 3;
+    table.quots(0, 1) = .25;
+    table.coords.col(2) << 1, 2, 3;
+    table.quots(0, 2) = .25;
+    table.coords.col(3) << 0, 0, 0;
+    table.quots(2, 3) = .5;
+    table.quots.col(4) << .5, .5, 0;
+    table.clamped_bits = { 0b110, 0b110, 0b110, 0b011, 0b100 };
+    table.indices = { 10, 11, 12, 13, 14 };
+
+    std::array<CellBitmask<3>, 3> extra;
+    for (auto &&e : extra) {
+        e = CellBitmask<3>(Coord{ { 4, 4, 4 } });
+    }
+    extra[0].set(Coord{ { 0, 0, 0 } });
+    extra[0].set(Coord{ { 1, 2, 3 } });
+
+    GridLineCrossings<3> lines(table, extra);
+    REQUIRE(lines.axis(0).lines == std::vector<Coord>{ Coord{ { 0, 0, 0 } }, Coord{ { 1, 2, 3 } } });
+    REQUIRE(lines.axis(0).offsets == std::vector<int>{ 0, 0, 3 });
+    REQUIRE(lines.axis(1).line_count() == 0);
+    REQUIRE(lines.axis(2).line_count() == 1);
+
+    std::vector<std::array<int, 2>> segments;
+    auto add = [&](int a, int b) { segments.emplace_back(std::array<int, 2>{ { a, b } }); };
+    lines.for_each_segment(0, 0, 0, 1, add);
+    REQUIRE(segments == std::vector<std::array<int, 2>>{ { { 0, 1 } } });
+    segments.clear();
+    lines.for_each_segment(0, 1, 0, 1, add);
+    REQUIRE(segments == std::vector<std::array<int, 2>>{ { { 0, 11 } }, { { 11, 10 } }, { { 10, 1 } } });
+}
+
+TEST_CASE("Triangle interior edge crossings", "[cutdata]") {
+    // triangles spanning several cells are cut along interior edges, whose plane crossings are batched per triangle
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> p(.1, 4.9);
+    mtao::vector<Vertex<3>> V;
+    for (int j = 0; j < 60; ++j) {
+        V.emplace_back(Vertex<3>::from_vertex(mtao::Vec3d(p(gen), p(gen), p(gen))));
+    }
+    mtao::ColVecs3i F(3, V.size() / 3);
+    for (int j = 0; j < F.cols(); ++j) {
+        F.col(j) << 3 * j, 3 * j + 1, 3 * j + 2;
+    }
+    CutData<3> data(CutData<3>::Indexer(std::array<int, 3>{ { 6, 6, 6 } }), V, F);
+    data.bake({}, false);
+
+    size_t interior_edge_count = 0;
+    for (auto &&tisect : data.triangle_intersections()) {
+        for (auto &&[vptr_edge, eis] : tisect.edge_intersections) {
+            interior_edge_count++;
+            EdgeIntersections<3> single(vptr_edge);
+            single.bake();
+            auto &&a = eis.intersections;
+            auto &&b = single.intersections;
+            REQUIRE(a.size() == b.size());
+            for (size_t k = 0; k < a.size(); ++k) {
+                REQUIRE(a[k].coord == b[k].coord);
+                REQUIRE(std::memcmp(&a[k].edge_coord, &b[k].edge_coord, sizeof(double)) == 0);
+                REQUIRE(a[k].quot == b[k].quot);
+            }
+        }
+    }
+    REQUIRE(interior_edge_count > 0);
+}
@@ -17,6 +17,9 @@
 #include <mtao/geometry/prune_vertices.hpp>
 #include "../tools/make_cutmesh_generator_from_cmdline.hpp"
 #include "../tools/make_cutmesh_from_cmdline.hpp"
+#include <mandoline/construction/scratch_arena.hpp>
+#include <chrono>
+#include <fstream>
 using namespace mtao::logging;
 
 
@@ -31,9 +34,11 @@ int main(int argc, char * argv[]) {
     auto&& log_remesh = make_file_logger("remesh_profiler","remesh_profiler.log",mtao::logging::Level::Fatal,true);
     auto clp = make_cutmesh_clparser();
     clp.add_option("output-cutmesh",false);
+    clp.add_option("plane-timings",false);
     if(clp.parse(argc,argv)) {
         std::set<int> NIs;
         bool output_file = clp.optT<bool>("output-cutmesh");
+        bool plane_timings = clp.optT<bool>("plane-timings");
         std::optional<std::string> output_prefix;
         int size_offset = 1;
         if(output_file) {
@@ -53,12 +58,30 @@ int main(int argc, char * argv[]) {
 
 
 
-        auto run =[&](int M) {
+        auto run =[&](int M, bool use_scratch_arena) {
             clp.set_option("N",M);
 
+            mandoline::construction::ScratchArena::set_enabled(use_scratch_arena);
+            mandoline::construction::ScratchArena::reset_statistics();
             mtao::logging::profiler::log_all();
+            auto start = std::chrono::steady_clock::now();
             auto ccg = make_generator(V,F,clp);
             auto ccm = make_cutmesh(ccg,clp);
+            auto end = std::chrono::steady_clock::now();
+            {
+                auto stats = mandoline::construction::ScratchArena::statistics();
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+                std::cout << obj_filename << " N=" << M << " scratch arena " << (use_scratch_arena ? "on " : "off")
+                    << ": " << ms << "ms, "
+                    << stats.allocations << " scratch allocations, "
+                    << stats.heap_allocations << " of them on the heap ("
+                    << stats.heap_bytes << " bytes)" << std::endl;
+            }
+            if(plane_timings) {
+                // one row per axial plane: which thread ran it, when, and for how long
+                std::ofstream ofs("plane_timings_" + std::to_string(M) + (use_scratch_arena ? "_arena" : "") + ".csv");
+                ccg.dump_plane_timings(ofs);
+            }
             auto&& dur = mtao::logging::profiler::durations();
             for(auto&& [pr,times]: dur) {
                 auto&& [name,level] = pr;
@@ -106,7 +129,9 @@ int main(int argc, char * argv[]) {
             }
         };
         for(auto&& ni: NIs) {
-            run(ni);
+            // construct each size with per-plane scratch on the heap and then in the arena
+            run(ni, false);
+            run(ni, true);
         }
 
     }
@@ -27,6 +27,27 @@
 #include <catch2/catch.hpp>
 #include <mandoline/construction/generator3.hpp>
 #include <mandoline/construction/preprocess_mesh.hpp>
+#include <mandoline/construction/construct.hpp>
+#include <mandoline/construction/cell_collapser.hpp>
+#include <mandoline/construction/scratch_arena.hpp>
+#include <mandoline/cutcell_locator.hpp>
+#include <mandoline/flat_cutmesh.hpp>
+#include <mtao/iterator/zip.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <set>
+#include <tuple>
+#include <optional>
+#include <mtao/iterator/enumerate.hpp>
+#include <mandoline/operators/boundary3.hpp>
+#include <mandoline/operators/poisson3.hpp>
+#include <mandoline/operators/operator_cache3.hpp>
+#include <mandoline/operators/diffgeo3.hpp>
+#include <mandoline/operators/volume3.hpp>
+#include <Eigen/IterativeLinearSolvers>
 using namespace mtao::logging;
 
 
@@ -68,6 +89,124 @@ void print_grid(const GridB &g) {
 }
 
 
+namespace {
+// the unit sphere on a grid over its bounding box padded by .2, most of the tests below cut this
+struct SphereGrid {
+    mtao::ColVecs3d V;
+    mtao::ColVecs3i F;
+    mandoline::CutCellMesh<3>::StaggeredGrid grid;
+};
+SphereGrid sphere_grid(int subdivisions, const std::array<int, 3> &cell_shape) {
+    auto [V, F] = mtao::geometry::mesh::sphere<double>(subdivisions);
+    auto bbox = mtao::geometry::bounding_box(V);
+    bbox.min().array() -= .2;
+    bbox.max().array() += .2;
+    auto grid = mandoline::CutCellMesh<3>::StaggeredGrid::from_bbox(bbox, cell_shape, false);
+    return { V, F, grid };
+}
+mandoline::CutCellMesh<3> sphere_cutmesh(int subdivisions, const std::array<int, 3> &cell_shape) {
+    auto [V, F, grid] = sphere_grid(subdivisions, cell_shape);
+    return from_grid(V, F, grid);
+}
+
+// wall time of f() in milliseconds, for the benchmarks
+template<typename Func>
+double time_ms(Func &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void require_same_mesh(const mandoline::CutCellMesh<3> &a, const mandoline::CutCellMesh<3> &b) {
+    REQUIRE(a.vertex_shape() == b.vertex_shape());
+    REQUIRE(a.vertices() == b.vertices());
+    REQUIRE(a.origV() == b.origV());
+    REQUIRE(a.origF() == b.origF());
+    REQUIRE(a.folded_faces() == b.folded_faces());
+    REQUIRE(a.adaptive_grid_regions() == b.adaptive_grid_regions());
+    REQUIRE(a.exterior_grid().cells() == b.exterior_grid().cells());
+    REQUIRE(a.faces().size() == b.faces().size());
+    for (auto &&[fa, fb] : mtao::iterator::zip(a.faces(), b.faces())) {
+        REQUIRE(fa.indices == fb.indices);
+        REQUIRE(fa.id == fb.id);
+        REQUIRE(fa.N == fb.N);
+        REQUIRE(fa.external_boundary == fb.external_boundary);
+        REQUIRE(bool(fa.triangulation) == bool(fb.triangulation));
+        if (fa.triangulation) {
+            REQUIRE(*fa.triangulation == *fb.triangulation);
+        }
+    }
+    REQUIRE(a.cells().size() == b.cells().size());
+    for (auto &&[ca, cb] : mtao::iterator::zip(a.cells(), b.cells())) {
+        REQUIRE(ca == cb);
+        REQUIRE(ca.index == cb.index);
+        REQUIRE(ca.region == cb.region);
+        REQUIRE(ca.grid_cell == cb.grid_cell);
+    }
+    REQUIRE(a.mesh_cut_faces().size() == b.mesh_cut_faces().size());
+    for (auto &&[ma, mb] : mtao::iterator::zip(a.mesh_cut_faces(), b.mesh_cut_faces())) {
+        REQUIRE(ma.first == mb.first);
+        REQUIRE(ma.second.parent_fid == mb.second.parent_fid);
+        REQUIRE(ma.second.barys == mb.second.barys);
+    }
+}
+
+// tiles number vertices, faces and cells differently from from_grid, so the cells and faces of
+// tiled meshes are compared through the positions of their vertices
+void require_same_cells(const mandoline::CutCellMesh<3> &a, const mandoline::CutCellMesh<3> &b) {
+    auto VA = a.vertices();
+    auto VB = b.vertices();
+    REQUIRE(VA.cols() == VB.cols());
+    std::vector<int> vertex_map(VB.cols());
+    for (int i = 0; i < VB.cols(); ++i) {
+        int j;
+        (VA.colwise() - VB.col(i)).colwise().squaredNorm().minCoeff(&j);
+        REQUIRE((VA.col(j) - VB.col(i)).norm() < 1e-8);
+        vertex_map[i] = j;
+    }
+    // {sorted vertices, input triangle or -1, axis, coordinate}
+    using FaceKey = std::tuple<std::vector<int>, int, int, int>;
+    auto face_keys = [](const mandoline::CutCellMesh<3> &m, const std::vector<int> *map) {
+        std::vector<FaceKey> keys;
+        for (auto &&f : m.faces()) {
+            std::vector<int> vertices;
+            for (auto &&loop : f.indices) {
+                for (int v : loop) {
+                    vertices.emplace_back(map ? (*map)[v] : v);
+                }
+            }
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+            if (f.is_mesh_face()) {
+                keys.emplace_back(std::move(vertices), f.as_face_id(), -1, -1);
+            } else {
+                auto [axis, coord] = f.as_axial_id();
+                keys.emplace_back(std::move(vertices), -1, axis, coord);
+            }
+        }
+        return keys;
+    };
+    auto cell_keys = [](const mandoline::CutCellMesh<3> &m, const std::vector<FaceKey> &faces) {
+        std::set<std::tuple<std::array<int, 3>, std::set<FaceKey>>> keys;
+        for (auto &&c : m.cells()) {
+            std::set<FaceKey> cell_faces;
+            for (auto &&[fid, s] : c) {
+                cell_faces.emplace(faces[fid]);
+            }
+            keys.emplace(c.grid_cell, std::move(cell_faces));
+        }
+        return keys;
+    };
+    auto FA = face_keys(a, nullptr);
+    auto FB = face_keys(b, &vertex_map);
+    REQUIRE(FA.size() == FB.size());
+    REQUIRE(std::set<FaceKey>(FA.begin(), FA.end()) == std::set<FaceKey>(FB.begin(), FB.end()));
+    REQUIRE(a.cells().size() == b.cells().size());
+    REQUIRE(cell_keys(a, FA) == cell_keys(b, FB));
+    REQUIRE(a.num_cells() == b.num_cells());
+}
+}// namespace
+
 TEST_CASE("3D Cube", "[ccm3]") {
 
     auto [V, F] = mtao::geometry::mesh::shapes::cube<double>();
@@ -462,3 +601,978 @@ TEST_CASE("3D TwoBoxes", "[ccm3]") {
 
     REQUIRE(regions == 3);
 }
+
+TEST_CASE("3D Tiled Sphere", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 9, 8, 7 } });
+    auto ccm = from_grid(V, F, grid);
+    for (int ghost_layers : { 1, 2 }) {
+        auto tiled = from_grid_tiled(V, F, grid, std::array<int, 3>{ { 4, 3, 4 } }, 0, {}, 2, ghost_layers);
+
+        REQUIRE(tiled.num_cut_cells() == ccm.num_cut_cells());
+        REQUIRE(tiled.num_cells() == ccm.num_cells());
+        require_same_cells(ccm, tiled);
+
+        auto R = ccm.regions();
+        auto TR = tiled.regions();
+        REQUIRE(*std::max_element(TR.begin(), TR.end()) == *std::max_element(R.begin(), R.end()));
+
+        REQUIRE(tiled.cell_volumes().sum() == Approx(ccm.cell_volumes().sum()));
+    }
+
+    // the exterior cubes are built over the whole grid, so they can span tiles like from_grid's do
+    auto adaptive = from_grid(V, F, grid, 2);
+    auto adaptive_tiled = from_grid_tiled(V, F, grid, std::array<int, 3>{ { 3, 3, 3 } }, 2);
+    REQUIRE(adaptive_tiled.exterior_grid().cells().size() == adaptive.exterior_grid().cells().size());
+    REQUIRE(adaptive_tiled.num_cells() == adaptive.num_cells());
+}
+
+TEST_CASE("3D Tiled Large Triangles", "[ccm3]") {
+
+    // every triangle of the cube spans several tiles, so they all get clipped and cut into pieces
+    mtao::ColVecs3d V;
+    mtao::ColVecs3i F;
+    std::tie(V, F) = mtao::geometry::mesh::shapes::cube<double>();
+    mtao::Vec3d center = V.rowwise().mean();
+    V = (Eigen::AngleAxisd(.3, mtao::Vec3d::UnitX()) * Eigen::AngleAxisd(.5, mtao::Vec3d::UnitY())).toRotationMatrix() * (V.colwise() - center);
+    auto bbox = mtao::geometry::bounding_box(V);
+    bbox.min().array() -= .2;
+    bbox.max().array() += .2;
+    auto grid = mandoline::CutCellMesh<3>::StaggeredGrid::from_bbox(bbox, std::array<int, 3>{ { 9, 8, 7 } }, false);
+
+    auto ccm = from_grid(V, F, grid);
+    auto tiled = from_grid_tiled(V, F, grid, std::array<int, 3>{ { 3, 3, 3 } });
+    REQUIRE(tiled.num_cut_cells() == ccm.num_cut_cells());
+    require_same_cells(ccm, tiled);
+    REQUIRE(tiled.cell_volumes().sum() == Approx(ccm.cell_volumes().sum()));
+
+    for (int axis = 0; axis < 3; ++axis) {
+        auto pipelined = from_grid_pipelined(V, F, grid, axis, 2, 0, {}, 3);
+        REQUIRE(pipelined.num_cut_cells() == ccm.num_cut_cells());
+        require_same_cells(ccm, pipelined);
+        REQUIRE(pipelined.cell_volumes().sum() == Approx(ccm.cell_volumes().sum()));
+    }
+}
+
+TEST_CASE("3D Parallel Cell Merge", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(2, { { 6, 5, 7 } });
+    mtao::vector<mtao::Vec3d> stlp(V.cols());
+    for (auto &&[i, v] : mtao::iterator::enumerate(stlp)) {
+        v = V.col(i);
+    }
+    mandoline::construction::CutCellGenerator<3> ccg(stlp, grid, {});
+    ccg.add_boundary_elements(F);
+    ccg.bake();
+    auto GV = ccg.all_GV();
+
+    // the parallel merge has to number the cells exactly like the serial one
+    mandoline::construction::CellCollapser serial(ccg.faces());
+    serial.merge(GV, true, false);
+    mandoline::construction::CellCollapser parallel(ccg.faces());
+    parallel.merge(GV, true, true);
+
+    REQUIRE(serial.cell_boundaries().size() > 2);
+    REQUIRE(serial.cell_boundaries() == parallel.cell_boundaries());
+    REQUIRE(serial.m_halfface_to_cell == parallel.m_halfface_to_cell);
+    REQUIRE(serial.cell_faces() == parallel.cell_faces());
+}
+
+TEST_CASE("3D Parallel Crossing Fusion", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 6, 5, 7 } });
+    mtao::vector<mtao::Vec3d> stlp(V.cols());
+    for (auto &&[i, v] : mtao::iterator::enumerate(stlp)) {
+        v = V.col(i);
+    }
+    mandoline::construction::CutCellGenerator<3> ccg(stlp, grid, {});
+    ccg.add_boundary_elements(F);
+    ccg.bake();
+    const auto &data = ccg.data();
+
+    auto indices = [](const auto &crossings) {
+        std::vector<int> ret;
+        std::transform(crossings.begin(), crossings.end(), std::back_inserter(ret), [](auto &&c) { return c.index; });
+        return ret;
+    };
+    // every position shows up twice, out of order, so most crossings are fused with an earlier one
+    auto crossings = data.crossings();
+    REQUIRE(crossings.size() > 0);
+    crossings.insert(crossings.end(), crossings.rbegin(), crossings.rend());
+    std::mt19937 gen(0);
+    std::shuffle(crossings.begin() + crossings.size() / 2, crossings.end(), gen);
+    for (auto &&c : crossings) {
+        c.index = -1;
+    }
+
+    auto serial = crossings;
+    data.fuse_crossings_serial(serial);
+    {
+        auto baked = indices(data.crossings());
+        auto fused = indices(serial);
+        REQUIRE(std::equal(baked.begin(), baked.end(), fused.begin()));
+    }
+
+#ifdef MTAO_OPENMP
+    const int max_threads = omp_get_max_threads();
+    for (int threads : { 1, 2, 3, 8 }) {
+        omp_set_num_threads(threads);
+#endif
+        auto parallel = crossings;
+        data.fuse_crossings_parallel(parallel);
+        REQUIRE(indices(parallel) == indices(serial));
+#ifdef MTAO_OPENMP
+    }
+    omp_set_num_threads(max_threads);
+#endif
+}
+
+TEST_CASE("3D Active Cell Bitmask", "[ccm3]") {
+    using coord_type = CutCellGenerator<3>::coord_type;
+
+    // no padding around the sphere, so the extremal vertices sit on the grid boundary
+    // and the set below contains cells outside of the grid
+    auto [V, F] = mtao::geometry::mesh::sphere<double>(3);
+    auto bbox = mtao::geometry::bounding_box(V);
+    auto grid = mandoline::CutCellMesh<3>::StaggeredGrid::from_bbox(bbox, std::array<int, 3>{ { 6, 5, 7 } }, false);
+    mtao::vector<mtao::Vec3d> stlp(V.cols());
+    for (auto &&[i, v] : mtao::iterator::enumerate(stlp)) {
+        v = V.col(i);
+    }
+    CutCellGenerator<3> ccg(stlp, grid, {});
+    ccg.add_boundary_elements(F);
+    ccg.bake();
+
+    // the std::set the generator used to build: the cell of every crossing and the cells behind the planes it lies on
+    std::set<coord_type> reference;
+    const auto &table = ccg.data().crossing_table();
+    for (int row = 0; row < table.size(); ++row) {
+        const coord_type c = table.coord(row);
+        auto q = table.quot(row);
+        for (int offset = 0; offset < 8; ++offset) {
+            coord_type cell = c;
+            bool used = true;
+            for (int d = 0; d < 3; ++d) {
+                if (offset & (1 << d)) {
+                    used &= q(d) == 0;
+                    cell[d]--;
+                }
+            }
+            if (used) {
+                reference.insert(cell);
+            }
+        }
+    }
+
+    auto AC = ccg.active_cells();
+    std::vector<coord_type> active;
+    AC.for_each([&](const coord_type &c) { active.emplace_back(c); });
+
+    std::vector<coord_type> expected, dropped;
+    for (auto &&c : reference) {
+        (AC.valid_index(c) ? expected : dropped).emplace_back(c);
+    }
+    REQUIRE(!dropped.empty());
+    REQUIRE(active == expected);
+    REQUIRE(AC.count() == expected.size());
+
+    // the (axis, plane, cell in the plane) entries make_faces deactivates, with the range checks the set version needed
+    auto flagged_planes = [&](const auto &cells) {
+        std::set<std::tuple<int, int, std::array<int, 2>>> ret;
+        for (auto &&c : cells) {
+            for (int i = 0; i < 3; ++i) {
+                int p1 = (i + 1) % 3;
+                int p2 = (i + 2) % 3;
+                if (c[p1] < 0 || c[p1] >= ccg.cell_shape()[p1] || c[p2] < 0 || c[p2] >= ccg.cell_shape()[p2]) {
+                    continue;
+                }
+                std::array<int, 2> c2{ { c[p1], c[p2] } };
+                if (c[i] >= 0) {
+                    ret.emplace(i, c[i], c2);
+                }
+                if (c[i] + 1 < ccg.vertex_shape()[i]) {
+                    ret.emplace(i, c[i] + 1, c2);
+                }
+            }
+        }
+        return ret;
+    };
+    REQUIRE(flagged_planes(reference) == flagged_planes(active));
+}
+
+TEST_CASE("3D Incremental Deforming Bake", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 9, 8, 7 } });
+    // pushes a small cap of the sphere in and out
+    auto frame_vertices = [&V = V](int frame) -> mtao::ColVecs3d {
+        mtao::ColVecs3d R = V;
+        double scale = 1 + .05 * std::sin(frame);
+        for (int i = 0; i < R.cols(); ++i) {
+            if (R(0, i) > .9) {
+                R.col(i) *= scale;
+            }
+        }
+        return R;
+    };
+    {
+        int moved = (V.row(0).array() > .9).count();
+        REQUIRE(moved > 0);
+        REQUIRE(4 * moved < V.cols());
+    }
+
+    for (int adaptive_level : { 0, 1 }) {
+        DeformingGeometryConstructor incremental(V, F, grid, adaptive_level);
+        incremental.set_incremental_intersections(true);
+        for (int frame = 1; frame <= 3; ++frame) {
+            auto R = frame_vertices(frame);
+            incremental.update_vertices(R);
+            incremental.bake();
+
+            DeformingGeometryConstructor full(R, F, grid, adaptive_level);
+            require_same_mesh(incremental.emit(), full.emit());
+        }
+    }
+}
+
+TEST_CASE("3D Pipelined Sphere", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 9, 8, 7 } });
+    auto ccm = from_grid(V, F, grid);
+    for (int axis = 0; axis < 3; ++axis) {
+        auto pipelined = from_grid_pipelined(V, F, grid, axis, 2, 0, {}, 3);
+
+        REQUIRE(pipelined.num_cut_cells() == ccm.num_cut_cells());
+        REQUIRE(pipelined.num_cells() == ccm.num_cells());
+        require_same_cells(ccm, pipelined);
+
+        auto R = ccm.regions();
+        auto PR = pipelined.regions();
+        REQUIRE(*std::max_element(PR.begin(), PR.end()) == *std::max_element(R.begin(), R.end()));
+
+        REQUIRE(pipelined.cell_volumes().sum() == Approx(ccm.cell_volumes().sum()));
+    }
+}
+
+TEST_CASE("3D Sphere Point Location", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 9, 8, 7 } });
+    auto ccm = from_grid(V, F, grid);
+    mandoline::CutCellLocator locator(ccm);
+
+    auto bbox = mtao::geometry::bounding_box(V);
+    mtao::ColVecs3d P = (mtao::ColVecs3d::Random(3, 400).array() * .4 * bbox.sizes().replicate(1, 400).array()).colwise() + bbox.center().array();
+    mtao::VecXi R = locator.locate(P);
+    REQUIRE(R == ccm.get_cell_indices(P));
+    for (int i = 0; i < P.cols(); ++i) {
+        mtao::Vec3d p = P.col(i);
+        REQUIRE(R(i) == locator.locate(p));
+        REQUIRE(R(i) >= 0);
+        int ref = ccm.get_cell_index(p);
+        if (ref != -1) {
+            REQUIRE(R(i) == ref);
+        }
+        if (ccm.is_cut_cell(R(i))) {
+            auto &&cell = ccm.cells().at(R(i));
+            auto c = std::get<0>(ccm.vertex_grid().coord(p));
+            REQUIRE(cell.grid_cell == c);
+        }
+    }
+}
+
+TEST_CASE("3D Cell Face Incidence", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 6, 6 } });
+    mandoline::protobuf::CutMeshProto cmp;
+    ccm.serialize(cmp);
+    auto loaded = mandoline::CutCellMesh<3>::from_proto(cmp);
+
+    for (auto &&mesh : { &ccm, &loaded }) {
+        auto &&inc = mesh->cell_face_incidence();
+        REQUIRE(inc.cell_size() == mesh->cells().size());
+        for (auto &&[k, c] : mtao::iterator::enumerate(mesh->cells())) {
+            REQUIRE(c.index == mesh->cut_cell_index(k));
+            REQUIRE(c.region == mesh->cut_cell_region(k));
+            REQUIRE(c.grid_cell == mesh->cut_cell_grid_cell(k));
+            REQUIRE(inc.face_count(k) == c.size());
+            int j = inc.begin(k);
+            for (auto &&[fidx, s] : c) {
+                REQUIRE(inc.face(j) == fidx);
+                REQUIRE(inc.sign(j) == s);
+                ++j;
+            }
+        }
+    }
+    REQUIRE(loaded.cell_volumes().isApprox(ccm.cell_volumes()));
+}
+
+TEST_CASE("3D Parallel Boundary Assembly", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 7, 6, 5 } });
+
+    for (bool include_domain_boundary : { false, true }) {
+        // the triplet based assembly the operator used to do
+        auto trips = mandoline::operators::boundary_triplets(ccm.exterior_grid(), ccm.faces().size(), include_domain_boundary);
+        auto g = ccm.exterior_grid().cell_ownership_grid();
+        for (auto &&c : ccm.cells()) {
+            for (auto &&[fidx, s] : c) {
+                auto &f = ccm.faces()[fidx];
+                if (include_domain_boundary || !(f.external_boundary && std::get<0>(*f.external_boundary) == -2)) {
+                    trips.emplace_back(fidx, c.index, s ? -1 : 1);
+                }
+            }
+        }
+        for (auto &&[fidx, f] : mtao::iterator::enumerate(ccm.faces())) {
+            if (f.external_boundary) {
+                auto [c, s] = *f.external_boundary;
+                if (c >= 0) {
+                    trips.emplace_back(fidx, g.get(c), s ? -1 : 1);
+                }
+            }
+        }
+        Eigen::SparseMatrix<double> expected(ccm.face_size(), ccm.cell_size());
+        expected.setFromTriplets(trips.begin(), trips.end());
+
+        Eigen::SparseMatrix<double> B = mandoline::operators::boundary(ccm, include_domain_boundary);
+        REQUIRE(B.isCompressed());
+        REQUIRE(B.nonZeros() == expected.nonZeros());
+        REQUIRE((B - expected).norm() == 0);
+    }
+}
+
+TEST_CASE("3D Flat Container", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+
+    const std::string filename = "flat_container_test.flatcutmesh";
+    REQUIRE(mandoline::write_flat_cutmesh(ccm, filename));
+    REQUIRE(mandoline::flat::is_flat_file(filename));
+
+    mandoline::FlatCutMeshView view(filename);
+    REQUIRE(view.valid());
+    REQUIRE(view.vertex_count() == ccm.cut_vertex_size());
+    REQUIRE(view.face_count() == ccm.faces().size());
+    REQUIRE(view.cell_count() == ccm.cells().size());
+    REQUIRE(view.cube_count() == ccm.exterior_grid().cells().size());
+    for (auto &&s : { mandoline::flat::Section::VertexQuotients, mandoline::flat::Section::CellFaces, mandoline::flat::Section::OrigV }) {
+        auto sp = view.section<char>(s);
+        REQUIRE(sp.empty());
+    }
+    REQUIRE(reinterpret_cast<uintptr_t>(view.vertex_quotients().data()) % mandoline::flat::alignment == 0);
+
+    auto loaded = mandoline::CutCellMesh<3>::from_file(filename);
+    REQUIRE(loaded.origin().isApprox(ccm.origin()));
+    REQUIRE(loaded.dx().isApprox(ccm.dx()));
+    require_same_mesh(ccm, loaded);
+    REQUIRE(loaded.cell_volumes().isApprox(ccm.cell_volumes()));
+    REQUIRE(loaded.face_volumes().isApprox(ccm.face_volumes()));
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("3D Malformed Flat Container", "[ccm3]") {
+    using mandoline::flat::Section;
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+
+    const std::string filename = "flat_container_malformed_test.flatcutmesh";
+    REQUIRE(mandoline::write_flat_cutmesh(ccm, filename));
+    std::string original;
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        original.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    REQUIRE(original.size() > sizeof(mandoline::flat::Header));
+
+    auto entry = [](std::string &bytes, Section s) -> mandoline::flat::SectionEntry * {
+        return reinterpret_cast<mandoline::flat::SectionEntry *>(bytes.data() + sizeof(mandoline::flat::Header)) + uint32_t(s);
+    };
+    // either the view rejects the file or loading it throws, but nothing reads out of bounds
+    auto require_rejected = [&](const std::function<void(std::string &)> &corrupt) {
+        std::string bytes = original;
+        corrupt(bytes);
+        {
+            std::ofstream ofs(filename, std::ios::binary);
+            ofs.write(bytes.data(), bytes.size());
+        }
+        mandoline::FlatCutMeshView view(filename);
+        if (view.valid()) {
+            REQUIRE_THROWS_AS(mandoline::CutCellMesh<3>::from_flat(view), std::runtime_error);
+        }
+    };
+
+    for (auto &&s : { Section::VertexQuotients, Section::FaceNormals, Section::FaceIds, Section::CellFaces, Section::CellSigns, Section::CellInfo, Section::LoopIndices }) {
+        require_rejected([&](std::string &bytes) { entry(bytes, s)->count -= 1; });
+    }
+    require_rejected([&](std::string &bytes) { entry(bytes, Section::FaceTriangleOffsets)->count = 0; });
+    require_rejected([&](std::string &bytes) { entry(bytes, Section::FaceLoopOffsets)->count = 0; });
+    // a count that overflows count * scalar_size
+    require_rejected([&](std::string &bytes) { entry(bytes, Section::LoopIndices)->count = ~uint64_t(0) / 2; });
+    require_rejected([&](std::string &bytes) {
+        auto e = entry(bytes, Section::CellOffsets);
+        reinterpret_cast<int32_t *>(bytes.data() + e->offset)[1] = 1 << 30;
+    });
+    require_rejected([&](std::string &bytes) {
+        auto e = entry(bytes, Section::LoopOffsets);
+        auto offsets = reinterpret_cast<int32_t *>(bytes.data() + e->offset);
+        std::swap(offsets[1], offsets[2]);
+    });
+    require_rejected([&](std::string &bytes) {
+        auto e = entry(bytes, Section::LoopIndices);
+        reinterpret_cast<int32_t *>(bytes.data() + e->offset)[0] = -1;
+    });
+    require_rejected([&](std::string &bytes) {
+        auto e = entry(bytes, Section::CellFaces);
+        reinterpret_cast<int32_t *>(bytes.data() + e->offset)[0] = ccm.faces().size();
+    });
+    // indices into the grid and the input mesh
+    auto section_data = [&](std::string &bytes, Section s) {
+        return reinterpret_cast<int32_t *>(bytes.data() + entry(bytes, s)->offset);
+    };
+    REQUIRE(ccm.exterior_grid().cells().size() > 0);
+    REQUIRE(ccm.mesh_cut_faces().size() > 0);
+    require_rejected([&](std::string &bytes) { section_data(bytes, Section::Cubes)[4] = 1 << 20; });
+    require_rejected([&](std::string &bytes) { section_data(bytes, Section::Cubes)[1] = -1; });
+    require_rejected([&](std::string &bytes) { section_data(bytes, Section::CellInfo)[2] = ccm.cell_shape()[0]; });
+    require_rejected([&](std::string &bytes) { section_data(bytes, Section::MeshFaceInfo)[1] = ccm.origF().cols(); });
+    if (!ccm.adaptive_grid_regions().empty()) {
+        require_rejected([&](std::string &bytes) { section_data(bytes, Section::CubeRegions)[0] = -1; });
+    }
+    require_rejected([&](std::string &bytes) {
+        auto boundaries = section_data(bytes, Section::FaceBoundaries);
+        size_t i = 0;
+        while (i < ccm.faces().size() && boundaries[2 * i + 1] == -1) {
+            ++i;
+        }
+        REQUIRE(i < ccm.faces().size());
+        boundaries[2 * i] = 1 << 30;
+    });
+
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        ofs.write(original.data(), original.size());
+    }
+    require_same_mesh(ccm, mandoline::CutCellMesh<3>::from_flat(filename));
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("3D Proto Versions", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+    ccm.triangulate_faces(false);
+
+    for (int version : { 1, 2 }) {
+        mandoline::protobuf::CutMeshProto cmp;
+        ccm.serialize(cmp, version);
+        REQUIRE(int(cmp.version()) == (version == 1 ? 0 : 2));
+        // go through the wire format to make sure both layouts parse back
+        std::string bytes;
+        REQUIRE(cmp.SerializeToString(&bytes));
+        mandoline::protobuf::CutMeshProto parsed;
+        REQUIRE(parsed.ParseFromString(bytes));
+        auto loaded = mandoline::CutCellMesh<3>::from_proto(parsed);
+        require_same_mesh(ccm, loaded);
+        REQUIRE(loaded.cell_volumes().isApprox(ccm.cell_volumes()));
+    }
+}
+
+TEST_CASE("3D Malformed Proto", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+
+    // version 1 stays the default so older readers don't load an empty mesh
+    mandoline::protobuf::CutMeshProto v1;
+    ccm.serialize(v1);
+    REQUIRE(v1.version() == 0);
+    REQUIRE(v1.faces_size() == ccm.faces().size());
+
+    mandoline::protobuf::CutMeshProto cmp;
+    ccm.serialize(cmp, 2);
+    REQUIRE_NOTHROW(mandoline::CutCellMesh<3>::from_proto(cmp));
+    auto rejects = [&](auto &&corrupt) {
+        mandoline::protobuf::CutMeshProto bad = cmp;
+        corrupt(bad);
+        REQUIRE_THROWS_AS(mandoline::CutCellMesh<3>::from_proto(bad), std::runtime_error);
+    };
+    rejects([](auto &bad) { bad.set_version(3); });
+    rejects([](auto &bad) { bad.mutable_packed_vertices()->mutable_coords()->RemoveLast(); });
+    rejects([](auto &bad) { bad.mutable_packed_faces()->mutable_normals()->Truncate(3); });
+    rejects([](auto &bad) { bad.mutable_packed_faces()->mutable_curve_indices()->Set(0, -1); });
+    rejects([](auto &bad) {
+        auto &offsets = *bad.mutable_packed_faces()->mutable_face_curve_offsets();
+        offsets.Set(1, offsets.Get(offsets.size() - 1) + 1);
+    });
+    rejects([](auto &bad) { bad.mutable_packed_faces()->add_boundary_faces(0); });
+    rejects([&](auto &bad) { bad.mutable_packed_cells()->mutable_faces()->Set(0, ccm.faces().size()); });
+    rejects([](auto &bad) { bad.mutable_packed_cells()->mutable_offsets()->RemoveLast(); });
+    REQUIRE(cmp.packed_mesh_faces().faces_size() > 0);
+    rejects([](auto &bad) { bad.mutable_packed_mesh_faces()->mutable_parent_ids()->RemoveLast(); });
+    REQUIRE(cmp.packed_cubes().ids_size() > 1);
+    rejects([](auto &bad) { bad.mutable_packed_cubes()->mutable_radii()->RemoveLast(); });
+    // indices into the grid and the input mesh
+    rejects([&](auto &bad) { bad.mutable_packed_mesh_faces()->mutable_parent_ids()->Set(0, ccm.origF().cols()); });
+    rejects([&](auto &bad) { bad.mutable_packed_cells()->mutable_grid_cells()->Set(0, ccm.cell_shape()[0]); });
+    rejects([](auto &bad) { bad.mutable_packed_cubes()->mutable_radii()->Set(0, 1 << 20); });
+    rejects([](auto &bad) { bad.mutable_packed_cubes()->mutable_corners()->Set(0, -1); });
+    rejects([](auto &bad) { bad.mutable_packed_cubes()->mutable_ids()->Set(1, bad.packed_cubes().ids(0)); });
+    REQUIRE(cmp.packed_faces().boundary_faces_size() > 0);
+    rejects([](auto &bad) { bad.mutable_packed_faces()->mutable_boundary_indices()->Set(0, 1 << 30); });
+}
+
+TEST_CASE("3D Proto Versions benchmark", "[.][ccm3][benchmark]") {
+
+    auto ccm = sphere_cutmesh(5, { { 64, 64, 64 } });
+    ccm.triangulate_faces(false);
+    std::cout << ccm.cut_vertex_size() << " cut vertices, " << ccm.faces().size() << " faces, " << ccm.cells().size() << " cells" << std::endl;
+
+    for (int version : { 1, 2 }) {
+        std::string bytes;
+        double write_time = time_ms([&]() {
+            mandoline::protobuf::CutMeshProto cmp;
+            ccm.serialize(cmp, version);
+            cmp.SerializeToString(&bytes);
+        });
+        mandoline::CutCellMesh<3> loaded;
+        double read_time = time_ms([&]() {
+            mandoline::protobuf::CutMeshProto cmp;
+            cmp.ParseFromString(bytes);
+            loaded = mandoline::CutCellMesh<3>::from_proto(cmp);
+        });
+        REQUIRE(loaded.cells().size() == ccm.cells().size());
+        std::cout << "v" << version << ": write " << write_time << "ms, read " << read_time << "ms, " << bytes.size() / 1024. << "KiB" << std::endl;
+    }
+}
+
+namespace {
+std::vector<mandoline::CutCellMesh<3>> stored_triangulation_round_trips(const mandoline::CutCellMesh<3> &ccm) {
+    std::vector<mandoline::CutCellMesh<3>> ret;
+    for (int version : { 1, 2 }) {
+        mandoline::protobuf::CutMeshProto cmp;
+        ccm.serialize(cmp, version);
+        ret.emplace_back(mandoline::CutCellMesh<3>::from_proto(cmp));
+    }
+    const std::string filename = "stored_triangulation_test.flatcutmesh";
+    mandoline::write_flat_cutmesh(ccm, filename);
+    ret.emplace_back(mandoline::CutCellMesh<3>::from_file(filename));
+    std::remove(filename.c_str());
+    return ret;
+}
+}// namespace
+
+TEST_CASE("3D Stored Triangulations", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+    ccm.triangulate_faces(false);
+
+    for (auto &&loaded : stored_triangulation_round_trips(ccm)) {
+        REQUIRE(loaded.faces().size() == ccm.faces().size());
+        std::vector<const int *> cached;
+        for (auto &&[a, b] : mtao::iterator::zip(ccm.faces(), loaded.faces())) {
+            REQUIRE(a.has_persistent_triangulation() == b.has_persistent_triangulation());
+            if (b.triangulation) {
+                REQUIRE(*a.triangulation == *b.triangulation);
+                cached.emplace_back(b.triangulation->data());
+            } else {
+                cached.emplace_back(nullptr);
+            }
+        }
+        // stored triangulations are reused rather than recomputed
+        loaded.triangulate_faces(false);
+        for (auto &&[f, ptr] : mtao::iterator::zip(loaded.faces(), cached)) {
+            if (ptr != nullptr) {
+                REQUIRE(f.triangulation->data() == ptr);
+            }
+        }
+        loaded.triangulate_faces(false, true);
+        for (auto &&[a, b] : mtao::iterator::zip(ccm.faces(), loaded.faces())) {
+            REQUIRE(bool(a.triangulation) == bool(b.triangulation));
+            if (a.triangulation) {
+                REQUIRE(*a.triangulation == *b.triangulation);
+            }
+        }
+    }
+
+    // triangulations with extra vertices are not stored and get recomputed after loading
+    ccm.triangulate_faces(true, true);
+    for (auto &&loaded : stored_triangulation_round_trips(ccm)) {
+        for (auto &&[a, b] : mtao::iterator::zip(ccm.faces(), loaded.faces())) {
+            REQUIRE(a.has_persistent_triangulation() == b.has_persistent_triangulation());
+        }
+        loaded.triangulate_faces(false);
+        for (auto &&f : loaded.faces()) {
+            REQUIRE(!f.triangulated_vertices);
+        }
+    }
+}
+
+TEST_CASE("3D Stored Triangulations benchmark", "[.][ccm3][benchmark]") {
+
+    auto ccm = sphere_cutmesh(5, { { 64, 64, 64 } });
+    std::cout << ccm.faces().size() << " faces" << std::endl;
+
+    mandoline::protobuf::CutMeshProto bare;
+    ccm.serialize(bare);
+    ccm.triangulate_faces(false);
+    mandoline::protobuf::CutMeshProto stored;
+    ccm.serialize(stored);
+
+    // what cutmesh_to_obj does after loading: triangulate whatever was not stored
+    for (auto &&pr : { std::make_pair("without stored triangulations", &bare), std::make_pair("with stored triangulations", &stored) }) {
+        const mandoline::protobuf::CutMeshProto &cmp = *pr.second;
+        mandoline::CutCellMesh<3> loaded;
+        double load_time = time_ms([&]() { loaded = mandoline::CutCellMesh<3>::from_proto(cmp); });
+        double triangulate_time = time_ms([&]() { loaded.triangulate_faces(false); });
+        std::cout << pr.first << ": load " << load_time << "ms, triangulate " << triangulate_time << "ms, " << cmp.ByteSizeLong() / 1024. << "KiB" << std::endl;
+    }
+}
+
+TEST_CASE("3D Cached Vertices", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 6, 5, 7 } });
+
+    auto &&CV = ccm.cached_vertices();
+    REQUIRE(CV == ccm.vertices());
+    REQUIRE(&CV == &ccm.cached_vertices());
+
+    // copies share the cache
+    auto copy = ccm;
+    REQUIRE(&copy.cached_vertices() == &CV);
+
+    mandoline::protobuf::CutMeshProto cmp;
+    ccm.serialize(cmp);
+    auto loaded = mandoline::CutCellMesh<3>::from_proto(cmp);
+    REQUIRE(loaded.cached_vertices() == ccm.vertices());
+
+    ccm.triangulate_faces(false);
+    auto FV = ccm.face_volumes(true);
+    REQUIRE(FV.size() == ccm.face_size());
+    REQUIRE(&ccm.cached_vertices() == &CV);
+}
+
+TEST_CASE("3D Cached Vertices benchmark", "[.][ccm3][benchmark]") {
+
+    auto ccm = sphere_cutmesh(5, { { 128, 128, 128 } });
+    ccm.triangulate_faces(false);
+    std::cout << ccm.num_vertices() << " vertices, " << ccm.num_vertices() * 3 * sizeof(double) / (1024. * 1024.) << "MiB per vertices() call" << std::endl;
+
+    constexpr int repeats = 10;
+    double copies = time_ms([&]() {
+        for (int j = 0; j < repeats; ++j) {
+            auto Vs = ccm.vertices();
+            REQUIRE(Vs.cols() == ccm.num_vertices());
+        }
+    });
+    double first = time_ms([&]() { ccm.face_volumes(true); });
+    double cached = time_ms([&]() {
+        for (int j = 0; j < repeats; ++j) {
+            ccm.face_volumes(true);
+        }
+    });
+    std::cout << "vertices(): " << copies / repeats << "ms per call" << std::endl;
+    std::cout << "face_volumes(true): " << first << "ms building the cache, " << cached / repeats << "ms per call afterwards" << std::endl;
+}
+
+TEST_CASE("Coord mask", "[ccm3]") {
+    using CM = mandoline::coord_mask<3>;
+    CM vertex(std::array<int, 3>{ { 1, 2, 3 } });
+    CM plane(1, 2);
+    CM other_plane(1, 4);
+    REQUIRE(vertex.all());
+    REQUIRE(plane.count() == 1);
+    REQUIRE(plane.bound_axis() == 1);
+    REQUIRE(*plane[1] == 2);
+    REQUIRE(!plane[0]);
+
+    REQUIRE((vertex & plane) == plane);
+    REQUIRE(!(plane & other_plane).active());
+    REQUIRE((vertex - plane).count() == 2);
+    REQUIRE(!(vertex - plane)[1]);
+    REQUIRE(vertex.partial_ordering(plane) == CM::PartialOrdering::Greater);
+    REQUIRE(plane.partial_ordering(vertex) == CM::PartialOrdering::Less);
+    REQUIRE(plane.partial_ordering(other_plane) == CM::PartialOrdering::Unknown);
+    REQUIRE(vertex.subsumes(plane));
+    REQUIRE(vertex.strict_subsumes(plane));
+    REQUIRE(plane.subsumes(plane));
+    REQUIRE(!plane.strict_subsumes(plane));
+    REQUIRE(!plane.subsumes(vertex));
+    // ordered like the optional array it replaced: unbound before bound
+    REQUIRE(CM{} < plane);
+    REQUIRE(plane < other_plane);
+
+    auto cells = vertex.possible_cells(vertex.as_array());
+    REQUIRE(cells.size() == 8);
+    REQUIRE(std::is_sorted(cells.begin(), cells.end()));
+    REQUIRE(cells[0] == std::array<int, 3>{ { 0, 1, 2 } });
+    REQUIRE(cells[7] == std::array<int, 3>{ { 1, 2, 3 } });
+    auto plane_cells = plane.possible_cells(std::array<int, 3>{ { 5, 2, 7 } });
+    REQUIRE(plane_cells.size() == 2);
+    REQUIRE(plane_cells[0] == std::array<int, 3>{ { 5, 1, 7 } });
+    REQUIRE(plane_cells[1] == std::array<int, 3>{ { 5, 2, 7 } });
+
+    CM edge(std::array<int, 3>{ { 1, 2, 3 } });
+    edge.unbind(0);
+    auto edge_cells = edge.possible_cells(std::array<int, 3>{ { 0, 2, 3 } });
+    auto shared = mandoline::intersect_cells(cells, edge_cells);
+    REQUIRE(shared.size() == 4);
+    for (auto &&c : shared) {
+        REQUIRE(c[0] == 0);
+    }
+}
+
+TEST_CASE("Possible cells benchmark", "[.][ccm3][benchmark]") {
+
+    auto [V, F, grid] = sphere_grid(5, { { 64, 64, 64 } });
+
+    mtao::vector<mtao::Vec3d> stlp(V.cols());
+    for (auto &&[i, v] : mtao::iterator::enumerate(stlp)) {
+        v = V.col(i);
+    }
+    mandoline::construction::CutCellGenerator<3> ccg(stlp, grid, {});
+    ccg.add_boundary_elements(F);
+    ccg.bake();
+    auto ccm = ccg.generate();
+
+    // the face sets generate() hands to possible_cells_cell
+    std::vector<std::set<int>> cell_faces;
+    for (auto &&c : ccm.cells()) {
+        auto &inds = cell_faces.emplace_back();
+        for (auto &&[fidx, s] : c) {
+            if (!ccm.is_folded_face(fidx)) {
+                inds.insert(fidx);
+            }
+        }
+    }
+    std::cout << cell_faces.size() << " cells" << std::endl;
+
+    // what possible_cells_cell did with std::set before cell lists were packed
+    using Cells = std::set<std::array<int, 3>>;
+    auto face_cells = [&](const std::set<std::vector<int>> &face) {
+        Cells possibles;
+        bool first = true;
+        for (auto &&loop : face) {
+            for (auto &&v : loop) {
+                auto pc = ccg.GV(v).possible_cells();
+                Cells s(pc.begin(), pc.end());
+                if (first) {
+                    possibles = std::move(s);
+                    first = false;
+                } else {
+                    Cells i;
+                    std::set_intersection(possibles.begin(), possibles.end(), s.begin(), s.end(), std::inserter(i, i.end()));
+                    possibles = std::move(i);
+                }
+            }
+        }
+        return possibles;
+    };
+    size_t set_count = 0, list_count = 0;
+    double set_time = time_ms([&]() {
+        for (auto &&inds : cell_faces) {
+            if (inds.empty()) continue;
+            Cells possibles = face_cells(ccm.faces()[*inds.begin()].indices);
+            for (auto &&f : inds) {
+                auto s = face_cells(ccm.faces()[f].indices);
+                Cells i;
+                std::set_intersection(possibles.begin(), possibles.end(), s.begin(), s.end(), std::inserter(i, i.end()));
+                possibles = std::move(i);
+            }
+            set_count += possibles.size();
+        }
+    });
+    double list_time = time_ms([&]() {
+        for (auto &&inds : cell_faces) {
+            list_count += ccg.possible_cells_cell(inds, ccm.faces()).size();
+        }
+    });
+    REQUIRE(set_count == list_count);
+    std::cout << "std::set: " << set_time << "ms, inline cell lists: " << list_time << "ms" << std::endl;
+}
+
+namespace {
+// the laplacian examples/laplacian assembles, with the faces that have no dual edge dropped
+Eigen::SparseMatrix<double> assembled_laplacian(const mandoline::CutCellMesh<3> &ccm) {
+    Eigen::SparseMatrix<double> B = ccm.boundary();
+    mtao::VecXd W = ccm.mesh_face_mask().cwiseProduct(ccm.dual_hodge2());
+    W = W.unaryExpr([](double v) { return std::isfinite(v) ? v : 0.; });
+    return B.transpose() * W.asDiagonal() * B;
+}
+}// namespace
+
+TEST_CASE("3D Assembled Multigrid PCG", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 20, 20, 20 } });
+
+    mandoline::operators::AssembledMultigridPCGOptions options;
+    options.coarsest_size = 50;
+    mandoline::operators::AssembledMultigridPCG solver(ccm, options);
+    REQUIRE(solver.rows() == ccm.cell_size());
+    REQUIRE(solver.level_count() > 1);
+    REQUIRE(solver.level_size(solver.level_count() - 1) <= options.coarsest_size);
+
+    Eigen::SparseMatrix<double> L = assembled_laplacian(ccm);
+    REQUIRE((solver.matrix() - L).norm() <= 1e-10 * L.norm());
+
+    mtao::VecXd x = mtao::VecXd::Random(L.cols());
+    REQUIRE((solver.apply(x) - L * x).norm() <= 1e-10 * (L * x).norm());
+
+    // anything in the range of L is solvable, even though the regions away from the domain boundary are pure neumann
+    mtao::VecXd b = L * x;
+    mtao::VecXd y = solver.solve(b);
+    REQUIRE(solver.iterations() < options.max_iterations);
+    REQUIRE(solver.error() <= options.tolerance);
+    REQUIRE((L * y - b).norm() <= 2 * options.tolerance * b.norm());
+}
+
+TEST_CASE("3D Assembled Multigrid PCG benchmark", "[.][ccm3][benchmark]") {
+
+    for (int N : { 32, 64, 128 }) {
+        auto ccm = sphere_cutmesh(5, { { N, N, N } });
+        std::cout << N << "^3: " << ccm.cell_size() << " cells" << std::endl;
+
+        Eigen::SparseMatrix<double> L;
+        double assemble_time = time_ms([&]() { L = assembled_laplacian(ccm); });
+        mtao::VecXd b = L * mtao::VecXd::Random(L.cols());
+
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+        cg.setTolerance(1e-6);
+        cg.setMaxIterations(10000);
+        mtao::VecXd x;
+        double cg_time = time_ms([&]() {
+            cg.compute(L);
+            x = cg.solve(b);
+        });
+        std::cout << "  eigen cg: assemble " << assemble_time << "ms, solve " << cg_time << "ms, " << cg.iterations() << " iterations, residual " << (L * x - b).norm() / b.norm() << std::endl;
+
+        std::optional<mandoline::operators::AssembledMultigridPCG> solver;
+        double setup_time = time_ms([&]() { solver.emplace(ccm); });
+        double solve_time = time_ms([&]() { x = solver->solve(b); });
+        std::cout << "  multigrid pcg: setup " << setup_time << "ms (" << solver->level_count() << " levels), solve " << solve_time << "ms, " << solver->iterations() << " iterations, residual " << (L * x - b).norm() / b.norm() << std::endl;
+    }
+}
+
+TEST_CASE("3D Operator Cache", "[ccm3]") {
+
+    auto ccm = sphere_cutmesh(2, { { 20, 20, 20 } });
+
+    mandoline::operators::OperatorCache cache(ccm);
+    REQUIRE(cache.cell_size() == ccm.cell_size());
+    REQUIRE(cache.face_size() == ccm.face_size());
+
+    Eigen::SparseMatrix<double> B = mandoline::operators::boundary(ccm, false);
+    REQUIRE((cache.boundary() - B).norm() == 0);
+    REQUIRE(cache.cell_volumes() == mandoline::operators::cell_volumes(ccm));
+    REQUIRE(cache.face_volumes() == mandoline::operators::face_volumes(ccm));
+    REQUIRE(cache.dual_hodge2() == mandoline::operators::dual_hodge2(ccm));
+    REQUIRE(cache.primal_hodge2() == mandoline::operators::primal_hodge2(ccm));
+    REQUIRE(cache.dual_hodge3() == mandoline::operators::dual_hodge3(ccm));
+    REQUIRE(cache.primal_hodge3() == mandoline::operators::primal_hodge3(ccm));
+    REQUIRE(cache.regions() == ccm.regions());
+
+    auto check = [&](const mtao::VecXd &W, const mtao::VecXd &C) {
+        REQUIRE(cache.face_weights() == W);
+        REQUIRE(cache.cell_weights() == C);
+        Eigen::SparseMatrix<double> D = B.transpose() * W.asDiagonal();
+        Eigen::SparseMatrix<double> L = B.transpose() * W.asDiagonal() * B;
+        L += Eigen::SparseMatrix<double>(C.asDiagonal());
+        REQUIRE((cache.divergence() - D).norm() <= 1e-10 * D.norm());
+        REQUIRE((cache.laplacian() - L).norm() <= 1e-10 * L.norm());
+    };
+    auto check_factorization = [&]() {
+        // the laplacian has a kernel without cell weights, so only factorize once they are positive
+        REQUIRE(cache.cell_weights().minCoeff() > 0);
+        auto &&factorization = cache.factorization();
+        REQUIRE(factorization.info() == Eigen::Success);
+        REQUIRE(factorization.vectorD().minCoeff() > 0);
+        // the cached factorization has to match one made from scratch
+        Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(cache.laplacian());
+        REQUIRE((factorization.vectorD() - ldlt.vectorD()).norm() <= 1e-10 * ldlt.vectorD().norm());
+        mtao::VecXd b = mtao::VecXd::Random(cache.cell_size());
+        REQUIRE((cache.laplacian() * factorization.solve(b) - b).norm() <= 1e-8 * b.norm());
+    };
+    mtao::VecXd C = mtao::VecXd::Zero(cache.cell_size());
+    check(cache.dual_hodge2(), C);
+    REQUIRE((cache.divergence() - mandoline::operators::divergence(ccm)).norm() <= 1e-10 * cache.divergence().norm());
+    REQUIRE((cache.laplacian() - mandoline::operators::laplacian(ccm)).norm() <= 1e-10 * cache.laplacian().norm());
+
+    // new weights keep the sparsity pattern and only refill the values
+    auto nonzeros = cache.laplacian().nonZeros();
+    const int *inner = cache.laplacian().innerIndexPtr();
+    // an implicit diffusion step, the cell weights make the laplacian definite
+    C.setConstant(1.);
+    cache.set_cell_weights(C);
+    check(cache.dual_hodge2(), C);
+    check_factorization();
+
+    mtao::VecXd W = cache.mesh_face_mask().cwiseProduct(cache.dual_hodge2());
+    cache.set_face_weights(W);
+    REQUIRE(cache.laplacian().nonZeros() == nonzeros);
+    REQUIRE(cache.laplacian().innerIndexPtr() == inner);
+    check(W, C);
+    check_factorization();
+
+    REQUIRE_THROWS_AS(cache.set_face_weights(mtao::VecXd::Ones(cache.face_size() + 1)), std::invalid_argument);
+    REQUIRE_THROWS_AS(cache.set_cell_weights(mtao::VecXd::Ones(cache.cell_size() - 1)), std::invalid_argument);
+}
+
+TEST_CASE("3D Operator Cache benchmark", "[.][ccm3][benchmark]") {
+
+    constexpr int frames = 10;
+    // implicit diffusion steps, B^T W B + diag(volume / dt)
+    constexpr double dt = 1e-2;
+    for (int N : { 32, 64 }) {
+        auto ccm = sphere_cutmesh(5, { { N, N, N } });
+        std::cout << N << "^3: " << ccm.cell_size() << " cells" << std::endl;
+
+        // every frame rebuilds the operators from the mesh and factorizes from scratch
+        double rebuild_time = time_ms([&]() {
+            for (int j = 0; j < frames; ++j) {
+                Eigen::SparseMatrix<double> B = mandoline::operators::boundary(ccm, false);
+                mtao::VecXd W = mandoline::operators::dual_hodge2(ccm) * (1 + j);
+                mtao::VecXd C = mandoline::operators::dual_hodge3(ccm) / dt;
+                Eigen::SparseMatrix<double> L = B.transpose() * W.asDiagonal() * B;
+                L += Eigen::SparseMatrix<double>(C.asDiagonal());
+                Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(L);
+            }
+        });
+
+        std::optional<mandoline::operators::OperatorCache> cache;
+        double setup_time = time_ms([&]() {
+            cache.emplace(ccm);
+            cache->set_cell_weights(cache->dual_hodge3() / dt);
+        });
+        double cached_time = time_ms([&]() {
+            for (int j = 0; j < frames; ++j) {
+                cache->set_face_weights(cache->dual_hodge2() * (1 + j));
+                cache->factorization();
+            }
+        });
+        std::cout << "  " << frames << " frames: rebuild " << rebuild_time << "ms, cache setup " << setup_time << "ms + cached " << cached_time << "ms" << std::endl;
+    }
+}
+
+TEST_CASE("3D Scratch Arena", "[ccm3]") {
+
+    auto [V, F, grid] = sphere_grid(3, { { 9, 8, 7 } });
+    ScratchArena::set_enabled(false);
+    auto heap = from_grid(V, F, grid);
+    ScratchArena::set_enabled(true);
+    ScratchArena::reset_statistics();
+    auto scratch = from_grid(V, F, grid);
+    REQUIRE(ScratchArena::statistics().allocations > 0);
+    require_same_mesh(heap, scratch);
+}
+
+TEST_CASE("3D Scratch Arena benchmark", "[.][ccm3][benchmark]") {
+
+    for (int N : { 16, 32, 64 }) {
+        auto [V, F, grid] = sphere_grid(5, { { N, N, N } });
+        for (bool enabled : { false, true }) {
+            ScratchArena::set_enabled(enabled);
+            ScratchArena::reset_statistics();
+            double ms = time_ms([&, &V = V, &F = F, &grid = grid]() { from_grid(V, F, grid); });
+            auto stats = ScratchArena::statistics();
+            std::cout << "N=" << N << " scratch arena " << (enabled ? "on" : "off") << ": " << ms << "ms, "
+                      << stats.allocations << " scratch allocations, " << stats.heap_allocations << " of them on the heap ("
+                      << stats.heap_bytes << " bytes)" << std::endl;
+        }
+    }
+    ScratchArena::set_enabled(true);
+}
@@ -0,0 +1,50 @@
+#include <mandoline/mesh3.hpp>
+#include <mandoline/flat_cutmesh.hpp>
+#include <mtao/logging/logger.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+
+// converts between the protobuf .cutmesh format and the flat .flatcutmesh container.
+// The input format is detected from the file, the output format from the extension of the output filename.
+// Protobuf output uses the layout given by proto_version, see CutCellMesh<3>::proto_version
+int main(int argc, char *argv[]) {
+    mtao::logging::make_logger().set_level(mtao::logging::Level::Off);
+    if (argc < 3) {
+        std::cout << "cutmesh_convert <input> <output> [proto_version=" << mandoline::CutCellMesh<3>::proto_version << "]" << std::endl;
+        std::cout << "output is written as a flat container if it ends in " << mandoline::flat::extension << std::endl;
+        std::cout << "proto_version 1 writes a message per element, 2 writes packed columns" << std::endl;
+        return 1;
+    }
+    const std::string input = argv[1];
+    const std::string output = argv[2];
+    const int proto_version = argc > 3 ? std::atoi(argv[3]) : mandoline::CutCellMesh<3>::proto_version;
+    if (proto_version != 1 && proto_version != 2) {
+        std::cerr << "Unknown proto_version " << argv[3] << std::endl;
+        return 1;
+    }
+
+    auto ccm = mandoline::CutCellMesh<3>::from_file(input);
+    if (ccm.cell_size() == 0) {
+        std::cerr << "Failed to read " << input << std::endl;
+        return 1;
+    }
+
+    const std::string ext = mandoline::flat::extension;
+    if (output.size() >= ext.size() && output.compare(output.size() - ext.size(), ext.size(), ext) == 0) {
+        if (!mandoline::write_flat_cutmesh(ccm, output)) {
+            std::cerr << "Failed to write " << output << std::endl;
+            return 1;
+        }
+    } else {
+        std::ofstream ofs(output, std::ios::binary);
+        mandoline::protobuf::CutMeshProto cmp;
+        ccm.serialize(cmp, proto_version);
+        if (!cmp.SerializeToOstream(&ofs)) {
+            std::cerr << "Failed to write " << output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
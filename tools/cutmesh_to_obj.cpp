@@ -162,10 +162,14 @@ int main(int argc, char * argv[]) {
     bool open_regions = clp.optT<bool>("open-regions");
     bool cell_grid_ownership = clp.optT<bool>("cell-grid-ownership");
 
-    CutCellMesh<3> ccm = CutCellMesh<3>::from_proto(input_cutmesh);
+    CutCellMesh<3> ccm = CutCellMesh<3>::from_file(input_cutmesh);
 
 
-    ccm.triangulate_faces(false);
+    {
+        // only faces without a stored triangulation are triangulated here
+        auto t = mtao::logging::profiler("face_triangulation",false,"profiler");
+        ccm.triangulate_faces(false);
+    }
 
     std::set<int> inds;
     for (int i = 0; i < ccm.num_cells(); ++i) {
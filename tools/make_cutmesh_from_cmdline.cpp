@@ -40,9 +40,13 @@ cxxopts::Options make_cutmesh_clparser() {
         ("p,prescaled", "Whether the mesh was already scaled to grid index space",cxxopts::value<bool>()->default_value("false"))
         ("r,rsi", "remove self intersections (may be slow)",cxxopts::value<bool>()->default_value("false"))
         ("a,adaptivity_level", "Number of grid resolutions",cxxopts::value<int>()->default_value("0"))
+        ("b,branching_factor", "Width ratio between consecutive grid resolutions",cxxopts::value<int>()->default_value("2"))
+        ("balance", "Keep neighboring exterior cells within one resolution of each other",cxxopts::value<bool>()->default_value("false"))
+        ("t,triangulate", "Triangulate the cut faces so the triangulations are stored with the ccm",cxxopts::value<bool>()->default_value("false"))
         ("c,checks", "Do some quality checks on the resulting ccm",cxxopts::value<bool>()->default_value("false"))
         ("n,normalize", "Normalize data to a unit cube",cxxopts::value<bool>()->default_value("false"))
         ("i,info", "show extra info after creating the ccm",cxxopts::value<bool>()->default_value("false"))
+        ("proto_version", "cutmesh layout to write, 1 for a message per element or 2 for packed columns",cxxopts::value<int>()->default_value(std::to_string(CutCellMesh<3>::proto_version)))
         ("h,help", "Print usage");
     options.parse_positional({"mesh_file","output"});
     options.positional_help({"<mesh_file> <output_filename>"});
@@ -187,6 +191,8 @@ construction::CutCellGenerator<3> make_generator(const mtao::ColVecs3d& VV, cons
     } else {
         ccg.adaptive_level = 0;
     }
+    ccg.adaptive_branching_factor = result["branching_factor"].as<int>();
+    ccg.adaptive_balance = result["balance"].as<bool>();
     {
         auto t = mtao::logging::profiler("generator_bake",false,"profiler");
         ccg.add_boundary_elements(F);
@@ -209,6 +215,10 @@ CutCellMesh<3> make_cutmesh(const construction::CutCellGenerator<3>& ccg, const
         auto t = mtao::logging::profiler("ccm_generation",false,"profiler");
         ccm = ccg.generate();
     }
+    if(result["triangulate"].as<bool>()) {
+        auto t = mtao::logging::profiler("face_triangulation",false,"profiler");
+        ccm.triangulate_faces(false);
+    }
     bool normalize = result["normalize"].as<bool>();
 
     bool info = result["info"].as<bool>();
@@ -17,9 +17,15 @@ int main(int argc, char * argv[]) {
         return {};
     }
 
+    int proto_version = res["proto_version"].as<int>();
+    if(proto_version != 1 && proto_version != 2) {
+        mtao::logging::fatal() << "Unknown proto_version " << proto_version;
+        return 1;
+    }
+
     auto ccm = make_cutmesh(res);
     std::string output_prefix = res["output"].as<std::string>();;
-    ccm.write(output_prefix);
+    ccm.write(output_prefix, proto_version);
 
     return 0;
 }
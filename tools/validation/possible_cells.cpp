@@ -7,7 +7,8 @@ auto possible_cells(const CutCellMesh<3>& ccm, const std::vector<int>& face) ->
     if(face.empty()) { return {}; }
     auto possible = [&](int idx) -> std::set<std::array<int,3>> {
         if(ccm.is_grid_vertex(idx)) {
-            return Vertex<3>(ccm.vertex_grid().unindex(idx)).possible_cells();
+            auto pc = Vertex<3>(ccm.vertex_grid().unindex(idx)).possible_cells();
+            return { pc.begin(), pc.end() };
         } else {
             return {};
         }